@@ -0,0 +1,131 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#include <deflect/Frame.h>
+#include <deflect/Server.h>
+#include <deflect/version.h>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+
+#include <iostream>
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationVersion(
+        QString::fromStdString(deflect::Version::getString()));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Replay a stream recording into a local server, without network");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("recording", "The recording to replay");
+
+    QCommandLineOption fastOption("fast",
+                                  "Replay as fast as possible instead of "
+                                  "respecting the original timing");
+    parser.addOption(fastOption);
+
+    QCommandLineOption decodingOption("decoding",
+                                      "Decode the segments on arrival: none, "
+                                      "rgba or yuv (default: none)",
+                                      "mode", "none");
+    parser.addOption(decodingOption);
+
+    QCommandLineOption metricsOption("metrics",
+                                     "Write the server metrics to a JSON "
+                                     "file every second",
+                                     "file");
+    parser.addOption(metricsOption);
+
+    parser.process(app);
+
+    const auto arguments = parser.positionalArguments();
+    if (arguments.size() != 1)
+        parser.showHelp(EXIT_FAILURE);
+
+    const auto decodingName = parser.value(decodingOption);
+    auto decoding = deflect::Server::Decoding::none;
+    if (decodingName == "rgba")
+        decoding = deflect::Server::Decoding::rgba;
+    else if (decodingName == "yuv")
+        decoding = deflect::Server::Decoding::yuv;
+    else if (decodingName != "none")
+        parser.showHelp(EXIT_FAILURE);
+
+    try
+    {
+        deflect::Server server(0);
+        server.setDecoding(decoding);
+        if (parser.isSet(metricsOption))
+            server.startMetricsDump(parser.value(metricsOption));
+
+        // Consume the frames as soon as they are dispatched
+        size_t frameCount = 0;
+        QObject::connect(&server, &deflect::Server::pixelStreamOpened, &server,
+                         &deflect::Server::requestFrame);
+        QObject::connect(&server, &deflect::Server::receivedFrame,
+                         [&](deflect::FramePtr frame) {
+                             ++frameCount;
+                             server.acknowledgeFrame(frame);
+                             server.requestFrame(frame->uri);
+                         });
+
+        // Queued after the last records, which are then processed
+        QObject::connect(&server, &deflect::Server::replayFinished, &app,
+                         &QCoreApplication::quit, Qt::QueuedConnection);
+
+        QElapsedTimer timer;
+        timer.start();
+        server.replay(arguments[0], !parser.isSet(fastOption));
+        app.exec();
+
+        const double seconds = timer.elapsed() / 1000.0;
+        std::cout << frameCount << " frames dispatched in " << seconds
+                  << " s (" << frameCount / seconds << " fps)" << std::endl;
+        return EXIT_SUCCESS;
+    }
+    catch (const std::runtime_error& exception)
+    {
+        std::cerr << "streamreplayer: " << exception.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,123 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#ifndef DEFLECT_DECODETASK_H
+#define DEFLECT_DECODETASK_H
+
+#include <deflect/Segment.h>
+#include <deflect/types.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+namespace deflect
+{
+/**
+ * The decoding of a Segment, started on arrival by the Server.
+ *
+ * The task is shared between the Segment which is still compressed, as it
+ * travels to the FrameDispatcher, and the decoding thread.
+ */
+struct DecodeTask
+{
+    explicit DecodeTask(const Segment& segment_)
+        : segment(segment_)
+    {
+    }
+
+    /** The segment to decode, which holds the result once succeeded. */
+    Segment segment;
+
+    /** Decode to YUV instead of RGBA. */
+    bool toYUV = false;
+
+    /** Called by the decoding thread once finished. */
+    std::function<void()> onFinished;
+
+    /** Set when the decoding is no longer needed, skips it if not started. */
+    std::atomic<bool> cancelled{false};
+
+    /** Set once the segment can be read. */
+    std::atomic<bool> finished{false};
+
+    /** The result of the decoding, valid once finished. */
+    bool succeeded = false;
+
+    /**
+     * @return the size of the decoded image, an upper bound for YUV whose
+     *         subsampling is only known once decoded (at most 3 bytes per
+     *         pixel for 4:4:4).
+     */
+    size_t getDecodedByteCount() const
+    {
+        const size_t pixels =
+            size_t(segment.parameters.width) * segment.parameters.height;
+        return pixels * (toYUV ? 3 : 4);
+    }
+};
+
+/**
+ * Get the memory held by a segment while it is buffered in the Server.
+ *
+ * This is the image data received, except if it is memory-mapped (e.g.
+ * replayed from a StreamRecording), plus the output of its decoding on
+ * arrival, if any. The decoded size is counted from the start of the
+ * decoding so that the count does not change while the segment is buffered.
+ */
+inline size_t getBufferedByteCount(const Segment& segment)
+{
+    size_t byteCount = 0;
+    if (!segment.imageDataOwner)
+        byteCount += segment.imageData.size();
+    if (segment.decodeTask)
+        byteCount += segment.decodeTask->getDecodedByteCount();
+    return byteCount;
+}
+
+/**
+ * Start decoding a single segment on the threads of a FrameDecoder.
+ *
+ * @param decoder the decoder whose threads decode the segment
+ * @param task the decoding task, whose onFinished function is called from
+ *        the decoding thread.
+ */
+void startDecodeTask(FrameDecoder& decoder, std::shared_ptr<DecodeTask> task);
+}
+
+#endif
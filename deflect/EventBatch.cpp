@@ -0,0 +1,168 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#include "EventBatch.h"
+
+#include <QDataStream>
+
+#include <algorithm>
+
+namespace
+{
+const quint8 FLAG_MOUSE_LEFT = 1 << 0;
+const quint8 FLAG_MOUSE_RIGHT = 1 << 1;
+const quint8 FLAG_MOUSE_MIDDLE = 1 << 2;
+const quint8 FLAG_KEYBOARD_DATA = 1 << 3;
+
+bool _hasKeyboardData(const deflect::Event& event)
+{
+    return event.modifiers != 0 ||
+           std::any_of(event.text, event.text + UNICODE_TEXT_SIZE,
+                       [](const char c) { return c != 0; });
+}
+
+quint8 _getFlags(const deflect::Event& event)
+{
+    quint8 flags = 0;
+    if (event.mouseLeft)
+        flags |= FLAG_MOUSE_LEFT;
+    if (event.mouseRight)
+        flags |= FLAG_MOUSE_RIGHT;
+    if (event.mouseMiddle)
+        flags |= FLAG_MOUSE_MIDDLE;
+    if (_hasKeyboardData(event))
+        flags |= FLAG_KEYBOARD_DATA;
+    return flags;
+}
+
+/**
+ * Compact encoding: type and flags on one byte each, coordinates as floats and
+ * the key (touch point id / key code) as a 32-bit integer. The modifiers and
+ * text are only present for events which carry keyboard data.
+ */
+void _writeCompact(QDataStream& out, const deflect::Event& event)
+{
+    const quint8 flags = _getFlags(event);
+
+    out << (quint8)event.type << flags;
+    out << (float)event.mouseX << (float)event.mouseY;
+    out << (float)event.dx << (float)event.dy;
+    out << (qint32)event.key;
+
+    if (flags & FLAG_KEYBOARD_DATA)
+    {
+        out << (qint32)event.modifiers;
+        out.writeRawData(event.text, UNICODE_TEXT_SIZE);
+    }
+}
+
+void _readCompact(QDataStream& in, deflect::Event& event)
+{
+    quint8 type, flags;
+    in >> type >> flags;
+    event.type = (deflect::Event::EventType)type;
+
+    float mouseX, mouseY, dx, dy;
+    in >> mouseX >> mouseY >> dx >> dy;
+    event.mouseX = mouseX;
+    event.mouseY = mouseY;
+    event.dx = dx;
+    event.dy = dy;
+
+    event.mouseLeft = flags & FLAG_MOUSE_LEFT;
+    event.mouseRight = flags & FLAG_MOUSE_RIGHT;
+    event.mouseMiddle = flags & FLAG_MOUSE_MIDDLE;
+
+    qint32 key;
+    in >> key;
+    event.key = (int)key;
+
+    if (flags & FLAG_KEYBOARD_DATA)
+    {
+        qint32 modifiers;
+        in >> modifiers;
+        event.modifiers = (int)modifiers;
+        in.readRawData(event.text, UNICODE_TEXT_SIZE);
+    }
+}
+}
+
+namespace deflect
+{
+QByteArray serializeEvents(const QList<Event>& events,
+                           const EventEncoding encoding)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+
+    if (encoding == EventEncoding::compact)
+    {
+        stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+        for (const auto& event : events)
+            _writeCompact(stream, event);
+    }
+    else
+    {
+        for (const auto& event : events)
+            stream << event;
+    }
+    return data;
+}
+
+bool deserializeEvents(const QByteArray& data, const EventEncoding encoding,
+                       std::deque<Event>& events)
+{
+    QDataStream stream(data);
+    if (encoding == EventEncoding::compact)
+        stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    while (!stream.atEnd())
+    {
+        Event event;
+        if (encoding == EventEncoding::compact)
+            _readCompact(stream, event);
+        else
+            stream >> event;
+
+        if (stream.status() != QDataStream::Ok)
+            return false;
+        events.push_back(event);
+    }
+    return true;
+}
+}
@@ -0,0 +1,83 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#ifndef DEFLECT_EVENTBATCH_H
+#define DEFLECT_EVENTBATCH_H
+
+#include <deflect/api.h>
+
+#include "Event.h"
+
+#include <QByteArray>
+#include <QList>
+
+#include <deque>
+
+namespace deflect
+{
+/** The encodings of the events in a MESSAGE_TYPE_EVENT_BATCH* message. */
+enum class EventEncoding
+{
+    full,   /**< QDataStream operators of Event, Event::serializedSize each */
+    compact /**< single-precision coordinates and optional keyboard data */
+};
+
+/**
+ * Serialize a list of events into the payload of a single message.
+ *
+ * @param events the events to serialize
+ * @param encoding the encoding to use
+ * @return the serialized events
+ */
+DEFLECT_API QByteArray serializeEvents(const QList<Event>& events,
+                                       EventEncoding encoding);
+
+/**
+ * Deserialize the payload of an event message.
+ *
+ * @param data the payload of the message
+ * @param encoding the encoding used to serialize the events
+ * @param events the list to which the deserialized events are appended
+ * @return true if all the events could be deserialized, false otherwise
+ */
+DEFLECT_API bool deserializeEvents(const QByteArray& data,
+                                   EventEncoding encoding,
+                                   std::deque<Event>& events);
+}
+
+#endif
@@ -39,8 +39,17 @@
 
 #include "Frame.h"
 
+#include <chrono>
+
 namespace deflect
 {
+int64_t FrameTimestamps::getTimeUs()
+{
+    using namespace std::chrono;
+    const auto now = steady_clock::now().time_since_epoch();
+    return duration_cast<microseconds>(now).count();
+}
+
 QSize Frame::computeDimensions() const
 {
     QSize size(0, 0);
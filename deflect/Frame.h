@@ -47,8 +47,32 @@
 #include <QSize>
 #include <QString>
 
+#include <cstdint>
+
 namespace deflect
 {
+/**
+ * Timestamps of a frame along the streaming pipeline.
+ *
+ * All the times are in microseconds of the Server's clock, a negative value
+ * meaning unknown. The capture time is converted from the clock of the
+ * client using an estimated clock offset, which includes the minimum network
+ * delay observed so far.
+ *
+ * @version 1.7
+ */
+struct FrameTimestamps
+{
+    uint64_t index = 0;      //!< Frame index stamped by the client
+    int64_t captureUs = -1;  //!< Capture of the image(s) by the client
+    int64_t arrivalUs = -1;  //!< First segment received by the Server
+    int64_t completeUs = -1; //!< Frame finished by all the sources
+    int64_t dispatchUs = -1; //!< Frame sent to the consumer by the Server
+
+    /** @return the current time in microseconds of the clock used. */
+    DEFLECT_API static int64_t getTimeUs();
+};
+
 /**
  * A frame for a PixelStream.
  */
@@ -61,6 +85,9 @@ public:
     /** The PixelStream uri to which this frame is associated. */
     QString uri;
 
+    /** The timestamps of this frame. @version 1.7 */
+    FrameTimestamps timestamps;
+
     /** Get the total dimensions of this frame. */
     DEFLECT_API QSize computeDimensions() const;
 };
@@ -0,0 +1,257 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#include "FrameDecoder.h"
+
+#include "DecodeTask.h"
+#include "Frame.h"
+#include "SegmentDecoder.h"
+
+#include <QRunnable>
+#include <QThreadPool>
+#include <QThreadStorage>
+
+#include <atomic>
+#include <mutex>
+
+namespace deflect
+{
+namespace
+{
+enum class Output
+{
+    rgba,
+    yuv
+};
+
+/** The state of a frame being decoded, shared by all its segment tasks. */
+struct FrameTask
+{
+    FrameTask(FramePtr frame_, const Output output_)
+        : frame{std::move(frame_)}
+        , output{output_}
+        , remaining{frame->segments.size()}
+    {
+    }
+
+    void done(std::exception_ptr error)
+    {
+        if (error)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!firstError)
+                firstError = error;
+        }
+        if (--remaining > 0)
+            return;
+
+        if (firstError)
+            promise.set_exception(firstError);
+        else
+            promise.set_value();
+    }
+
+    const FramePtr frame;
+    const Output output;
+    std::atomic<size_t> remaining;
+    std::mutex mutex;
+    std::exception_ptr firstError;
+    std::promise<void> promise;
+};
+using FrameTaskPtr = std::shared_ptr<FrameTask>;
+
+class SegmentTask : public QRunnable
+{
+public:
+    SegmentTask(FrameTaskPtr task, Segment& segment,
+                QThreadStorage<SegmentDecoder*>& decoders)
+        : _task{std::move(task)}
+        , _segment(segment)
+        , _decoders(decoders)
+    {
+    }
+
+    void run() final
+    {
+        if (!_decoders.hasLocalData())
+            _decoders.setLocalData(new SegmentDecoder);
+        auto& decoder = *_decoders.localData();
+
+        std::exception_ptr error;
+        try
+        {
+#ifndef DEFLECT_USE_LEGACY_LIBJPEGTURBO
+            if (_task->output == Output::yuv)
+                decoder.decodeToYUV(_segment);
+            else
+#endif
+                decoder.decode(_segment);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        _task->done(error);
+    }
+
+private:
+    FrameTaskPtr _task;
+    Segment& _segment;
+    QThreadStorage<SegmentDecoder*>& _decoders;
+};
+
+class DecodeOnArrivalTask : public QRunnable
+{
+public:
+    DecodeOnArrivalTask(std::shared_ptr<DecodeTask> task,
+                        QThreadStorage<SegmentDecoder*>& decoders)
+        : _task{std::move(task)}
+        , _decoders(decoders)
+    {
+    }
+
+    void run() final
+    {
+        if (!_task->cancelled)
+        {
+            if (!_decoders.hasLocalData())
+                _decoders.setLocalData(new SegmentDecoder);
+            auto& decoder = *_decoders.localData();
+            try
+            {
+#ifndef DEFLECT_USE_LEGACY_LIBJPEGTURBO
+                if (_task->toYUV)
+                    decoder.decodeToYUV(_task->segment);
+                else
+#endif
+                    decoder.decode(_task->segment);
+                _task->succeeded = true;
+            }
+            catch (const std::runtime_error&)
+            {
+            }
+        }
+        _task->finished = true;
+        if (_task->onFinished)
+            _task->onFinished();
+    }
+
+private:
+    std::shared_ptr<DecodeTask> _task;
+    QThreadStorage<SegmentDecoder*>& _decoders;
+};
+}
+
+class FrameDecoder::Impl
+{
+public:
+    explicit Impl(const int threadCount)
+    {
+        if (threadCount > 0)
+            pool.setMaxThreadCount(threadCount);
+        // Keep the threads (and their decoders) alive between frames
+        pool.setExpiryTimeout(-1);
+    }
+
+    std::future<void> startDecoding(FramePtr frame, Output output);
+
+    /** Each pool thread decodes with its own turbojpeg handle. */
+    QThreadStorage<SegmentDecoder*> decoders;
+
+    /** Destroyed first, which deletes the decoders as the threads exit. */
+    QThreadPool pool;
+};
+
+std::future<void> FrameDecoder::Impl::startDecoding(FramePtr frame,
+                                                    const Output output)
+{
+    auto task = std::make_shared<FrameTask>(std::move(frame), output);
+    auto future = task->promise.get_future();
+
+    if (task->frame->segments.empty())
+    {
+        task->promise.set_value();
+        return future;
+    }
+
+    for (auto& segment : task->frame->segments)
+        pool.start(new SegmentTask(task, segment, decoders));
+    return future;
+}
+
+FrameDecoder::FrameDecoder(const int threadCount)
+    : _impl(new Impl(threadCount))
+{
+}
+
+FrameDecoder::~FrameDecoder()
+{
+}
+
+int FrameDecoder::getThreadCount() const
+{
+    return _impl->pool.maxThreadCount();
+}
+
+std::future<void> FrameDecoder::startDecoding(FramePtr frame)
+{
+    return _impl->startDecoding(std::move(frame), Output::rgba);
+}
+
+#ifndef DEFLECT_USE_LEGACY_LIBJPEGTURBO
+
+std::future<void> FrameDecoder::startDecodingToYUV(FramePtr frame)
+{
+    return _impl->startDecoding(std::move(frame), Output::yuv);
+}
+
+#endif
+
+void FrameDecoder::decode(Frame& frame)
+{
+    // The frame is borrowed by the tasks until the future is ready
+    FramePtr borrowed(&frame, [](Frame*) {});
+    startDecoding(borrowed).get();
+}
+
+void startDecodeTask(FrameDecoder& decoder, std::shared_ptr<DecodeTask> task)
+{
+    auto& impl = *decoder._impl;
+    impl.pool.start(new DecodeOnArrivalTask(std::move(task), impl.decoders));
+}
+}
@@ -0,0 +1,114 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#ifndef DEFLECT_FRAMEDECODER_H
+#define DEFLECT_FRAMEDECODER_H
+
+#include <deflect/api.h>
+#include <deflect/defines.h>
+#include <deflect/types.h>
+
+namespace deflect
+{
+/**
+ * Decode all the Segments of a Frame in parallel.
+ *
+ * The segments are decoded by a pool of threads owned by the decoder, each of
+ * them using its own SegmentDecoder.
+ */
+class FrameDecoder
+{
+public:
+    /**
+     * Construct a decoder.
+     *
+     * @param threadCount the number of decoding threads, defaults to the
+     *        number of cores.
+     */
+    DEFLECT_API explicit FrameDecoder(int threadCount = 0);
+
+    /** Destruct the decoder, waiting for the decodings in progress. */
+    DEFLECT_API ~FrameDecoder();
+
+    /** @return the number of decoding threads. */
+    DEFLECT_API int getThreadCount() const;
+
+    /**
+     * Start decoding the JPEG segments of a frame to RGBA.
+     *
+     * @param frame the frame to decode. Its segments are modified by the
+     *        decoding threads and should not be accessed until it completes.
+     * @return a future which is ready when all the segments are decoded, or
+     *         which holds a std::runtime_error if any of them failed.
+     * @see SegmentDecoder::decode()
+     */
+    DEFLECT_API std::future<void> startDecoding(FramePtr frame);
+
+#ifndef DEFLECT_USE_LEGACY_LIBJPEGTURBO
+
+    /**
+     * Start decoding the JPEG segments of a frame to YUV.
+     *
+     * @param frame the frame to decode, see startDecoding().
+     * @return a future which is ready when all the segments are decoded.
+     * @see SegmentDecoder::decodeToYUV()
+     */
+    DEFLECT_API std::future<void> startDecodingToYUV(FramePtr frame);
+
+#endif
+
+    /**
+     * Decode the JPEG segments of a frame to RGBA, using the pool of threads.
+     *
+     * @param frame the frame to decode.
+     * @throw std::runtime_error if a decompression error occured
+     */
+    DEFLECT_API void decode(Frame& frame);
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> _impl;
+
+    friend void startDecodeTask(FrameDecoder&, std::shared_ptr<DecodeTask>);
+
+    FrameDecoder(const FrameDecoder&) = delete;
+    FrameDecoder& operator=(const FrameDecoder&) = delete;
+};
+}
+
+#endif
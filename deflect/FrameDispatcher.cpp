@@ -39,27 +39,192 @@
 
 #include "FrameDispatcher.h"
 
+#include "DecodeTask.h"
 #include "Frame.h"
+#include "MPSCQueue.h"
 #include "ReceiveBuffer.h"
+#include "StreamRecorderWorker.h"
+#include "Trace.h"
 
+#include <QHash>
+
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cmath>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <vector>
 
 namespace deflect
 {
+namespace
+{
+const size_t DEFAULT_MAX_BUFFERED_FRAMES = 1;
+const double RATE_TIME_CONSTANT_S = 1.0;
+const size_t MAX_QUEUED_RECORDING_BYTES = 256 * 1024 * 1024;
+
+using Clock = std::chrono::steady_clock;
+
+/** Rate of events, exponentially averaged over the last second or so. */
+class RateMeter
+{
+public:
+    void add(const double amount, const Clock::time_point now)
+    {
+        _rate = get(now) + amount / RATE_TIME_CONSTANT_S;
+        _last = now;
+    }
+
+    double get(const Clock::time_point now) const
+    {
+        const std::chrono::duration<double> elapsed = now - _last;
+        return _rate * std::exp(-elapsed.count() / RATE_TIME_CONSTANT_S);
+    }
+
+private:
+    double _rate = 0.0;
+    Clock::time_point _last;
+};
+
+struct SourceCounters
+{
+    SourceMetrics metrics;
+    RateMeter bytes;
+    RateMeter segments;
+    RateMeter frames;
+};
+
+void _cancelDecoding(const Segments& segments)
+{
+    for (const auto& segment : segments)
+        if (segment.decodeTask)
+            segment.decodeTask->cancelled = true;
+}
+
+bool _isDecoding(const Frame& frame)
+{
+    for (const auto& segment : frame.segments)
+        if (segment.decodeTask && !segment.decodeTask->finished)
+            return true;
+    return false;
+}
+
+void _finishDecoding(Frame& frame)
+{
+    for (auto& segment : frame.segments)
+    {
+        if (!segment.decodeTask)
+            continue;
+
+        const auto task = std::move(segment.decodeTask);
+        if (task->succeeded)
+            segment = task->segment;
+        else
+            std::cerr << "Segment decoding failed, keeping compressed data"
+                      << std::endl;
+    }
+}
+
+void _addInterval(LatencyHistogram& histogram, const int64_t startUs,
+                  const int64_t endUs)
+{
+    // Intervals are skipped if a timestamp is unknown, e.g. old clients
+    if (startUs >= 0 && endUs >= 0)
+        histogram.add(std::max<int64_t>(endUs - startUs, 0));
+}
+}
+
 class FrameDispatcher::Impl
 {
 public:
+    struct Stream
+    {
+        QString uri;
+        ReceiveBuffer buffer;
+
+        /** The frame sent once its decodings started on arrival finish. */
+        FramePtr decodingFrame;
+        Clock::time_point decodingStart;
+
+        /** @name Metrics */
+        //@{
+        StreamMetrics metrics;
+        RateMeter bytesRate;
+        RateMeter segmentsRate;
+        RateMeter framesRate;
+        std::map<size_t, SourceCounters> sources;
+        //@}
+    };
+
+    void recordReceived(Stream& stream, const SourceMessage& message)
+    {
+        const auto now = Clock::now();
+        const auto segmentCount = message.segments.size();
+        const bool isFrame = message.type == SourceMessage::Type::frame;
+
+        auto& source = stream.sources[message.sourceIndex];
+        source.metrics.bytesReceived += message.byteCount;
+        source.metrics.segmentsReceived += segmentCount;
+        source.bytes.add(message.byteCount, now);
+        source.segments.add(segmentCount, now);
+        if (isFrame)
+        {
+            ++source.metrics.framesReceived;
+            source.frames.add(1, now);
+        }
+
+        stream.metrics.bytesReceived += message.byteCount;
+        stream.metrics.segmentsReceived += segmentCount;
+        stream.bytesRate.add(message.byteCount, now);
+        stream.segmentsRate.add(segmentCount, now);
+    }
+
+    void recordDispatched(Stream& stream, Frame& frame,
+                          const Clock::time_point readySince)
+    {
+        const auto now = Clock::now();
+        const std::chrono::duration<double, std::micro> latency =
+            now - readySince;
+        stream.metrics.readyLatency.add(latency.count());
+        ++stream.metrics.framesDispatched;
+        stream.framesRate.add(1, now);
+
+        auto& timestamps = frame.timestamps;
+        timestamps.dispatchUs = FrameTimestamps::getTimeUs();
+        auto& metrics = stream.metrics;
+        _addInterval(metrics.captureToArrival, timestamps.captureUs,
+                     timestamps.arrivalUs);
+        _addInterval(metrics.arrivalToComplete, timestamps.arrivalUs,
+                     timestamps.completeUs);
+        _addInterval(metrics.completeToDispatch, timestamps.completeUs,
+                     timestamps.dispatchUs);
+    }
+
+    void recordAcknowledged(Stream& stream, const Frame& frame)
+    {
+        const auto now = FrameTimestamps::getTimeUs();
+        auto& metrics = stream.metrics;
+        _addInterval(metrics.dispatchToAck, frame.timestamps.dispatchUs, now);
+        _addInterval(metrics.captureToAck, frame.timestamps.captureUs, now);
+    }
+
     Impl() {}
-    FramePtr consumeLatestFrame(const QString& uri)
+    FramePtr consumeLatestFrame(Stream& stream)
     {
         FramePtr frame(new Frame);
-        frame->uri = uri;
+        frame->uri = stream.uri;
 
-        ReceiveBuffer& buffer = streamBuffers[uri];
+        ReceiveBuffer& buffer = stream.buffer;
 
         while (buffer.hasCompleteFrame())
+        {
+            // Superseded frames do not need to be decoded anymore
+            _cancelDecoding(frame->segments);
+            frame->timestamps = buffer.getFrameTimestamps();
             frame->segments = buffer.popFrame();
+        }
 
         assert(!frame->segments.empty());
 
@@ -69,8 +234,185 @@ public:
         return frame;
     }
 
-    typedef std::map<QString, ReceiveBuffer> StreamBuffers;
-    StreamBuffers streamBuffers;
+    Stream* getStream(const size_t streamIndex)
+    {
+        if (streamIndex < streams.size())
+            return streams[streamIndex].get();
+        return nullptr;
+    }
+
+    size_t getStreamIndex(const QString& uri)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        const auto it = streamIndices.constFind(uri);
+        if (it != streamIndices.constEnd())
+        {
+            ++sourceCounts[it.value()];
+            return it.value();
+        }
+
+        size_t index = uris.size();
+        if (freeIndices.empty())
+        {
+            uris.emplace_back();
+            sourceCounts.push_back(0);
+        }
+        else
+        {
+            index = freeIndices.back();
+            freeIndices.pop_back();
+        }
+        uris[index] = uri;
+        sourceCounts[index] = 1;
+        streamIndices.insert(uri, index);
+        return index;
+    }
+
+    /**
+     * Release the index of a stream once the close message of a source has
+     * been processed. The index is reused once all its sources are closed.
+     * @return true if the index was freed.
+     */
+    bool releaseStreamIndex(const size_t streamIndex)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto& count = sourceCounts[streamIndex];
+        if (count == 0 || --count > 0)
+            return false;
+
+        streamIndices.remove(uris[streamIndex]);
+        uris[streamIndex].clear();
+        freeIndices.push_back(streamIndex);
+        return true;
+    }
+
+    /**
+     * Look up the index of a stream without interning its identifier, for
+     * queries which must not grow the tables with every identifier given.
+     * @return false if the identifier is unknown.
+     */
+    bool findStreamIndex(const QString& uri, size_t& streamIndex)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        const auto it = streamIndices.constFind(uri);
+        if (it == streamIndices.constEnd())
+            return false;
+
+        streamIndex = it.value();
+        return true;
+    }
+
+    Stream* findStream(const QString& uri)
+    {
+        size_t streamIndex = 0;
+        return findStreamIndex(uri, streamIndex) ? getStream(streamIndex)
+                                                 : nullptr;
+    }
+
+    QString getUri(const size_t streamIndex)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return uris[streamIndex];
+    }
+
+    /** The open streams, indexed by stream index (nullptr if closed). */
+    std::vector<std::unique_ptr<Stream>> streams;
+
+    size_t maxBufferedFrames = DEFAULT_MAX_BUFFERED_FRAMES;
+    size_t memoryBudget = 0;
+
+    /** Image buffers pooled by the sources, updated from their threads. */
+    std::atomic<int64_t> pooledByteCount{0};
+
+    /**
+     * @return the bytes buffered for the stream, including the frame waiting
+     *         for the end of its decodings.
+     */
+    static size_t getByteCount(const Stream& stream)
+    {
+        size_t byteCount = stream.buffer.getByteCount();
+        if (stream.decodingFrame)
+            for (const auto& segment : stream.decodingFrame->segments)
+                byteCount += getBufferedByteCount(segment);
+        return byteCount;
+    }
+
+    size_t getByteCount() const
+    {
+        size_t byteCount = 0;
+        for (const auto& stream : streams)
+            if (stream)
+                byteCount += getByteCount(*stream);
+        return byteCount;
+    }
+
+    /**
+     * Find the stream which uses the most memory.
+     * @return false if no stream has buffered data (with a complete frame).
+     */
+    bool findHeaviestStream(size_t& streamIndex, const bool withCompleteFrame)
+    {
+        size_t maxByteCount = 0;
+        for (size_t i = 0; i < streams.size(); ++i)
+        {
+            const auto& stream = streams[i];
+            if (!stream)
+                continue;
+            if (withCompleteFrame && !stream->buffer.hasCompleteFrame())
+                continue;
+
+            const auto byteCount = getByteCount(*stream);
+            if (byteCount > maxByteCount)
+            {
+                maxByteCount = byteCount;
+                streamIndex = i;
+            }
+        }
+        return maxByteCount > 0;
+    }
+
+    /** @name Interned stream identifiers, shared with the sources' threads */
+    //@{
+    std::mutex mutex;
+    QHash<QString, size_t> streamIndices;
+    std::vector<QString> uris;
+    std::vector<size_t> sourceCounts; //!< sources not closed, per index
+    std::vector<size_t> freeIndices;  //!< indices to reuse for new streams
+    //@}
+
+    MPSCQueue<SourceMessage> messages;
+    std::atomic<size_t> queuedFrameCount{0};
+    std::atomic<bool> wakeupPending{false};
+
+    /** Writes the records from its own thread, not to stall the dispatch. */
+    std::unique_ptr<StreamRecorderWorker> recorder;
+
+    void record(const SourceMessage& message)
+    {
+        StreamRecording::Record record;
+        switch (message.type)
+        {
+        case SourceMessage::Type::open:
+            record.type = StreamRecording::Record::Type::open;
+            break;
+        case SourceMessage::Type::frame:
+            record.type = StreamRecording::Record::Type::frame;
+            break;
+        case SourceMessage::Type::close:
+            record.type = StreamRecording::Record::Type::close;
+            break;
+        }
+        record.timeUs =
+            FrameTimestamps::getTimeUs() - recorder->getStartTimeUs();
+        record.uri = getUri(message.streamIndex);
+        record.sourceIndex = message.sourceIndex;
+        record.timestamps = message.timestamps;
+        record.segments = message.segments; // shares the image data
+        recorder->write(std::move(record));
+    }
 };
 
 FrameDispatcher::FrameDispatcher()
@@ -82,72 +424,365 @@ FrameDispatcher::~FrameDispatcher()
 {
 }
 
-void FrameDispatcher::addSource(const QString uri, const size_t sourceIndex)
+size_t FrameDispatcher::getStreamIndex(const QString& uri)
+{
+    return _impl->getStreamIndex(uri);
+}
+
+void FrameDispatcher::post(SourceMessage message)
+{
+    if (message.type == SourceMessage::Type::frame)
+        ++_impl->queuedFrameCount;
+    _impl->messages.push(std::move(message));
+    _wakeup();
+}
+
+void FrameDispatcher::notifyDecodingFinished()
 {
-    _impl->streamBuffers[uri].addSource(sourceIndex);
+    _wakeup();
+}
 
-    if (_impl->streamBuffers[uri].getSourceCount() == 1)
-        emit pixelStreamOpened(uri);
+size_t FrameDispatcher::getQueuedFrameCount() const
+{
+    return _impl->queuedFrameCount;
 }
 
-void FrameDispatcher::removeSource(const QString uri, const size_t sourceIndex)
+void FrameDispatcher::setMaxBufferedFrames(const size_t count)
 {
-    if (!_impl->streamBuffers.count(uri))
+    _impl->maxBufferedFrames = count;
+    for (auto& stream : _impl->streams)
+        if (stream)
+            stream->buffer.setMaxCompleteFrames(count);
+}
+
+size_t FrameDispatcher::getMaxBufferedFrames() const
+{
+    return _impl->maxBufferedFrames;
+}
+
+size_t FrameDispatcher::getDroppedFrameCount(const QString& uri) const
+{
+    const auto stream = _impl->findStream(uri);
+    return stream ? stream->buffer.getDroppedFrameCount() : 0;
+}
+
+void FrameDispatcher::setMemoryBudget(const size_t bytes)
+{
+    _impl->memoryBudget = bytes;
+    _enforceMemoryBudget();
+}
+
+size_t FrameDispatcher::getMemoryBudget() const
+{
+    return _impl->memoryBudget;
+}
+
+size_t FrameDispatcher::getBufferedByteCount() const
+{
+    return _impl->getByteCount();
+}
+
+size_t FrameDispatcher::getBufferedByteCount(const QString& uri) const
+{
+    const auto stream = _impl->findStream(uri);
+    return stream ? Impl::getByteCount(*stream) : 0;
+}
+
+void FrameDispatcher::addPooledByteCount(const int64_t delta)
+{
+    _impl->pooledByteCount += delta;
+}
+
+size_t FrameDispatcher::getPooledByteCount() const
+{
+    return size_t(std::max<int64_t>(_impl->pooledByteCount, 0));
+}
+
+void FrameDispatcher::startRecording(const QString& filename)
+{
+    _impl->recorder.reset(); // finish the previous recording first
+    _impl->recorder.reset(
+        new StreamRecorderWorker(filename, MAX_QUEUED_RECORDING_BYTES));
+
+    // The sources already open are recorded as if they had just opened
+    for (size_t i = 0; i < _impl->streams.size(); ++i)
+    {
+        const auto stream = _impl->getStream(i);
+        if (!stream)
+            continue;
+        for (const auto& kv : stream->sources)
+        {
+            SourceMessage message;
+            message.type = SourceMessage::Type::open;
+            message.streamIndex = i;
+            message.sourceIndex = kv.first;
+            _impl->record(message);
+        }
+    }
+}
+
+void FrameDispatcher::stopRecording()
+{
+    _impl->recorder.reset();
+}
+
+ServerMetrics FrameDispatcher::getMetrics() const
+{
+    const auto now = Clock::now();
+
+    ServerMetrics metrics;
+    metrics.memoryBudget = _impl->memoryBudget;
+    metrics.pooledBytes = getPooledByteCount();
+    for (const auto& stream : _impl->streams)
+    {
+        if (!stream)
+            continue;
+
+        auto streamMetrics = stream->metrics;
+        streamMetrics.uri = stream->uri;
+        streamMetrics.bytesPerSecond = stream->bytesRate.get(now);
+        streamMetrics.segmentsPerSecond = stream->segmentsRate.get(now);
+        streamMetrics.framesPerSecond = stream->framesRate.get(now);
+        streamMetrics.framesDropped = stream->buffer.getDroppedFrameCount();
+        streamMetrics.bufferedFrames = stream->buffer.getCompleteFrameCount();
+        streamMetrics.bufferedBytes = Impl::getByteCount(*stream);
+
+        for (const auto& kv : stream->sources)
+        {
+            auto source = kv.second.metrics;
+            source.sourceIndex = kv.first;
+            source.bytesPerSecond = kv.second.bytes.get(now);
+            source.segmentsPerSecond = kv.second.segments.get(now);
+            source.framesPerSecond = kv.second.frames.get(now);
+            source.bufferedBytes = stream->buffer.getByteCount(kv.first);
+            streamMetrics.sources.push_back(source);
+        }
+        metrics.bufferedBytes += streamMetrics.bufferedBytes;
+        metrics.streams.push_back(std::move(streamMetrics));
+    }
+    return metrics;
+}
+
+void FrameDispatcher::requestFrame(const QString uri)
+{
+    size_t streamIndex = 0;
+    if (!_impl->findStreamIndex(uri, streamIndex))
+        return;
+
+    auto stream = _impl->getStream(streamIndex);
+    if (!stream)
         return;
 
-    _impl->streamBuffers[uri].removeSource(sourceIndex);
+    ReceiveBuffer& buffer = stream->buffer;
+    buffer.setAllowedToSend(true);
+    if (buffer.hasCompleteFrame())
+        _sendLatestFrame(streamIndex);
+}
+
+void FrameDispatcher::acknowledgeFrame(const deflect::FramePtr frame)
+{
+    if (auto stream = _impl->findStream(frame->uri))
+        _impl->recordAcknowledged(*stream, *frame);
+}
+
+void FrameDispatcher::deleteStream(const QString uri)
+{
+    size_t streamIndex = 0;
+    if (_impl->findStreamIndex(uri, streamIndex))
+        _deleteStream(streamIndex);
+}
+
+void FrameDispatcher::_processMessages()
+{
+    DEFLECT_TRACE_SCOPE("FrameDispatcher::processMessages");
 
-    if (_impl->streamBuffers[uri].getSourceCount() == 0)
-        deleteStream(uri);
+    // Reset first, messages posted from now on trigger another call
+    _impl->wakeupPending = false;
+
+    SourceMessage message;
+    while (_impl->messages.pop(message))
+    {
+        if (_impl->recorder)
+            _impl->record(message);
+
+        switch (message.type)
+        {
+        case SourceMessage::Type::open:
+            _addSource(message.streamIndex, message.sourceIndex);
+            if (auto stream = _impl->getStream(message.streamIndex))
+                _impl->recordReceived(*stream, message);
+            break;
+        case SourceMessage::Type::frame:
+            --_impl->queuedFrameCount;
+            if (auto stream = _impl->getStream(message.streamIndex))
+            {
+                _impl->recordReceived(*stream, message);
+                for (const auto& segment : message.segments)
+                    stream->buffer.insert(segment, message.sourceIndex);
+                _finishFrame(message.streamIndex, message.sourceIndex,
+                             message.timestamps);
+            }
+            break;
+        case SourceMessage::Type::close:
+            _removeSource(message.streamIndex, message.sourceIndex);
+            // The stream must be gone before its index is reused
+            if (_impl->releaseStreamIndex(message.streamIndex))
+                _deleteStream(message.streamIndex);
+            break;
+        }
+    }
+    _sendDecodedFrames();
 }
 
-void FrameDispatcher::processSegment(const QString uri,
-                                     const size_t sourceIndex,
-                                     deflect::Segment segment)
+void FrameDispatcher::_wakeup()
 {
-    if (_impl->streamBuffers.count(uri))
-        _impl->streamBuffers[uri].insert(segment, sourceIndex);
+    if (!_impl->wakeupPending.exchange(true))
+        QMetaObject::invokeMethod(this, "_processMessages",
+                                  Qt::QueuedConnection);
 }
 
-void FrameDispatcher::processFrameFinished(const QString uri,
-                                           const size_t sourceIndex)
+void FrameDispatcher::_addSource(const size_t streamIndex,
+                                 const size_t sourceIndex)
 {
-    if (!_impl->streamBuffers.count(uri))
+    if (streamIndex >= _impl->streams.size())
+        _impl->streams.resize(streamIndex + 1);
+
+    auto& stream = _impl->streams[streamIndex];
+    if (!stream)
+    {
+        stream.reset(new Impl::Stream);
+        stream->uri = _impl->getUri(streamIndex);
+        stream->buffer.setMaxCompleteFrames(_impl->maxBufferedFrames);
+    }
+    stream->buffer.addSource(sourceIndex);
+
+    if (stream->buffer.getSourceCount() == 1)
+        emit pixelStreamOpened(stream->uri);
+}
+
+void FrameDispatcher::_removeSource(const size_t streamIndex,
+                                    const size_t sourceIndex)
+{
+    auto stream = _impl->getStream(streamIndex);
+    if (!stream)
+        return;
+
+    stream->buffer.removeSource(sourceIndex);
+    stream->sources.erase(sourceIndex);
+
+    if (stream->buffer.getSourceCount() == 0)
+        _deleteStream(streamIndex);
+}
+
+void FrameDispatcher::_finishFrame(const size_t streamIndex,
+                                   const size_t sourceIndex,
+                                   const FrameTimestamps& timestamps)
+{
+    auto stream = _impl->getStream(streamIndex);
+    if (!stream)
         return;
 
-    ReceiveBuffer& buffer = _impl->streamBuffers[uri];
+    ReceiveBuffer& buffer = stream->buffer;
     try
     {
-        buffer.finishFrameForSource(sourceIndex);
+        buffer.finishFrameForSource(sourceIndex, timestamps);
     }
     catch (const std::runtime_error& e)
     {
         std::cerr << "processFrameFinished got exception, closing stream: "
                   << e.what() << std::endl;
-        emit bufferSizeExceeded(uri);
+        emit bufferSizeExceeded(stream->uri);
         return;
     }
 
     if (buffer.isAllowedToSend() && buffer.hasCompleteFrame())
-        emit sendFrame(_impl->consumeLatestFrame(uri));
+        _sendLatestFrame(streamIndex);
+    else
+        _enforceMemoryBudget();
 }
 
-void FrameDispatcher::requestFrame(const QString uri)
+void FrameDispatcher::_sendLatestFrame(const size_t streamIndex)
 {
-    if (!_impl->streamBuffers.count(uri))
+    DEFLECT_TRACE_SCOPE("FrameDispatcher::dispatch");
+    auto& stream = *_impl->streams[streamIndex];
+    auto frame = _impl->consumeLatestFrame(stream);
+    const auto now = Clock::now();
+
+    // A frame still decoding, e.g. after another requestFrame(), is superseded
+    if (stream.decodingFrame)
+    {
+        _cancelDecoding(stream.decodingFrame->segments);
+        stream.decodingFrame.reset();
+    }
+
+    if (_isDecoding(*frame))
+    {
+        stream.decodingFrame = frame;
+        stream.decodingStart = now;
         return;
+    }
+    _finishDecoding(*frame);
+    _impl->recordDispatched(stream, *frame, now);
+    emit sendFrame(frame);
+}
 
-    ReceiveBuffer& buffer = _impl->streamBuffers[uri];
-    buffer.setAllowedToSend(true);
-    if (buffer.hasCompleteFrame())
-        emit sendFrame(_impl->consumeLatestFrame(uri));
+void FrameDispatcher::_sendDecodedFrames()
+{
+    DEFLECT_TRACE_SCOPE("FrameDispatcher::dispatchDecoded");
+
+    // Receivers of sendFrame() may request or delete streams: use indices
+    for (size_t i = 0; i < _impl->streams.size(); ++i)
+    {
+        auto stream = _impl->getStream(i);
+        if (!stream || !stream->decodingFrame ||
+            _isDecoding(*stream->decodingFrame))
+        {
+            continue;
+        }
+        FramePtr frame;
+        frame.swap(stream->decodingFrame);
+        _finishDecoding(*frame);
+        _impl->recordDispatched(*stream, *frame, stream->decodingStart);
+        emit sendFrame(frame);
+    }
 }
 
-void FrameDispatcher::deleteStream(const QString uri)
+void FrameDispatcher::_enforceMemoryBudget()
+{
+    const auto budget = _impl->memoryBudget;
+    if (budget == 0)
+        return;
+
+    size_t streamIndex = 0;
+    while (_impl->getByteCount() > budget)
+    {
+        // Evict complete frames first, from the heaviest streams
+        if (_impl->findHeaviestStream(streamIndex, true))
+        {
+            _impl->streams[streamIndex]->buffer.dropFrame();
+            continue;
+        }
+
+        // Only frames in progress remain, close the heaviest stream
+        if (!_impl->findHeaviestStream(streamIndex, false))
+            return;
+
+        const auto uri = _impl->streams[streamIndex]->uri;
+        std::cerr << "memory budget exceeded, closing stream: "
+                  << uri.toStdString() << std::endl;
+        emit bufferSizeExceeded(uri);
+        _deleteStream(streamIndex);
+    }
+}
+
+void FrameDispatcher::_deleteStream(const size_t streamIndex)
 {
-    if (_impl->streamBuffers.count(uri))
+    if (auto stream = _impl->getStream(streamIndex))
     {
-        _impl->streamBuffers.erase(uri);
+        const QString uri = stream->uri;
+        if (stream->decodingFrame)
+            _cancelDecoding(stream->decodingFrame->segments);
+        _impl->streams[streamIndex].reset();
         emit pixelStreamClosed(uri);
     }
 }
@@ -40,17 +40,22 @@
 #ifndef DEFLECT_FRAMEDISPATCHER_H
 #define DEFLECT_FRAMEDISPATCHER_H
 
+#include <deflect/Frame.h>
 #include <deflect/Segment.h>
+#include <deflect/ServerMetrics.h>
 #include <deflect/api.h>
 #include <deflect/types.h>
 
 #include <QObject>
-#include <map>
+#include <memory>
 
 namespace deflect
 {
 /**
  * Gather segments from multiple sources and dispatch full frames.
+ *
+ * Sources running in other threads send whole frames at once with post(),
+ * which is lock-free, using stream indices obtained from getStreamIndex().
  */
 class FrameDispatcher : public QObject
 {
@@ -63,41 +68,140 @@ public:
     /** Destructor. */
     ~FrameDispatcher();
 
-public slots:
+    /** A message from a source of a stream, see post(). */
+    struct SourceMessage
+    {
+        enum class Type
+        {
+            open,  //!< the source was added
+            frame, //!< the source has finished a frame
+            close  //!< the source was removed
+        };
+        Type type = Type::frame;
+        size_t streamIndex = 0;
+        size_t sourceIndex = 0;
+        Segments segments; //!< all the segments of the frame
+        size_t byteCount = 0; //!< bytes received since the previous message
+        FrameTimestamps timestamps; //!< of the frame, in the server's clock
+    };
+
     /**
-     * Add a source of Segments for a Stream.
+     * Get the index of a stream for post(), when a source opens it.
+     *
+     * Stream identifiers are interned while they have sources: the same index
+     * is returned for the same identifier until all the sources which got it
+     * have posted their close message. The index may then be reused for
+     * another stream. Each call must be followed by an open message and, at
+     * the end, by a close message with the index. The queries by identifier
+     * do not intern them. Thread-safe.
      *
      * @param uri Identifier for the stream
-     * @param sourceIndex Identifier for the source in this stream
+     * @return the index of the stream
      */
-    void addSource(QString uri, size_t sourceIndex);
+    size_t getStreamIndex(const QString& uri);
 
     /**
-     * Remove a source of Segments for a Stream.
+     * Post a message to be processed in the thread of the dispatcher.
      *
-     * @param uri Identifier for the stream
-     * @param sourceIndex Identifier for the source in this stream
+     * Lock-free and thread-safe. The processing of the messages posted in the
+     * meantime is triggered by a single queued call.
+     *
+     * @param message the message to process
+     */
+    void post(SourceMessage message);
+
+    /**
+     * Notify that a decoding started on arrival has finished.
+     *
+     * Frames are only sent once all their segments are decoded. Lock-free and
+     * thread-safe, like post().
+     * @see Segment::decodeTask
+     */
+    void notifyDecodingFinished();
+
+    /**
+     * @return the number of frames posted but not processed yet, to limit the
+     *         frames in flight. Lock-free and thread-safe, like post().
      */
-    void removeSource(QString uri, size_t sourceIndex);
+    size_t getQueuedFrameCount() const;
 
     /**
-     * Process a new Segment.
+     * Set the maximum number of complete frames buffered for each stream.
      *
+     * The oldest complete frames are dropped beyond this limit. Since only the
+     * latest frame is dispatched, the default of one frame does not drop any
+     * frame which would have been dispatched otherwise.
+     *
+     * @param count the maximum number of frames, 0 for no limit.
+     * @see ReceiveBuffer::setMaxCompleteFrames()
+     */
+    void setMaxBufferedFrames(size_t count);
+
+    /** @return the maximum number of complete frames for each stream. */
+    size_t getMaxBufferedFrames() const;
+
+    /**
      * @param uri Identifier for the stream
-     * @param sourceIndex Identifier for the source in the stream
-     * @param segment to process
+     * @return the number of frames dropped for the stream, 0 if not open.
      */
-    void processSegment(QString uri, size_t sourceIndex,
-                        deflect::Segment segment);
+    size_t getDroppedFrameCount(const QString& uri) const;
 
     /**
-     * The given source has finished sending segments for the current frame.
+     * Set the maximum number of bytes of image data buffered for all streams.
+     *
+     * When the budget is exceeded, complete frames are dropped from the
+     * streams which use the most memory. If that is not sufficient, the
+     * heaviest stream is closed with bufferSizeExceeded().
      *
+     * @param bytes the memory budget, 0 for no limit (default).
+     */
+    void setMemoryBudget(size_t bytes);
+
+    /** @return the memory budget, 0 if unlimited. */
+    size_t getMemoryBudget() const;
+
+    /** @return the number of bytes of image data buffered for all streams. */
+    size_t getBufferedByteCount() const;
+
+    /**
      * @param uri Identifier for the stream
-     * @param sourceIndex Identifier for the source in the stream
+     * @return the number of bytes of image data buffered for the stream.
      */
-    void processFrameFinished(QString uri, size_t sourceIndex);
+    size_t getBufferedByteCount(const QString& uri) const;
 
+    /**
+     * Account for the image buffers kept for reuse by the sources.
+     *
+     * Lock-free and thread-safe, like post().
+     *
+     * @param delta the number of bytes added to (or removed from) the pools
+     */
+    void addPooledByteCount(int64_t delta);
+
+    /** @return the number of bytes of image buffers pooled by the sources. */
+    size_t getPooledByteCount() const;
+
+    /** @return a snapshot of the metrics of all the open streams. */
+    ServerMetrics getMetrics() const;
+
+    /**
+     * Record the messages of all the sources, without decoding them.
+     *
+     * The records are written by a separate thread. If it falls behind, the
+     * frames which do not fit in its queue are not recorded.
+     *
+     * @param filename the StreamRecording to create
+     * @throw std::runtime_error if the file cannot be created
+     */
+    void startRecording(const QString& filename);
+
+    /**
+     * Stop recording, once the queued records are written, and write the
+     * index of the recording.
+     */
+    void stopRecording();
+
+public slots:
     /**
      * Request the dispatching of a new frame for any stream (mono/stereo).
      *
@@ -111,6 +215,15 @@ public slots:
      */
     void requestFrame(QString uri);
 
+    /**
+     * Notify that a dispatched frame was consumed, i.e. rendered.
+     *
+     * Used to measure the latency of the consumer and of the whole pipeline.
+     *
+     * @param frame a frame previously emitted by sendFrame()
+     */
+    void acknowledgeFrame(deflect::FramePtr frame);
+
     /**
      * Delete all the buffers for a Stream.
      *
@@ -147,9 +260,22 @@ signals:
      */
     void bufferSizeExceeded(QString uri);
 
+private slots:
+    void _processMessages();
+
 private:
     class Impl;
     std::unique_ptr<Impl> _impl;
+
+    void _wakeup();
+    void _addSource(size_t streamIndex, size_t sourceIndex);
+    void _removeSource(size_t streamIndex, size_t sourceIndex);
+    void _finishFrame(size_t streamIndex, size_t sourceIndex,
+                      const FrameTimestamps& timestamps);
+    void _sendLatestFrame(size_t streamIndex);
+    void _sendDecodedFrames();
+    void _enforceMemoryBudget();
+    void _deleteStream(size_t streamIndex);
 };
 }
 
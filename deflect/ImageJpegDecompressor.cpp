@@ -58,6 +58,8 @@ deflect::ChromaSubsampling _getSubsamp(const int tjJpegSubsamp)
         throw std::runtime_error("unsupported subsampling format");
     }
 }
+
+const tjscalingfactor FULL_SCALE{1, 1};
 }
 
 namespace deflect
@@ -97,47 +99,108 @@ JpegHeader ImageJpegDecompressor::decompressHeader(const QByteArray& jpegData)
 }
 
 QByteArray ImageJpegDecompressor::decompress(const QByteArray& jpegData)
+{
+    return decompress(jpegData, FULL_SCALE);
+}
+
+tjscalingfactor ImageJpegDecompressor::findScalingFactor(const double scale)
+{
+    int count = 0;
+    const tjscalingfactor* factors = tjGetScalingFactors(&count);
+
+    tjscalingfactor best = FULL_SCALE;
+    for (int i = 0; i < count; ++i)
+    {
+        const auto& factor = factors[i];
+        const double value = double(factor.num) / factor.denom;
+        if (value >= scale && value < double(best.num) / best.denom)
+            best = factor;
+    }
+    return best;
+}
+
+QByteArray ImageJpegDecompressor::decompress(const QByteArray& jpegData,
+                                             const tjscalingfactor& factor)
+{
+    const auto header = decompressHeader(jpegData);
+    const int width = TJSCALED(header.width, factor);
+    const int height = TJSCALED(header.height, factor);
+    const int pitch = width * tjPixelSize[TJPF_RGBX];
+
+    QByteArray decodedData(height * pitch, Qt::Uninitialized);
+    _decompress(jpegData, width, height, (uint8_t*)decodedData.data(), pitch);
+    return decodedData;
+}
+
+void ImageJpegDecompressor::decompress(const QByteArray& jpegData,
+                                       uint8_t* dst, const size_t pitch)
 {
     const auto header = decompressHeader(jpegData);
+    _decompress(jpegData, header.width, header.height, dst, pitch);
+}
+
+void ImageJpegDecompressor::_decompress(const QByteArray& jpegData,
+                                        const int width, const int height,
+                                        uint8_t* dst, const size_t pitch)
+{
     const int pixelFormat = TJPF_RGBX; // Format for OpenGL texture (GL_RGBA)
-    const int pitch = header.width * tjPixelSize[pixelFormat];
     const int flags = TJ_FASTUPSAMPLE;
 
-    QByteArray decodedData(header.height * pitch, Qt::Uninitialized);
-
+    // libjpeg-turbo selects the scaling factor matching the given dimensions
     int err = tjDecompress2(_tjHandle, (unsigned char*)jpegData.data(),
-                            (unsigned long)jpegData.size(),
-                            (unsigned char*)decodedData.data(), header.width,
-                            pitch, header.height, pixelFormat, flags);
+                            (unsigned long)jpegData.size(), dst, width,
+                            int(pitch), height, pixelFormat, flags);
     if (err != 0)
         throw std::runtime_error("libjpeg-turbo image decompression failed");
-
-    return decodedData;
 }
 
 #ifndef DEFLECT_USE_LEGACY_LIBJPEGTURBO
 
 ImageJpegDecompressor::YUVData ImageJpegDecompressor::decompressToYUV(
     const QByteArray& jpegData)
+{
+    return decompressToYUV(jpegData, FULL_SCALE);
+}
+
+ImageJpegDecompressor::YUVData ImageJpegDecompressor::decompressToYUV(
+    const QByteArray& jpegData, const tjscalingfactor& factor)
 {
     const auto header = decompressHeader(jpegData);
+    const int width = TJSCALED(header.width, factor);
+    const int height = TJSCALED(header.height, factor);
     const int pad = 1; // no padding
     const int flags = 0;
     const int jpegSubsamp = int(header.subsampling);
-    const auto decodedSize =
-        tjBufSizeYUV2(header.width, pad, header.height, jpegSubsamp);
+    const auto decodedSize = tjBufSizeYUV2(width, pad, height, jpegSubsamp);
 
     auto decodedData = QByteArray(decodedSize, Qt::Uninitialized);
 
     int err = tjDecompressToYUV2(_tjHandle, (unsigned char*)jpegData.data(),
                                  (unsigned long)jpegData.size(),
-                                 (unsigned char*)decodedData.data(),
-                                 header.width, pad, header.height, flags);
+                                 (unsigned char*)decodedData.data(), width,
+                                 pad, height, flags);
     if (err != 0)
         throw std::runtime_error("libjpeg-turbo image decompression failed");
 
     return std::make_pair(std::move(decodedData), header.subsampling);
 }
 
+void ImageJpegDecompressor::decompressToYUV(const QByteArray& jpegData,
+                                            uint8_t* const planes[3],
+                                            const size_t pitches[3])
+{
+    const auto header = decompressHeader(jpegData);
+    int strides[3] = {int(pitches[0]), int(pitches[1]), int(pitches[2])};
+    const int flags = 0;
+
+    int err = tjDecompressToYUVPlanes(_tjHandle,
+                                      (unsigned char*)jpegData.data(),
+                                      (unsigned long)jpegData.size(),
+                                      (unsigned char**)planes, header.width,
+                                      strides, header.height, flags);
+    if (err != 0)
+        throw std::runtime_error("libjpeg-turbo image decompression failed");
+}
+
 #endif
 }
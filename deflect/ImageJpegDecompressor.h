@@ -48,6 +48,8 @@
 
 #include <QByteArray>
 
+#include <cstdint>
+
 namespace deflect
 {
 /**
@@ -87,6 +89,40 @@ public:
      */
     DEFLECT_API QByteArray decompress(const QByteArray& jpegData);
 
+    /**
+     * Find the scaling factor to decompress a Jpeg image at a reduced size.
+     *
+     * @param scale The target scale, in ]0, 1]
+     * @return The smallest scaling factor supported by libjpeg-turbo which is
+     *         not below the target scale (at most 1/1).
+     */
+    DEFLECT_API static tjscalingfactor findScalingFactor(double scale);
+
+    /**
+     * Decompress a Jpeg image at a reduced size, skipping part of the IDCT.
+     *
+     * @param jpegData The compressed Jpeg data
+     * @param factor The scaling factor, see findScalingFactor(). The
+     *        dimensions of the decompressed image are TJSCALED() accordingly.
+     * @return The decompressed image data in (GL_)RGBA format
+     * @throw std::runtime_error if a decompression error occured
+     */
+    DEFLECT_API QByteArray decompress(const QByteArray& jpegData,
+                                      const tjscalingfactor& factor);
+
+    /**
+     * Decompress a Jpeg image into a caller-provided buffer.
+     *
+     * @param jpegData The compressed Jpeg data
+     * @param dst The destination of the top-left (GL_)RGBA pixel, which must
+     *        have room for the height * pitch bytes of the image.
+     * @param pitch The number of bytes between two rows of dst, at least
+     *        4 * width.
+     * @throw std::runtime_error if a decompression error occured
+     */
+    DEFLECT_API void decompress(const QByteArray& jpegData, uint8_t* dst,
+                                size_t pitch);
+
 #ifndef DEFLECT_USE_LEGACY_LIBJPEGTURBO
 
     using YUVData = std::pair<QByteArray, ChromaSubsampling>;
@@ -100,11 +136,39 @@ public:
      */
     DEFLECT_API YUVData decompressToYUV(const QByteArray& jpegData);
 
+    /**
+     * Decompress a Jpeg image to YUV at a reduced size.
+     *
+     * @param jpegData The compressed Jpeg data
+     * @param factor The scaling factor, see findScalingFactor().
+     * @return The decompressed image data in YUV format
+     * @throw std::runtime_error if a decompression error occured
+     */
+    DEFLECT_API YUVData decompressToYUV(const QByteArray& jpegData,
+                                        const tjscalingfactor& factor);
+
+    /**
+     * Decompress a Jpeg image to YUV into caller-provided planes.
+     *
+     * @param jpegData The compressed Jpeg data
+     * @param planes The destinations of the Y, U and V planes, whose
+     *        dimensions depend on the subsampling of the image.
+     * @param pitches The number of bytes between two rows of each plane.
+     * @throw std::runtime_error if a decompression error occured
+     * @see decompressHeader()
+     */
+    DEFLECT_API void decompressToYUV(const QByteArray& jpegData,
+                                     uint8_t* const planes[3],
+                                     const size_t pitches[3]);
+
 #endif
 
 private:
     /** libjpeg-turbo handle for decompression */
     tjhandle _tjHandle;
+
+    void _decompress(const QByteArray& jpegData, int width, int height,
+                     uint8_t* dst, size_t pitch);
 };
 }
 
@@ -41,6 +41,7 @@
 #include "ImageSegmenter.h"
 
 #include "ImageWrapper.h"
+#include "Trace.h"
 #ifdef DEFLECT_USE_LIBJPEGTURBO
 #include "ImageJpegCompressor.h"
 #endif
@@ -48,8 +49,14 @@
 #include <QThreadStorage>
 #include <QtConcurrentMap>
 
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace deflect
 {
@@ -60,10 +67,96 @@ bool _isOnRightSideOfSideBySideImage(const Segment& segment)
     return segment.sourceImage->view == View::side_by_side &&
            segment.view == View::right_eye;
 }
+
+#ifdef DEFLECT_USE_LIBJPEGTURBO
+// @return true if the size bytes of data and pattern are equal
+bool _isEqual(const uint8_t* data, const uint8_t* pattern, const size_t size)
+{
+    size_t i = 0;
+#ifdef __SSE2__
+    for (; i + 16 <= size; i += 16)
+    {
+        const auto a = _mm_loadu_si128((const __m128i*)(data + i));
+        const auto b = _mm_loadu_si128((const __m128i*)(pattern + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) != 0xFFFF)
+            return false;
+    }
+#endif
+    return std::memcmp(data + i, pattern + i, size - i) == 0;
+}
+
+const uint8_t* _getPixel(const ImageWrapper& image, const QRect& region)
+{
+    // assume imageBuffer isn't padded
+    const auto bytesPerPixel = image.getBytesPerPixel();
+    const size_t offset = region.y() * image.width * bytesPerPixel +
+                          region.x() * bytesPerPixel;
+    return (const uint8_t*)image.data + offset;
+}
+
+bool _isUniform(const ImageWrapper& image, const QRect& region)
+{
+    const auto bytesPerPixel = image.getBytesPerPixel();
+    const size_t imagePitch = image.width * bytesPerPixel;
+    const size_t rowSize = region.width() * bytesPerPixel;
+    const auto first = _getPixel(image, region);
+
+    // Every row must match a row made of the first pixel
+    std::vector<uint8_t> pattern(rowSize);
+    for (size_t i = 0; i < rowSize; i += bytesPerPixel)
+        std::memcpy(pattern.data() + i, first, bytesPerPixel);
+
+    for (int y = 0; y < region.height(); ++y)
+    {
+        if (!_isEqual(first + y * imagePitch, pattern.data(), rowSize))
+            return false;
+    }
+    return true;
+}
+
+struct ChannelOffsets
+{
+    int red;
+    int green;
+    int blue;
+};
+
+ChannelOffsets _getChannelOffsets(const PixelFormat format)
+{
+    switch (format)
+    {
+    case ARGB:
+        return {1, 2, 3};
+    case BGR:
+    case BGRA:
+        return {2, 1, 0};
+    case ABGR:
+        return {3, 2, 1};
+    case RGB:
+    case RGBA:
+    default:
+        return {0, 1, 2};
+    }
+}
+
+// RGBA colour of the region followed by the chroma subsampling of the image
+QByteArray _makeFillData(const ImageWrapper& image, const QRect& region)
+{
+    const auto pixel = _getPixel(image, region);
+    const auto offsets = _getChannelOffsets(image.pixelFormat);
+
+    // Alpha is opaque, as for the decoded jpeg segments
+    const char data[] = {char(pixel[offsets.red]), char(pixel[offsets.green]),
+                         char(pixel[offsets.blue]), char(255),
+                         char(image.subsampling)};
+    return QByteArray(data, sizeof(data));
+}
+#endif
 }
 
 bool ImageSegmenter::generate(const ImageWrapper& image, const Handler& handler)
 {
+    DEFLECT_TRACE_SCOPE("ImageSegmenter::generate");
     if (image.compressionPolicy == COMPRESSION_ON)
         return _generateJpeg(image, handler);
     return _generateRaw(image, handler);
@@ -76,6 +169,11 @@ void ImageSegmenter::setNominalSegmentDimensions(const uint width,
     _nominalSegmentHeight = height;
 }
 
+void ImageSegmenter::setUniformTileDetection(const bool enable)
+{
+    _uniformTileDetection = enable;
+}
+
 bool ImageSegmenter::_generateJpeg(const ImageWrapper& image,
                                    const Handler& handler)
 {
@@ -111,6 +209,7 @@ bool ImageSegmenter::_generateJpeg(const ImageWrapper& image,
 void ImageSegmenter::_computeJpeg(Segment& segment)
 {
 #ifdef DEFLECT_USE_LIBJPEGTURBO
+    DEFLECT_TRACE_SCOPE("ImageSegmenter::computeJpeg");
     QRect imageRegion(segment.parameters.x - segment.sourceImage->x,
                       segment.parameters.y - segment.sourceImage->y,
                       segment.parameters.width, segment.parameters.height);
@@ -118,6 +217,14 @@ void ImageSegmenter::_computeJpeg(Segment& segment)
     if (_isOnRightSideOfSideBySideImage(segment))
         imageRegion.translate(segment.sourceImage->width / 2, 0);
 
+    if (_uniformTileDetection && _isUniform(*segment.sourceImage, imageRegion))
+    {
+        segment.imageData = _makeFillData(*segment.sourceImage, imageRegion);
+        segment.parameters.dataType = DataType::fill;
+        _sendQueue.enqueue(segment);
+        return;
+    }
+
     // turbojpeg handles need to be per thread, and this function is called from
     // multiple threads by QtConcurrent::map
     static QThreadStorage<ImageJpegCompressor> compressor;
@@ -91,6 +91,17 @@ public:
      */
     DEFLECT_API void setNominalSegmentDimensions(uint width, uint height);
 
+    /**
+     * Enable the detection of uniform tiles in compressed images.
+     *
+     * The segments of a single colour are then sent as DataType::fill instead
+     * of being compressed, saving encoding, bandwidth and decoding.
+     *
+     * @param enable true to detect uniform tiles (default: false)
+     * @version 1.7
+     */
+    DEFLECT_API void setUniformTileDetection(bool enable);
+
 private:
     struct SegmentationInfo
     {
@@ -115,6 +126,7 @@ private:
 
     uint _nominalSegmentWidth = 0;
     uint _nominalSegmentHeight = 0;
+    bool _uniformTileDetection = false;
 
     MTQueue<Segment> _sendQueue;
 };
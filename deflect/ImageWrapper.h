@@ -41,6 +41,7 @@
 #define DEFLECT_IMAGEWRAPPER_H
 
 #include <cstddef>
+#include <cstdint>
 #include <deflect/api.h>
 #include <deflect/types.h>
 
@@ -129,6 +130,17 @@ struct ImageWrapper
                                               @version 1.0 */
     ChromaSubsampling subsampling;       /**< Chrominance sub-sampling.
                                               (default: YUV444). @version 1.6 */
+
+    /**
+     * Send the uniform tiles of a compressed image as DataType::fill segments
+     * instead of compressing them (default: false).
+     *
+     * Only to be enabled if the receiving application handles fill segments,
+     * i.e. decodes the frames with a SegmentDecoder or lets the Server decode
+     * them on arrival.
+     * @version 1.7
+     */
+    bool uniformTileDetection = false;
     //@}
 
     /**
@@ -137,6 +149,16 @@ struct ImageWrapper
      */
     View view = View::mono;
 
+    /**
+     * The time at which the image was captured, in microseconds of
+     * FrameTimestamps::getTimeUs(). If negative (default), the time at which
+     * the image is sent is used instead.
+     *
+     * The capture time of a frame is the earliest of its images.
+     * @version 1.7
+     */
+    int64_t captureTimeUs = -1;
+
     /**
      * Get the number of bytes per pixel based on the pixelFormat.
      * @version 1.0
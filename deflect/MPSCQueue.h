@@ -0,0 +1,120 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#ifndef DEFLECT_MPSCQUEUE_H
+#define DEFLECT_MPSCQUEUE_H
+
+#include <atomic>
+#include <utility>
+
+namespace deflect
+{
+/**
+ * Lock-free multiple producer, single consumer queue.
+ *
+ * Intrusive linked list of nodes (D. Vyukov's algorithm): a push is a single
+ * atomic exchange, a pop does not need any atomic read-modify-write. A value
+ * is only visible to the consumer once its push has fully completed, so pop()
+ * may miss values whose push() is concurrently in progress.
+ */
+template <class T>
+class MPSCQueue
+{
+public:
+    MPSCQueue()
+        : _head(new Node)
+        , _tail(_head.load())
+    {
+    }
+
+    ~MPSCQueue()
+    {
+        T value;
+        while (pop(value))
+        {
+        }
+        delete _tail;
+    }
+
+    /** Push a new value to the end of the queue. Thread-safe. */
+    void push(T value)
+    {
+        auto node = new Node(std::move(value));
+        auto previous = _head.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    /**
+     * Pop a value from the front of the queue, to be called from the single
+     * consumer thread only.
+     * @return false if the queue is empty.
+     */
+    bool pop(T& value)
+    {
+        Node* tail = _tail;
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (!next)
+            return false;
+
+        value = std::move(next->value);
+        _tail = next;
+        delete tail;
+        return true;
+    }
+
+private:
+    MPSCQueue(const MPSCQueue&) = delete;
+    MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+    struct Node
+    {
+        Node() = default;
+        explicit Node(T&& value_)
+            : value(std::move(value_))
+        {
+        }
+        std::atomic<Node*> next{nullptr};
+        T value;
+    };
+
+    std::atomic<Node*> _head;
+    Node* _tail;
+};
+}
+
+#endif
@@ -67,7 +67,9 @@ enum MessageType
     MESSAGE_TYPE_QUIT = 12,
     MESSAGE_TYPE_SIZE_HINTS = 13,
     MESSAGE_TYPE_DATA = 14,
-    MESSAGE_TYPE_IMAGE_VIEW = 15
+    MESSAGE_TYPE_IMAGE_VIEW = 15,
+    MESSAGE_TYPE_EVENT_BATCH = 16,
+    MESSAGE_TYPE_EVENT_BATCH_COMPACT = 17
 };
 
 #define MESSAGE_HEADER_URI_LENGTH 64
@@ -39,6 +39,9 @@
 
 #include "ReceiveBuffer.h"
 
+#include "DecodeTask.h"
+
+#include <algorithm>
 #include <cassert>
 namespace
 {
@@ -77,7 +80,8 @@ void ReceiveBuffer::insert(const Segment& segment, const size_t sourceIndex)
     _sourceBuffers[sourceIndex].insert(segment);
 }
 
-void ReceiveBuffer::finishFrameForSource(const size_t sourceIndex)
+void ReceiveBuffer::finishFrameForSource(const size_t sourceIndex,
+                                         FrameTimestamps timestamps)
 {
     assert(_sourceBuffers.count(sourceIndex));
 
@@ -88,7 +92,9 @@ void ReceiveBuffer::finishFrameForSource(const size_t sourceIndex)
     if (buffer.isBackFrameEmpty())
         throw std::runtime_error("client sent finish frame without image data");
 
-    buffer.push();
+    timestamps.completeUs = FrameTimestamps::getTimeUs();
+    buffer.push(timestamps);
+    _dropExcessFrames();
 }
 
 bool ReceiveBuffer::hasCompleteFrame() const
@@ -105,6 +111,88 @@ bool ReceiveBuffer::hasCompleteFrame() const
     return true;
 }
 
+size_t ReceiveBuffer::getCompleteFrameCount() const
+{
+    if (_sourceBuffers.empty())
+        return 0;
+
+    // Frames are complete up to the index reached by all sources
+    auto minIndex = _sourceBuffers.begin()->second.getBackFrameIndex();
+    for (const auto& kv : _sourceBuffers)
+        minIndex = std::min(minIndex, kv.second.getBackFrameIndex());
+
+    if (minIndex <= _lastFrameComplete)
+        return 0;
+    return minIndex - _lastFrameComplete;
+}
+
+void ReceiveBuffer::setMaxCompleteFrames(const size_t count)
+{
+    _maxCompleteFrames = count;
+    _dropExcessFrames();
+}
+
+size_t ReceiveBuffer::getMaxCompleteFrames() const
+{
+    return _maxCompleteFrames;
+}
+
+size_t ReceiveBuffer::getDroppedFrameCount() const
+{
+    return _droppedFrameCount;
+}
+
+bool ReceiveBuffer::dropFrame()
+{
+    if (!hasCompleteFrame())
+        return false;
+
+    for (const auto& segment : popFrame())
+        if (segment.decodeTask)
+            segment.decodeTask->cancelled = true;
+    ++_droppedFrameCount;
+    return true;
+}
+
+size_t ReceiveBuffer::getByteCount() const
+{
+    size_t byteCount = 0;
+    for (const auto& kv : _sourceBuffers)
+        byteCount += kv.second.getByteCount();
+    return byteCount;
+}
+
+size_t ReceiveBuffer::getByteCount(const size_t sourceIndex) const
+{
+    const auto it = _sourceBuffers.find(sourceIndex);
+    return it != _sourceBuffers.end() ? it->second.getByteCount() : 0;
+}
+
+FrameTimestamps ReceiveBuffer::getFrameTimestamps() const
+{
+    const auto earliest = [](const int64_t a, const int64_t b) {
+        return a < 0 ? b : (b < 0 ? a : std::min(a, b));
+    };
+
+    FrameTimestamps merged;
+    bool first = true;
+    for (const auto& kv : _sourceBuffers)
+    {
+        const auto& buffer = kv.second;
+        if (buffer.getBackFrameIndex() <= _lastFrameComplete)
+            continue;
+
+        const auto& timestamps = buffer.getTimestamps();
+        if (first)
+            merged.index = timestamps.index;
+        first = false;
+        merged.captureUs = earliest(merged.captureUs, timestamps.captureUs);
+        merged.arrivalUs = earliest(merged.arrivalUs, timestamps.arrivalUs);
+        merged.completeUs = std::max(merged.completeUs, timestamps.completeUs);
+    }
+    return merged;
+}
+
 Segments ReceiveBuffer::popFrame()
 {
     Segments frame;
@@ -131,4 +219,13 @@ bool ReceiveBuffer::isAllowedToSend() const
 {
     return _allowedToSend;
 }
+
+void ReceiveBuffer::_dropExcessFrames()
+{
+    if (_maxCompleteFrames == 0)
+        return;
+
+    while (getCompleteFrameCount() > _maxCompleteFrames)
+        dropFrame();
+}
 }
@@ -56,7 +56,8 @@ namespace deflect
  * Buffer Segments from (multiple) sources.
  *
  * The buffer aggregates segments coming from different sources and delivers
- * complete frames.
+ * complete frames. It can be limited to a maximum number of complete frames,
+ * in which case the oldest ones are dropped.
  */
 class ReceiveBuffer
 {
@@ -88,14 +89,65 @@ public:
 
     /**
      * Call when the source has finished sending segments for the current frame.
+     *
+     * If this completes a frame beyond the maximum number of complete frames,
+     * the oldest complete frame is dropped.
+     *
      * @param sourceIndex Unique source identifier
-     * @throw std::runtime_error if the buffer exceeds its maximum size
+     * @param timestamps of the frame for this source, its completion time is
+     *        set by this function
+     * @throw std::runtime_error if the buffer exceeds its maximum size, which
+     *        only happens if the source is far ahead of the other sources or
+     *        if the number of complete frames is not limited.
+     * @see setMaxCompleteFrames()
      */
-    DEFLECT_API void finishFrameForSource(size_t sourceIndex);
+    DEFLECT_API void finishFrameForSource(
+        size_t sourceIndex, FrameTimestamps timestamps = FrameTimestamps());
 
     /** Does the Buffer have a new complete frame (from all sources) */
     DEFLECT_API bool hasCompleteFrame() const;
 
+    /** @return the number of complete frames (from all sources). */
+    DEFLECT_API size_t getCompleteFrameCount() const;
+
+    /**
+     * Set the maximum number of complete frames kept in the buffer.
+     *
+     * The frames are dropped for all the sources at once, so that they stay
+     * consistent. The pending decodings of the dropped segments are cancelled.
+     *
+     * @param count the maximum number of complete frames, 0 for no limit
+     *        (default).
+     */
+    DEFLECT_API void setMaxCompleteFrames(size_t count);
+
+    /** @return the maximum number of complete frames, 0 if unlimited. */
+    DEFLECT_API size_t getMaxCompleteFrames() const;
+
+    /** @return the number of frames dropped so far. */
+    DEFLECT_API size_t getDroppedFrameCount() const;
+
+    /**
+     * Drop the oldest complete frame, for instance to reduce memory usage.
+     * @return false if there was no complete frame to drop.
+     */
+    DEFLECT_API bool dropFrame();
+
+    /** @return the number of bytes of image data buffered for all sources. */
+    DEFLECT_API size_t getByteCount() const;
+
+    /**
+     * @param sourceIndex Unique source identifier
+     * @return the number of bytes of image data buffered for the source.
+     */
+    DEFLECT_API size_t getByteCount(size_t sourceIndex) const;
+
+    /**
+     * Get the timestamps of the next complete frame, merged from all sources:
+     * the earliest capture and arrival, and the latest completion.
+     */
+    DEFLECT_API FrameTimestamps getFrameTimestamps() const;
+
     /**
      * Get the finished frame.
      * @return A collection of segments that form a frame
@@ -115,6 +167,10 @@ private:
     FrameIndex _lastFrameComplete = 0;
     SourceBufferMap _sourceBuffers;
     bool _allowedToSend = false;
+    size_t _maxCompleteFrames = 0;
+    size_t _droppedFrameCount = 0;
+
+    void _dropExcessFrames();
 };
 }
 
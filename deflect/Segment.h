@@ -44,8 +44,11 @@
 
 #include <QByteArray>
 
+#include <memory>
+
 namespace deflect
 {
+struct DecodeTask;
 struct ImageWrapper;
 
 /**
@@ -63,6 +66,15 @@ struct Segment
 
     /** @internal raw, uncompressed source image, used for compression */
     const ImageWrapper* sourceImage = nullptr;
+
+    /** @internal decoding started on arrival by the Server, if enabled */
+    std::shared_ptr<DecodeTask> decodeTask;
+
+    /**
+     * @internal keeps the imageData alive when it does not own its memory,
+     * e.g. for the segments read from a memory-mapped StreamRecording.
+     */
+    std::shared_ptr<const void> imageDataOwner;
 };
 }
 
@@ -41,7 +41,12 @@
 
 #include "ImageJpegDecompressor.h"
 #include "Segment.h"
+#include "Trace.h"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
 #include <iostream>
 
 #include <QFuture>
@@ -69,8 +74,106 @@ SegmentDecoder::~SegmentDecoder()
 {
 }
 
+const int FILL_DATA_SIZE = 5;
+
+struct Fill
+{
+    uint8_t rgba[4];
+    ChromaSubsampling subsampling;
+};
+
+Fill _readFill(const Segment& segment)
+{
+    const auto data = (const uint8_t*)segment.imageData.constData();
+    if (segment.imageData.size() != FILL_DATA_SIZE ||
+        data[4] > uint8_t(ChromaSubsampling::YUV420))
+    {
+        throw std::runtime_error("invalid fill segment");
+    }
+
+    Fill fill;
+    std::copy(data, data + 4, fill.rgba);
+    fill.subsampling = ChromaSubsampling(data[4]);
+    return fill;
+}
+
+uint8_t _toByte(const double value)
+{
+    return uint8_t(std::min(std::max(std::round(value), 0.0), 255.0));
+}
+
+// Full range Y'CbCr, as used by jpeg
+std::array<uint8_t, 3> _toYUV(const uint8_t rgba[4])
+{
+    const double r = rgba[0];
+    const double g = rgba[1];
+    const double b = rgba[2];
+    return {{_toByte(0.299 * r + 0.587 * g + 0.114 * b),
+             _toByte(128.0 - 0.168736 * r - 0.331264 * g + 0.5 * b),
+             _toByte(128.0 + 0.5 * r - 0.418688 * g - 0.081312 * b)}};
+}
+
+void _fillRGBA(const uint8_t rgba[4], const size_t width, const size_t height,
+               uint8_t* dst, const size_t pitch)
+{
+    // Fill the first row, then copy it to the other ones
+    for (size_t x = 0; x < width; ++x)
+        std::memcpy(dst + x * 4, rgba, 4);
+    for (size_t y = 1; y < height; ++y)
+        std::memcpy(dst + y * pitch, dst, width * 4);
+}
+
+void _fillPlane(const uint8_t value, const size_t width, const size_t height,
+                uint8_t* dst, const size_t pitch)
+{
+    for (size_t y = 0; y < height; ++y)
+        std::memset(dst + y * pitch, value, width);
+}
+
+// Chroma planes are rounded up for odd sizes
+size_t _getChromaWidth(const ChromaSubsampling subsampling, const size_t width)
+{
+    return subsampling == ChromaSubsampling::YUV444 ? width : (width + 1) / 2;
+}
+
+size_t _getChromaHeight(const ChromaSubsampling subsampling,
+                        const size_t height)
+{
+    return subsampling == ChromaSubsampling::YUV420 ? (height + 1) / 2
+                                                    : height;
+}
+
+void _fillYUV(const Fill& fill, const size_t width, const size_t height,
+              uint8_t* const planes[3], const size_t pitches[3])
+{
+    const auto yuv = _toYUV(fill.rgba);
+    const auto chromaWidth = _getChromaWidth(fill.subsampling, width);
+    const auto chromaHeight = _getChromaHeight(fill.subsampling, height);
+    _fillPlane(yuv[0], width, height, planes[0], pitches[0]);
+    _fillPlane(yuv[1], chromaWidth, chromaHeight, planes[1], pitches[1]);
+    _fillPlane(yuv[2], chromaWidth, chromaHeight, planes[2], pitches[2]);
+}
+
+DataType _getDataType(const ChromaSubsampling subsampling)
+{
+    switch (subsampling)
+    {
+    case ChromaSubsampling::YUV444:
+        return DataType::yuv444;
+    case ChromaSubsampling::YUV422:
+        return DataType::yuv422;
+    case ChromaSubsampling::YUV420:
+        return DataType::yuv420;
+    default:
+        throw std::runtime_error("unexpected ChromaSubsampling mode");
+    };
+}
+
 ChromaSubsampling SegmentDecoder::decodeType(const Segment& segment)
 {
+    if (segment.parameters.dataType == DataType::fill)
+        return _readFill(segment).subsampling;
+
     if (segment.parameters.dataType != DataType::jpeg)
         throw std::runtime_error("Segment is not in JPEG format");
 
@@ -81,6 +184,9 @@ size_t _getExpectedSize(const DataType dataType,
                         const SegmentParameters& params)
 {
     const size_t imageSize = params.height * params.width;
+    // Subsampled chroma planes are rounded up for odd (e.g. scaled) sizes
+    const size_t halfWidth = (params.width + 1) / 2;
+    const size_t halfHeight = (params.height + 1) / 2;
     switch (dataType)
     {
     case DataType::rgba:
@@ -88,20 +194,86 @@ size_t _getExpectedSize(const DataType dataType,
     case DataType::yuv444:
         return imageSize * 3;
     case DataType::yuv422:
-        return imageSize * 2;
+        return imageSize + 2 * halfWidth * params.height;
     case DataType::yuv420:
-        return imageSize + (imageSize >> 1);
+        return imageSize + 2 * halfWidth * halfHeight;
     default:
         return 0;
     };
 }
 
+JpegHeader _checkDimensions(ImageJpegDecompressor& decompressor,
+                            const Segment& segment)
+{
+    if (segment.parameters.dataType != DataType::jpeg)
+        throw std::runtime_error("Segment is not in JPEG format");
+
+    const auto header = decompressor.decompressHeader(segment.imageData);
+    if (header.width != int(segment.parameters.width) ||
+        header.height != int(segment.parameters.height))
+    {
+        throw std::runtime_error("unexpected segment size");
+    }
+    return header;
+}
+
+SegmentParameters _scale(SegmentParameters params,
+                         const tjscalingfactor& factor)
+{
+    params.x = TJSCALED(int(params.x), factor);
+    params.y = TJSCALED(int(params.y), factor);
+    params.width = TJSCALED(int(params.width), factor);
+    params.height = TJSCALED(int(params.height), factor);
+    return params;
+}
+
+void _decodeFill(Segment* segment, const bool toYUV,
+                 const tjscalingfactor factor)
+{
+    const auto fill = _readFill(*segment);
+    auto params = _scale(segment->parameters, factor);
+    params.dataType = toYUV ? _getDataType(fill.subsampling) : DataType::rgba;
+
+    const size_t width = params.width;
+    const size_t height = params.height;
+    QByteArray decodedData(int(_getExpectedSize(params.dataType, params)),
+                           Qt::Uninitialized);
+    auto dst = (uint8_t*)decodedData.data();
+    if (toYUV)
+    {
+        const auto chromaSize = _getChromaWidth(fill.subsampling, width) *
+                                _getChromaHeight(fill.subsampling, height);
+        const auto chromaPitch = _getChromaWidth(fill.subsampling, width);
+        uint8_t* const planes[3] = {dst, dst + width * height,
+                                    dst + width * height + chromaSize};
+        const size_t pitches[3] = {width, chromaPitch, chromaPitch};
+        _fillYUV(fill, width, height, planes, pitches);
+    }
+    else
+    {
+        _fillRGBA(fill.rgba, width, height, dst, width * 4);
+    }
+
+    segment->imageData = decodedData;
+    segment->parameters = params;
+}
+
 void _decodeSegment(ImageJpegDecompressor* decompressor, Segment* segment,
-                    const bool skipRgbConversion)
+                    const bool skipRgbConversion,
+                    const tjscalingfactor factor)
 {
+    if (segment->parameters.dataType == DataType::fill)
+    {
+        DEFLECT_TRACE_SCOPE("SegmentDecoder::decodeFill");
+        _decodeFill(segment, skipRgbConversion, factor);
+        return;
+    }
+
     if (segment->parameters.dataType != DataType::jpeg)
         return;
 
+    DEFLECT_TRACE_SCOPE("SegmentDecoder::decode");
+
     QByteArray decodedData;
     DataType dataType;
     try
@@ -109,29 +281,17 @@ void _decodeSegment(ImageJpegDecompressor* decompressor, Segment* segment,
 #ifndef DEFLECT_USE_LEGACY_LIBJPEGTURBO
         if (skipRgbConversion)
         {
-            const auto yuv = decompressor->decompressToYUV(segment->imageData);
+            const auto yuv =
+                decompressor->decompressToYUV(segment->imageData, factor);
             decodedData = yuv.first;
-            switch (yuv.second)
-            {
-            case ChromaSubsampling::YUV444:
-                dataType = DataType::yuv444;
-                break;
-            case ChromaSubsampling::YUV422:
-                dataType = DataType::yuv422;
-                break;
-            case ChromaSubsampling::YUV420:
-                dataType = DataType::yuv420;
-                break;
-            default:
-                throw std::runtime_error("unexpected ChromaSubsampling mode");
-            };
+            dataType = _getDataType(yuv.second);
         }
         else
 #else
         Q_UNUSED(skipRgbConversion);
 #endif
         {
-            decodedData = decompressor->decompress(segment->imageData);
+            decodedData = decompressor->decompress(segment->imageData, factor);
             dataType = DataType::rgba;
         }
     }
@@ -140,24 +300,80 @@ void _decodeSegment(ImageJpegDecompressor* decompressor, Segment* segment,
         throw;
     }
 
-    const auto expectedSize = _getExpectedSize(dataType, segment->parameters);
+    auto params = _scale(segment->parameters, factor);
+    const auto expectedSize = _getExpectedSize(dataType, params);
     if (size_t(decodedData.size()) != expectedSize)
         throw std::runtime_error("unexpected segment size");
 
+    params.dataType = dataType;
     segment->imageData = decodedData;
-    segment->parameters.dataType = dataType;
+    segment->parameters = params;
 }
 
+const tjscalingfactor FULL_SCALE{1, 1};
+
 void SegmentDecoder::decode(Segment& segment)
 {
-    _decodeSegment(&_impl->decompressor, &segment, false);
+    _decodeSegment(&_impl->decompressor, &segment, false, FULL_SCALE);
+}
+
+double SegmentDecoder::decode(Segment& segment, const double scale)
+{
+    const auto factor = ImageJpegDecompressor::findScalingFactor(scale);
+    _decodeSegment(&_impl->decompressor, &segment, false, factor);
+    return double(factor.num) / factor.denom;
+}
+
+void SegmentDecoder::decode(const Segment& segment, uint8_t* dst,
+                            const size_t pitch)
+{
+    DEFLECT_TRACE_SCOPE("SegmentDecoder::decode");
+    if (segment.parameters.dataType == DataType::fill)
+    {
+        _fillRGBA(_readFill(segment).rgba, segment.parameters.width,
+                  segment.parameters.height, dst, pitch);
+        return;
+    }
+    _checkDimensions(_impl->decompressor, segment);
+    _impl->decompressor.decompress(segment.imageData, dst, pitch);
+}
+
+void SegmentDecoder::decodeIntoFrame(const Segment& segment, uint8_t* frame,
+                                     const size_t pitch)
+{
+    const auto& params = segment.parameters;
+    decode(segment, frame + params.y * pitch + params.x * 4, pitch);
 }
 
 #ifndef DEFLECT_USE_LEGACY_LIBJPEGTURBO
 
 void SegmentDecoder::decodeToYUV(Segment& segment)
 {
-    _decodeSegment(&_impl->decompressor, &segment, true);
+    _decodeSegment(&_impl->decompressor, &segment, true, FULL_SCALE);
+}
+
+double SegmentDecoder::decodeToYUV(Segment& segment, const double scale)
+{
+    const auto factor = ImageJpegDecompressor::findScalingFactor(scale);
+    _decodeSegment(&_impl->decompressor, &segment, true, factor);
+    return double(factor.num) / factor.denom;
+}
+
+ChromaSubsampling SegmentDecoder::decodeToYUV(const Segment& segment,
+                                              uint8_t* const planes[3],
+                                              const size_t pitches[3])
+{
+    DEFLECT_TRACE_SCOPE("SegmentDecoder::decodeToYUV");
+    if (segment.parameters.dataType == DataType::fill)
+    {
+        const auto fill = _readFill(segment);
+        _fillYUV(fill, segment.parameters.width, segment.parameters.height,
+                 planes, pitches);
+        return fill.subsampling;
+    }
+    const auto header = _checkDimensions(_impl->decompressor, segment);
+    _impl->decompressor.decompressToYUV(segment.imageData, planes, pitches);
+    return header.subsampling;
 }
 
 #endif
@@ -175,7 +391,7 @@ void SegmentDecoder::startDecoding(Segment& segment)
 
     _impl->decodingFuture =
         QtConcurrent::run(_decodeSegment, &_impl->decompressor, &segment,
-                          false);
+                          false, FULL_SCALE);
 }
 
 void SegmentDecoder::waitDecoding()
@@ -48,6 +48,9 @@ namespace deflect
 {
 /**
  * Decode a Segment's image asynchronously.
+ *
+ * DataType::fill segments are expanded to their uniform colour by all the
+ * decoding functions, at a negligible cost compared to JPEG segments.
  */
 class SegmentDecoder
 {
@@ -76,6 +79,57 @@ public:
      */
     DEFLECT_API void decode(Segment& segment);
 
+    /**
+     * Decode a JPEG segment to RGB at a reduced resolution.
+     *
+     * The segment is decoded at the smallest scaling factor supported by
+     * libjpeg-turbo (multiples of 1/8) which is not below the target scale,
+     * skipping part of the decompression work. All the segments of a frame
+     * decoded with the same scale remain aligned.
+     *
+     * @param segment The segment to decode. Upon success, its imageData member
+     *        will hold the decompressed RGB image, its "dataType" flag will be
+     *        set to DataType::rgba and its geometry will be scaled to match.
+     * @param scale The target scale in ]0, 1], for instance the ratio between
+     *        the size of a window on screen and the size of the stream.
+     * @return The scale which was applied.
+     * @throw std::runtime_error if a decompression error occured
+     * @version 1.7
+     */
+    DEFLECT_API double decode(Segment& segment, double scale);
+
+    /**
+     * Decode a JPEG segment to RGBA into a caller-provided buffer.
+     *
+     * Avoids any allocation and copy when decoding directly to the final
+     * destination, such as a mapped pixel buffer.
+     *
+     * @param segment The segment to decode, which is not modified.
+     * @param dst The destination of the top-left pixel of the segment, with
+     *        room for parameters.height rows of pitch bytes.
+     * @param pitch The number of bytes between two rows of dst, at least
+     *        4 * parameters.width.
+     * @throw std::runtime_error if a decompression error occured or if the
+     *        segment does not have the expected dimensions.
+     * @version 1.7
+     */
+    DEFLECT_API void decode(const Segment& segment, uint8_t* dst,
+                            size_t pitch);
+
+    /**
+     * Decode a JPEG segment to RGBA at its position in a full-frame image.
+     *
+     * @param segment The segment to decode, which is not modified.
+     * @param frame The top-left pixel of an RGBA image of (at least) the
+     *        dimensions of the frame, see Frame::computeDimensions().
+     * @param pitch The number of bytes between two rows of the frame image.
+     * @throw std::runtime_error if a decompression error occured or if the
+     *        segment does not have the expected dimensions.
+     * @version 1.7
+     */
+    DEFLECT_API void decodeIntoFrame(const Segment& segment, uint8_t* frame,
+                                     size_t pitch);
+
 #ifndef DEFLECT_USE_LEGACY_LIBJPEGTURBO
 
     /**
@@ -88,6 +142,35 @@ public:
      */
     DEFLECT_API void decodeToYUV(Segment& segment);
 
+    /**
+     * Decode a JPEG segment to YUV at a reduced resolution.
+     *
+     * @param segment The segment to decode, see decode(Segment&, double).
+     * @param scale The target scale in ]0, 1].
+     * @return The scale which was applied.
+     * @throw std::runtime_error if a decompression error occured
+     * @version 1.7
+     */
+    DEFLECT_API double decodeToYUV(Segment& segment, double scale);
+
+    /**
+     * Decode a JPEG segment to YUV into caller-provided planes.
+     *
+     * The dimensions of the U and V planes depend on the subsampling of the
+     * segment, which can be obtained beforehand with decodeType().
+     *
+     * @param segment The segment to decode, which is not modified.
+     * @param planes The destinations of the Y, U and V planes.
+     * @param pitches The number of bytes between two rows of each plane.
+     * @return The chroma subsampling of the decoded planes.
+     * @throw std::runtime_error if a decompression error occured or if the
+     *        segment does not have the expected dimensions.
+     * @version 1.7
+     */
+    DEFLECT_API ChromaSubsampling decodeToYUV(const Segment& segment,
+                                              uint8_t* const planes[3],
+                                              const size_t pitches[3]);
+
 #endif
 
     /**
@@ -99,6 +182,7 @@ public:
      *        this function. It must remain valid and should not be accessed
      *        until the decoding procedure has completed.
      * @see isRunning()
+     * @see FrameDecoder to decode all the segments of a frame in parallel.
      */
     DEFLECT_API void startDecoding(Segment& segment);
 
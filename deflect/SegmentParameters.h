@@ -60,7 +60,9 @@ enum class DataType : std::uint8_t
     jpeg = 1, // equivalent to old compressed=true property
     yuv444,
     yuv422,
-    yuv420
+    yuv420,
+    fill /**< uniform colour: 4 bytes of RGBA and 1 byte of the image's
+              ChromaSubsampling, expanded by SegmentDecoder. @version 1.7 */
 };
 
 /**
@@ -43,10 +43,21 @@
 #include "FrameDispatcher.h"
 #include "NetworkProtocol.h"
 #include "ServerWorker.h"
+#include "StreamReplayer.h"
+
+#ifdef DEFLECT_USE_LIBJPEGTURBO
+#include "FrameDecoder.h"
+#endif
 
 #include <QNetworkProxy>
+#include <QSaveFile>
 #include <QThread>
+#include <QTimer>
+
+#include <algorithm>
+#include <iostream>
 #include <stdexcept>
+#include <vector>
 
 namespace deflect
 {
@@ -56,6 +67,47 @@ class Server::Impl
 {
 public:
     FrameDispatcher frameDispatcher;
+
+    Decoding decoding = Decoding::none;
+#ifdef DEFLECT_USE_LIBJPEGTURBO
+    /** Decodes on arrival, destroyed before the frameDispatcher it notifies */
+    std::unique_ptr<FrameDecoder> decoder;
+#endif
+
+    /** The I/O threads, each one serving many connections. */
+    std::vector<QThread*> workerThreads;
+
+    /** The number of ServerWorkers in each of the workerThreads. */
+    std::vector<size_t> workerCounts;
+
+    /**
+     * The last replay, possibly running, destroyed before the decoder. The
+     * replayed segments keep the mapping of their recording themselves.
+     */
+    std::unique_ptr<StreamReplayer> replayer;
+    size_t replayCount = 0;
+
+    QTimer metricsTimer;
+    QString metricsFilename;
+
+    void dumpMetrics() const
+    {
+        QSaveFile file(metricsFilename);
+        if (!file.open(QIODevice::WriteOnly) ||
+            file.write(frameDispatcher.getMetrics().toJson()) < 0 ||
+            !file.commit())
+        {
+            std::cerr << "Could not write metrics to: "
+                      << metricsFilename.toStdString() << std::endl;
+        }
+    }
+
+    size_t getLeastLoadedThread() const
+    {
+        const auto it =
+            std::min_element(workerCounts.begin(), workerCounts.end());
+        return std::distance(workerCounts.begin(), it);
+    }
 };
 
 Server::Server(const int port)
@@ -79,6 +131,19 @@ Server::Server(const int port)
             &Server::receivedFrame);
     connect(&_impl->frameDispatcher, &FrameDispatcher::bufferSizeExceeded, this,
             &Server::closePixelStream);
+    connect(&_impl->metricsTimer, &QTimer::timeout,
+            [this] { _impl->dumpMetrics(); });
+
+    // A fixed pool of threads whose event loops multiplex all the connections
+    const auto threadCount = std::max(QThread::idealThreadCount(), 1);
+    for (int i = 0; i < threadCount; ++i)
+    {
+        auto workerThread = new QThread(this);
+        workerThread->setObjectName(QString("DeflectIO#%1").arg(i));
+        workerThread->start();
+        _impl->workerThreads.push_back(workerThread);
+    }
+    _impl->workerCounts.resize(_impl->workerThreads.size(), 0);
 }
 
 Server::~Server()
@@ -98,29 +163,132 @@ void Server::requestFrame(const QString uri)
     _impl->frameDispatcher.requestFrame(uri);
 }
 
+void Server::acknowledgeFrame(const deflect::FramePtr frame)
+{
+    _impl->frameDispatcher.acknowledgeFrame(frame);
+}
+
 void Server::closePixelStream(const QString uri)
 {
     emit _closePixelStream(uri);
     _impl->frameDispatcher.deleteStream(uri);
 }
 
+void Server::setDecoding(const Decoding decoding)
+{
+#ifdef DEFLECT_USE_LIBJPEGTURBO
+#ifdef DEFLECT_USE_LEGACY_LIBJPEGTURBO
+    if (decoding == Decoding::yuv)
+        throw std::runtime_error("YUV decoding requires libjpeg-turbo >= 1.4");
+#endif
+    if (decoding != Decoding::none && !_impl->decoder)
+        _impl->decoder.reset(new FrameDecoder);
+#else
+    if (decoding != Decoding::none)
+        throw std::runtime_error("Deflect was built without libjpeg-turbo");
+#endif
+    _impl->decoding = decoding;
+}
+
+void Server::setMaxBufferedFrames(const size_t count)
+{
+    _impl->frameDispatcher.setMaxBufferedFrames(count);
+}
+
+size_t Server::getDroppedFrameCount(const QString& uri) const
+{
+    return _impl->frameDispatcher.getDroppedFrameCount(uri);
+}
+
+void Server::setMemoryBudget(const size_t bytes)
+{
+    _impl->frameDispatcher.setMemoryBudget(bytes);
+}
+
+size_t Server::getMemoryBudget() const
+{
+    return _impl->frameDispatcher.getMemoryBudget();
+}
+
+size_t Server::getBufferedByteCount() const
+{
+    return _impl->frameDispatcher.getBufferedByteCount();
+}
+
+size_t Server::getBufferedByteCount(const QString& uri) const
+{
+    return _impl->frameDispatcher.getBufferedByteCount(uri);
+}
+
+ServerMetrics Server::getMetrics() const
+{
+    return _impl->frameDispatcher.getMetrics();
+}
+
+void Server::startMetricsDump(const QString& filename, const int intervalMs)
+{
+    _impl->metricsFilename = filename;
+    _impl->metricsTimer.start(intervalMs);
+}
+
+void Server::stopMetricsDump()
+{
+    _impl->metricsTimer.stop();
+}
+
+void Server::startRecording(const QString& filename)
+{
+    _impl->frameDispatcher.startRecording(filename);
+}
+
+void Server::stopRecording()
+{
+    _impl->frameDispatcher.stopRecording();
+}
+
+void Server::replay(const QString& filename, const bool realTime)
+{
+    std::unique_ptr<StreamReplayer> replayer(
+        new StreamReplayer(filename, _impl->frameDispatcher, realTime));
+#ifdef DEFLECT_USE_LIBJPEGTURBO
+    if (_impl->decoding != Decoding::none)
+        replayer->setDecoder(_impl->decoder.get(),
+                             _impl->decoding == Decoding::yuv);
+#endif
+    // The end of a replay is queued to this thread: ignore it if the replay
+    // was replaced in the meantime, its listeners expect the new one
+    const auto replayIndex = ++_impl->replayCount;
+    connect(replayer.get(), &QThread::finished, this, [this, replayIndex] {
+        if (replayIndex == _impl->replayCount)
+            emit replayFinished();
+    });
+
+    _impl->replayer = std::move(replayer); // stops the previous replay
+    _impl->replayer->start();
+}
+
 void Server::incomingConnection(const qintptr socketHandle)
 {
-    QThread* workerThread = new QThread(this);
-    ServerWorker* worker = new ServerWorker(socketHandle);
+    const size_t threadIndex = _impl->getLeastLoadedThread();
+    QThread* workerThread = _impl->workerThreads[threadIndex];
+    auto worker = new ServerWorker(socketHandle, _impl->frameDispatcher);
+#ifdef DEFLECT_USE_LIBJPEGTURBO
+    if (_impl->decoding != Decoding::none)
+        worker->setDecoder(_impl->decoder.get(),
+                           _impl->decoding == Decoding::yuv);
+#endif
 
     worker->moveToThread(workerThread);
+    ++_impl->workerCounts[threadIndex];
 
-    connect(workerThread, &QThread::started, worker,
-            &ServerWorker::initConnection);
-    connect(worker, &ServerWorker::connectionClosed, workerThread,
-            &QThread::quit);
+    connect(worker, &ServerWorker::connectionClosed, worker,
+            &ServerWorker::deleteLater);
+    connect(worker, &ServerWorker::destroyed, this,
+            [this, threadIndex] { --_impl->workerCounts[threadIndex]; });
 
-    // Make sure the thread will be deleted
+    // Make sure the worker will be deleted if the server stops first
     connect(workerThread, &QThread::finished, worker,
             &ServerWorker::deleteLater);
-    connect(workerThread, &QThread::finished, workerThread,
-            &QThread::deleteLater);
 
     // public signals/slots, forwarding from/to worker
     connect(worker, &ServerWorker::registerToEvents, this,
@@ -131,16 +299,6 @@ void Server::incomingConnection(const qintptr socketHandle)
     connect(this, &Server::_closePixelStream, worker,
             &ServerWorker::closeConnection);
 
-    // FrameDispatcher
-    connect(worker, &ServerWorker::addStreamSource, &_impl->frameDispatcher,
-            &FrameDispatcher::addSource);
-    connect(worker, &ServerWorker::receivedSegment, &_impl->frameDispatcher,
-            &FrameDispatcher::processSegment);
-    connect(worker, &ServerWorker::receivedFrameFinished,
-            &_impl->frameDispatcher, &FrameDispatcher::processFrameFinished);
-    connect(worker, &ServerWorker::removeStreamSource, &_impl->frameDispatcher,
-            &FrameDispatcher::removeSource);
-
-    workerThread->start();
+    QMetaObject::invokeMethod(worker, "initConnection", Qt::QueuedConnection);
 }
 }
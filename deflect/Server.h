@@ -41,6 +41,7 @@
 #ifndef DEFLECT_SERVER_H
 #define DEFLECT_SERVER_H
 
+#include <deflect/ServerMetrics.h>
 #include <deflect/SizeHints.h>
 #include <deflect/api.h>
 #include <deflect/types.h>
@@ -56,6 +57,9 @@ namespace deflect
  *
  * The server integrates a flow-control mechanism to ensure that new frames are
  * dispatched only as fast as the application is capable of processing them.
+ *
+ * Connections are served by a fixed pool of threads (one per core), each new
+ * connection being assigned to the thread which has the fewest.
  */
 class DEFLECT_API Server : public QTcpServer
 {
@@ -76,6 +80,147 @@ public:
     /** Stop the server and close all open pixel stream connections. */
     ~Server();
 
+    /** Decoding of the JPEG segments by the server, see setDecoding(). */
+    enum class Decoding
+    {
+        none, //!< segments are dispatched as received (default)
+        rgba, //!< segments are decoded to DataType::rgba on arrival
+        yuv   //!< segments are decoded to DataType::yuv4** on arrival
+    };
+
+    /**
+     * Decode the JPEG segments as soon as they are received.
+     *
+     * Each segment is decoded on a pool of threads while the rest of its frame
+     * is still being received. The frames are emitted by receivedFrame() once
+     * all their segments are decoded, the decoding of superseded frames being
+     * cancelled. Segments which fail to decode are left compressed.
+     *
+     * This setting applies to the streams which connect afterwards.
+     *
+     * @param decoding the decoding to apply.
+     * @throw std::runtime_error if decoding is requested but Deflect was built
+     *        without libjpeg-turbo, or YUV is not supported by libjpeg-turbo.
+     * @version 1.7
+     */
+    void setDecoding(Decoding decoding);
+
+    /**
+     * Set the maximum number of complete frames buffered for each stream.
+     *
+     * When a stream produces frames faster than they are requested, the
+     * oldest complete frames are dropped beyond this limit instead of
+     * accumulating. The default of one frame only keeps the latest frame,
+     * which is the one dispatched by receivedFrame().
+     *
+     * @param count the maximum number of frames, 0 for no limit (the stream
+     *        is then closed after a few seconds worth of buffered frames).
+     * @version 1.7
+     */
+    void setMaxBufferedFrames(size_t count);
+
+    /**
+     * @param uri Identifier for the stream
+     * @return the number of frames dropped for a stream since it was opened.
+     * @version 1.7
+     */
+    size_t getDroppedFrameCount(const QString& uri) const;
+
+    /**
+     * Set the maximum memory used by the frames buffered for all streams.
+     *
+     * When the budget is exceeded, the oldest complete frames of the streams
+     * using the most memory are dropped. If that is not sufficient, because
+     * only frames still being received by the sources remain, the stream
+     * using the most memory is closed.
+     *
+     * The memory counts the compressed image data received and, if decoding
+     * is enabled, the decoded images. Image data memory-mapped from a
+     * recording being replayed is not counted.
+     *
+     * @param bytes the budget in bytes of image data, 0 for no limit
+     *        (default).
+     * @version 1.7
+     */
+    void setMemoryBudget(size_t bytes);
+
+    /** @return the memory budget in bytes, 0 if unlimited. @version 1.7 */
+    size_t getMemoryBudget() const;
+
+    /**
+     * @return the bytes of image data currently buffered for all streams.
+     * @see setMemoryBudget() for what is counted
+     * @version 1.7
+     */
+    size_t getBufferedByteCount() const;
+
+    /**
+     * @param uri Identifier for the stream
+     * @return the bytes of image data currently buffered for the stream.
+     * @version 1.7
+     */
+    size_t getBufferedByteCount(const QString& uri) const;
+
+    /**
+     * @return a snapshot of the throughput, buffering and latency metrics of
+     *         all the open streams.
+     * @version 1.7
+     */
+    ServerMetrics getMetrics() const;
+
+    /**
+     * Periodically write the metrics to a file, as JSON.
+     *
+     * The file is replaced atomically, so it can be polled by monitoring tools
+     * at any time. A previously started dump is replaced.
+     *
+     * @param filename the file to write
+     * @param intervalMs the interval between two writes, in milliseconds
+     * @version 1.7
+     */
+    void startMetricsDump(const QString& filename, int intervalMs = 1000);
+
+    /** Stop writing the metrics to a file. @version 1.7 */
+    void stopMetricsDump();
+
+    /**
+     * Record the streams received from now on, as they arrive.
+     *
+     * The segments are written in their received encoding, without decoding,
+     * along with their source and timestamps. A previous recording is stopped.
+     *
+     * The recording is written from a separate thread. If the disk is too
+     * slow, the frames which do not fit in the queue of the writer are
+     * dropped from the recording, which is reported on the standard error.
+     *
+     * @param filename the StreamRecording to create
+     * @throw std::runtime_error if the file cannot be created
+     * @version 1.7
+     */
+    void startRecording(const QString& filename);
+
+    /** Stop recording the streams. @version 1.7 */
+    void stopRecording();
+
+    /**
+     * Replay a StreamRecording as if its streams were received by the Server.
+     *
+     * The records are replayed from a separate thread, without network. Their
+     * segments are decoded on arrival according to setDecoding(). A previous
+     * replay is stopped, without emitting replayFinished(), which is only
+     * emitted at the end of the last replay started.
+     *
+     * The image data of the replayed segments reference the memory-mapped
+     * recording, which stays mapped as long as they exist.
+     *
+     * @param filename the StreamRecording to replay
+     * @param realTime true to respect the original timing, false to replay as
+     *        fast as the frames are processed, with a few frames in flight
+     * @throw std::runtime_error if the recording cannot be opened
+     * @version 1.7
+     */
+    void replay(const QString& filename, bool realTime = true);
+
 public slots:
     /**
      * Request the dispatching of the next frame for a given pixel stream.
@@ -90,6 +235,17 @@ public slots:
      */
     void requestFrame(QString uri);
 
+    /**
+     * Notify that a received frame was consumed, i.e. rendered.
+     *
+     * This completes the latency measurements of the frame, available in the
+     * dispatchToAck and captureToAck metrics.
+     *
+     * @param frame a frame previously emitted by receivedFrame()
+     * @version 1.7
+     */
+    void acknowledgeFrame(deflect::FramePtr frame);
+
     /**
      * Close a pixel stream, disconnecting the remote client.
      *
@@ -118,6 +274,11 @@ signals:
      * This signal is only emitted after the application signals that it is
      * ready to handle a new frame by calling requestFrame().
      *
+     * Unless they are decoded on arrival (see setDecoding()), the frames may
+     * contain DataType::fill segments of a single colour, sent for the
+     * uniform tiles of images with ImageWrapper::uniformTileDetection. They
+     * are expanded by SegmentDecoder like the compressed segments.
+     *
      * @param frame The latest frame that was received for a stream.
      */
     void receivedFrame(deflect::FramePtr frame);
@@ -150,6 +311,12 @@ signals:
      */
     void receivedData(QString uri, QByteArray data);
 
+    /**
+     * Emitted when the last replay() has finished, not for a replay stopped
+     * by a newer one. @version 1.7
+     */
+    void replayFinished();
+
 private:
     class Impl;
     std::unique_ptr<Impl> _impl;
@@ -0,0 +1,156 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#include "ServerMetrics.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+#include <cmath>
+
+namespace deflect
+{
+namespace
+{
+QJsonObject _toJson(const LatencyHistogram& histogram)
+{
+    QJsonArray buckets;
+    for (const auto count : histogram.buckets)
+        buckets.append(double(count));
+
+    QJsonObject object;
+    object["count"] = double(histogram.count);
+    object["meanUs"] = histogram.getMean();
+    object["p50Us"] = histogram.getPercentile(50.0);
+    object["p99Us"] = histogram.getPercentile(99.0);
+    object["maxUs"] = histogram.maxUs;
+    object["buckets"] = buckets;
+    return object;
+}
+
+QJsonObject _toJson(const SourceMetrics& source)
+{
+    QJsonObject object;
+    object["sourceIndex"] = double(source.sourceIndex);
+    object["bytesReceived"] = double(source.bytesReceived);
+    object["segmentsReceived"] = double(source.segmentsReceived);
+    object["framesReceived"] = double(source.framesReceived);
+    object["bytesPerSecond"] = source.bytesPerSecond;
+    object["segmentsPerSecond"] = source.segmentsPerSecond;
+    object["framesPerSecond"] = source.framesPerSecond;
+    object["bufferedBytes"] = double(source.bufferedBytes);
+    return object;
+}
+
+QJsonObject _toJson(const StreamMetrics& stream)
+{
+    QJsonArray sources;
+    for (const auto& source : stream.sources)
+        sources.append(_toJson(source));
+
+    QJsonObject object;
+    object["uri"] = stream.uri;
+    object["bytesReceived"] = double(stream.bytesReceived);
+    object["segmentsReceived"] = double(stream.segmentsReceived);
+    object["framesDispatched"] = double(stream.framesDispatched);
+    object["framesDropped"] = double(stream.framesDropped);
+    object["bytesPerSecond"] = stream.bytesPerSecond;
+    object["segmentsPerSecond"] = stream.segmentsPerSecond;
+    object["framesPerSecond"] = stream.framesPerSecond;
+    object["bufferedFrames"] = double(stream.bufferedFrames);
+    object["bufferedBytes"] = double(stream.bufferedBytes);
+    object["readyLatency"] = _toJson(stream.readyLatency);
+    object["captureToArrival"] = _toJson(stream.captureToArrival);
+    object["arrivalToComplete"] = _toJson(stream.arrivalToComplete);
+    object["completeToDispatch"] = _toJson(stream.completeToDispatch);
+    object["dispatchToAck"] = _toJson(stream.dispatchToAck);
+    object["captureToAck"] = _toJson(stream.captureToAck);
+    object["sources"] = sources;
+    return object;
+}
+}
+
+void LatencyHistogram::add(const double us)
+{
+    size_t bucket = 0;
+    while (bucket + 1 < buckets.size() && us >= std::ldexp(1.0, bucket))
+        ++bucket;
+    ++buckets[bucket];
+
+    ++count;
+    sumUs += us;
+    maxUs = std::max(maxUs, us);
+}
+
+double LatencyHistogram::getMean() const
+{
+    return count > 0 ? sumUs / count : 0.0;
+}
+
+double LatencyHistogram::getPercentile(const double percentile) const
+{
+    if (count == 0)
+        return 0.0;
+
+    const double rank = percentile / 100.0 * count;
+    uint64_t cumulated = 0;
+    for (size_t i = 0; i < buckets.size(); ++i)
+    {
+        cumulated += buckets[i];
+        if (cumulated >= rank && cumulated > 0 && i + 1 < buckets.size())
+            return std::min(std::ldexp(1.0, i), maxUs);
+    }
+    return maxUs;
+}
+
+QByteArray ServerMetrics::toJson() const
+{
+    QJsonArray streamArray;
+    for (const auto& stream : streams)
+        streamArray.append(_toJson(stream));
+
+    QJsonObject object;
+    object["bufferedBytes"] = double(bufferedBytes);
+    object["memoryBudget"] = double(memoryBudget);
+    object["pooledBytes"] = double(pooledBytes);
+    object["streams"] = streamArray;
+    return QJsonDocument(object).toJson(QJsonDocument::Indented);
+}
+}
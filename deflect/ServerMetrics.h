@@ -0,0 +1,185 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#ifndef DEFLECT_SERVERMETRICS_H
+#define DEFLECT_SERVERMETRICS_H
+
+#include <deflect/api.h>
+#include <deflect/types.h>
+
+#include <QByteArray>
+#include <QString>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace deflect
+{
+/**
+ * Distribution of durations, in power-of-two buckets of microseconds.
+ *
+ * @version 1.7
+ */
+struct LatencyHistogram
+{
+    /** Bucket 0 counts durations below 1 us, bucket i those < 2^i us. */
+    std::array<uint64_t, 26> buckets{{}};
+
+    uint64_t count = 0; //!< Number of durations added
+    double sumUs = 0.0; //!< Sum of all the durations
+    double maxUs = 0.0; //!< Longest duration
+
+    /** Add a duration in microseconds. */
+    DEFLECT_API void add(double us);
+
+    /** @return the mean duration in microseconds, 0 if empty. */
+    DEFLECT_API double getMean() const;
+
+    /**
+     * @param percentile in [0, 100]
+     * @return the upper bound of the bucket holding the percentile in
+     *         microseconds, 0 if empty.
+     */
+    DEFLECT_API double getPercentile(double percentile) const;
+};
+
+/**
+ * Metrics of a single source of a stream.
+ *
+ * @version 1.7
+ */
+struct SourceMetrics
+{
+    size_t sourceIndex = 0;
+
+    /** @name Totals since the source was added */
+    //@{
+    uint64_t bytesReceived = 0;
+    uint64_t segmentsReceived = 0;
+    uint64_t framesReceived = 0;
+    //@}
+
+    /** @name Rates over about the last second */
+    //@{
+    double bytesPerSecond = 0.0;
+    double segmentsPerSecond = 0.0;
+    double framesPerSecond = 0.0;
+    //@}
+
+    /** Image data currently buffered for the source. */
+    size_t bufferedBytes = 0;
+};
+
+/**
+ * Metrics of a stream.
+ *
+ * @version 1.7
+ */
+struct StreamMetrics
+{
+    QString uri;
+
+    /** @name Totals since the stream was opened */
+    //@{
+    uint64_t bytesReceived = 0;
+    uint64_t segmentsReceived = 0;
+    uint64_t framesDispatched = 0;
+    uint64_t framesDropped = 0;
+    //@}
+
+    /** @name Rates over about the last second */
+    //@{
+    double bytesPerSecond = 0.0;
+    double segmentsPerSecond = 0.0;
+    double framesPerSecond = 0.0; //!< Dispatched frames
+    //@}
+
+    /** @name Current buffers */
+    //@{
+    size_t bufferedFrames = 0; //!< Complete frames waiting to be dispatched
+    size_t bufferedBytes = 0;
+    //@}
+
+    /**
+     * Time between a frame being requested and its segments being ready,
+     * i.e. waiting for the decodings started on arrival to finish.
+     */
+    LatencyHistogram readyLatency;
+
+    /**
+     * @name Latency breakdown of the frames
+     *
+     * Frames from clients older than protocol 11 carry no capture time and
+     * are not counted in the intervals starting from it.
+     */
+    //@{
+    LatencyHistogram captureToArrival;   //!< Encoding and network
+    LatencyHistogram arrivalToComplete;  //!< Transfer from all the sources
+    LatencyHistogram completeToDispatch; //!< Buffering and decoding
+    LatencyHistogram dispatchToAck;      //!< Rendering, see acknowledgeFrame
+    LatencyHistogram captureToAck;       //!< End-to-end
+    //@}
+
+    std::vector<SourceMetrics> sources;
+};
+
+/**
+ * Snapshot of the metrics of a Server.
+ *
+ * @version 1.7
+ */
+struct ServerMetrics
+{
+    std::vector<StreamMetrics> streams;
+
+    size_t bufferedBytes = 0; //!< Image data buffered for all streams
+    size_t memoryBudget = 0;  //!< See Server::setMemoryBudget()
+
+    /**
+     * Image buffers kept by the connections to receive the next segments,
+     * including those still shared with buffered or dispatched frames.
+     */
+    size_t pooledBytes = 0;
+
+    /** @return the metrics as an indented JSON document. */
+    DEFLECT_API QByteArray toJson() const;
+};
+}
+
+#endif
@@ -40,7 +40,14 @@
 
 #include "ServerWorker.h"
 
+#include "EventBatch.h"
 #include "NetworkProtocol.h"
+#include "Trace.h"
+
+#ifdef DEFLECT_USE_LIBJPEGTURBO
+#include "DecodeTask.h"
+#include "FrameDecoder.h"
+#endif
 
 #include <iostream>
 #include <stdint.h>
@@ -49,17 +56,46 @@
 
 namespace
 {
-const int RECEIVE_TIMEOUT_MS = 3000;
+const int SEND_TIMEOUT_MS = 3000;
+const int BIND_REPLY_POLL_INTERVAL_MS = 1;
+const size_t MAX_IMAGE_BUFFERS = 128;
+const size_t MAX_IMAGE_BUFFER_BYTES = 64 * 1024 * 1024;
+const int FIRST_PROTOCOL_VERSION_WITH_EVENT_BATCH = 9;
+const int FIRST_PROTOCOL_VERSION_WITH_COMPACT_EVENTS = 10;
+const int FINISH_FRAME_MESSAGE_SIZE = 3 * sizeof(qint64);
+
+bool _isSegment(const deflect::MessageHeader& messageHeader)
+{
+    return messageHeader.type == deflect::MESSAGE_TYPE_PIXELSTREAM &&
+           messageHeader.size >= sizeof(deflect::SegmentParameters);
+}
+
+bool _isCoalescable(const deflect::Event& evt)
+{
+    return evt.type == deflect::Event::EVT_MOVE ||
+           evt.type == deflect::Event::EVT_TOUCH_UPDATE;
+}
+
+bool _isSamePoint(const deflect::Event& evt1, const deflect::Event& evt2)
+{
+    // EVT_MOVE refers to the single point of basic interaction while touch
+    // events carry the id of the point in their key field.
+    return evt1.type == evt2.type &&
+           (evt1.type == deflect::Event::EVT_MOVE || evt1.key == evt2.key);
+}
 }
 
 namespace deflect
 {
-ServerWorker::ServerWorker(const int socketDescriptor)
+ServerWorker::ServerWorker(const int socketDescriptor,
+                           FrameDispatcher& frameDispatcher)
     : _tcpSocket{new QTcpSocket(this)} // Ensure that _tcpSocket parent is
                                        // *this* so it gets moved to thread
+    , _frameDispatcher(frameDispatcher)
     , _sourceId{socketDescriptor}
-    , _clientProtocolVersion{NETWORK_PROTOCOL_VERSION}
+    , _clientProtocolVersion{0} // clients < 0.12.1 do not send their version
     , _registeredToEvents{false}
+    , _bindReplyTimer{new QTimer(this)}
     , _activeView{View::mono}
 {
     if (!_tcpSocket->setSocketDescriptor(socketDescriptor))
@@ -77,6 +113,11 @@ ServerWorker::ServerWorker(const int socketDescriptor)
             &ServerWorker::_processMessages, Qt::QueuedConnection);
     connect(this, &ServerWorker::_dataAvailable, this,
             &ServerWorker::_processMessages, Qt::QueuedConnection);
+
+    _bindReplyTimer->setInterval(BIND_REPLY_POLL_INTERVAL_MS);
+    _bindReplyTimer->setTimerType(Qt::PreciseTimer);
+    connect(_bindReplyTimer, &QTimer::timeout, this,
+            &ServerWorker::_checkBindReply);
 }
 
 ServerWorker::~ServerWorker()
@@ -86,22 +127,50 @@ ServerWorker::~ServerWorker()
     // if other senders are still active / resp. the window gets closed if no
     // more senders contribute to it.
     if (!_streamId.isEmpty())
-        emit removeStreamSource(_streamId, _sourceId);
+        _post(FrameDispatcher::SourceMessage::Type::close);
+
+    _frameDispatcher.addPooledByteCount(-int64_t(_imageBufferBytes));
 
     if (_isConnected())
+    {
         _sendQuit();
 
+        // Without event loop from now on, complete the pending writes here
+        while (_tcpSocket->bytesToWrite() > 0 &&
+               _tcpSocket->waitForBytesWritten(SEND_TIMEOUT_MS))
+        {
+        }
+    }
+
     delete _tcpSocket;
 }
 
+void ServerWorker::setDecoder(FrameDecoder* decoder, const bool toYUV)
+{
+    _decoder = decoder;
+    _decodeToYUV = toYUV;
+}
+
 void ServerWorker::processEvent(const Event evt)
 {
-    _events.enqueue(evt);
-    emit _dataAvailable();
+    // Pending events are all sent during the next _processMessages() call
+    const bool wakeup = _events.isEmpty();
+
+    if (!_coalesce(evt))
+        _events.enqueue(evt);
+
+    if (wakeup)
+        emit _dataAvailable();
 }
 
 void ServerWorker::initConnection()
 {
+    // Also covers a socket descriptor which could not be set by the ctor
+    if (!_isConnected())
+    {
+        emit connectionClosed();
+        return;
+    }
     _sendProtocolVersion();
 }
 
@@ -113,75 +182,120 @@ void ServerWorker::closeConnection(const QString uri)
     Event closeEvent;
     closeEvent.type = Event::EVT_CLOSE;
     _send(closeEvent);
+    _flushSocket();
 
     emit(connectionClosed());
 }
 
 void ServerWorker::_processMessages()
 {
-    const qint64 headerSize(MessageHeader::serializedSize);
+    DEFLECT_TRACE_SCOPE("ServerWorker::receive");
 
-    if (_tcpSocket->bytesAvailable() >= headerSize)
-        _receiveMessage();
+    // Handle all the complete messages, keep partial ones for the next call
+    while (_receiveMessage())
+    {
+    }
 
-    // Send all events
-    foreach (const Event& evt, _events)
-        _send(evt);
-    _events.clear();
+    _sendPendingEvents();
 
-    _tcpSocket->flush();
-
-    // Finish reading messages from the socket if connection closed
     if (!_isConnected())
-    {
-        while (_tcpSocket->bytesAvailable() >= headerSize)
-            _receiveMessage();
-
         emit(connectionClosed());
-    }
-    else if (_tcpSocket->bytesAvailable() >= headerSize)
-        emit _dataAvailable();
 }
 
-void ServerWorker::_receiveMessage()
+bool ServerWorker::_receiveMessage()
 {
-    const MessageHeader mh = _receiveMessageHeader();
-    const QByteArray messageByteArray = _receiveMessageBody(mh.size);
-    _handleMessage(mh, messageByteArray);
-}
+    if (!_headerReceived)
+    {
+        const qint64 headerSize(MessageHeader::serializedSize);
+        if (_tcpSocket->bytesAvailable() < headerSize)
+            return false;
 
-MessageHeader ServerWorker::_receiveMessageHeader()
-{
-    MessageHeader messageHeader;
+        QDataStream stream(_tcpSocket);
+        stream >> _messageHeader;
+        _receivedByteCount += headerSize;
+        _headerReceived = true;
+        _bodyBytesReceived = 0;
+
+        // Segments are received in two steps: the parameters, then the image
+        // data directly into its final buffer.
+        _messageBody.resize(_isSegment(_messageHeader)
+                                ? sizeof(SegmentParameters)
+                                : _messageHeader.size);
+        _segmentParametersReceived = false;
+    }
 
-    QDataStream stream(_tcpSocket);
-    stream >> messageHeader;
+    if (!_receiveBody())
+        return false;
+
+    if (_isSegment(_messageHeader) && !_segmentParametersReceived)
+    {
+        const auto data = _messageBody.constData();
+        _segment.parameters = *reinterpret_cast<const SegmentParameters*>(data);
+        _segmentParametersReceived = true;
+
+        const int imageSize = _messageHeader.size - sizeof(SegmentParameters);
+        _messageBody = _acquireImageBuffer(imageSize);
+        _bodyBytesReceived = 0;
+
+        if (!_receiveBody())
+            return false;
+    }
 
-    return messageHeader;
+    _headerReceived = false;
+    if (_segmentParametersReceived)
+        _segment.imageData = std::move(_messageBody);
+    const auto message = std::move(_messageBody);
+    _handleMessage(_messageHeader, message);
+    return true;
 }
 
-QByteArray ServerWorker::_receiveMessageBody(const int size)
+bool ServerWorker::_receiveBody()
 {
-    QByteArray messageByteArray;
-
-    if (size > 0)
+    const int bodySize = _messageBody.size();
+    if (_bodyBytesReceived < bodySize)
     {
-        messageByteArray = _tcpSocket->read(size);
+        const qint64 read =
+            _tcpSocket->read(_messageBody.data() + _bodyBytesReceived,
+                             bodySize - _bodyBytesReceived);
+        if (read > 0)
+        {
+            _bodyBytesReceived += read;
+            _receivedByteCount += read;
+        }
+    }
+    return _bodyBytesReceived == bodySize;
+}
 
-        while (messageByteArray.size() < size)
+QByteArray ServerWorker::_acquireImageBuffer(const int size)
+{
+    // A buffer is free once no Segment references it anymore
+    for (auto it = _imageBuffers.begin(); it != _imageBuffers.end(); ++it)
+    {
+        if (it->isDetached())
         {
-            if (!_tcpSocket->waitForReadyRead(RECEIVE_TIMEOUT_MS))
-            {
-                emit connectionClosed();
-                return QByteArray();
-            }
-
-            messageByteArray.append(
-                _tcpSocket->read(size - messageByteArray.size()));
+            QByteArray buffer = std::move(*it);
+            _imageBuffers.erase(it);
+            _imageBufferBytes -= buffer.capacity();
+            _frameDispatcher.addPooledByteCount(-int64_t(buffer.capacity()));
+            buffer.resize(size);
+            return buffer;
         }
     }
+    return QByteArray(size, Qt::Uninitialized);
+}
 
-    return messageByteArray;
+void ServerWorker::_releaseImageBuffer(const QByteArray& buffer)
+{
+    // Beyond the limits, buffers are freed once the consumers release them
+    const size_t bytes = buffer.capacity();
+    if (_imageBuffers.size() >= MAX_IMAGE_BUFFERS ||
+        _imageBufferBytes + bytes > MAX_IMAGE_BUFFER_BYTES)
+    {
+        return;
+    }
+    _imageBuffers.push_back(buffer);
+    _imageBufferBytes += bytes;
+    _frameDispatcher.addPooledByteCount(bytes);
 }
 
 void ServerWorker::_handleMessage(const MessageHeader& messageHeader,
@@ -205,8 +319,10 @@ void ServerWorker::_handleMessage(const MessageHeader& messageHeader,
     switch (messageHeader.type)
     {
     case MESSAGE_TYPE_QUIT:
-        emit removeStreamSource(_streamId, _sourceId);
+        _post(FrameDispatcher::SourceMessage::Type::close);
         _streamId = QString();
+        _frameSegments.clear();
+        _frameTimestamps = FrameTimestamps();
         break;
 
     case MESSAGE_TYPE_PIXELSTREAM_OPEN:
@@ -218,16 +334,18 @@ void ServerWorker::_handleMessage(const MessageHeader& messageHeader,
         _streamId = uri;
         // The version is only sent by deflect clients since v. 0.12.1
         if (!byteArray.isEmpty())
-            _parseClientProtocolVersion(byteArray);
-        emit addStreamSource(_streamId, _sourceId);
+            _parseOpenMessage(byteArray);
+        _streamIndex = _frameDispatcher.getStreamIndex(_streamId);
+        _post(FrameDispatcher::SourceMessage::Type::open);
         break;
 
     case MESSAGE_TYPE_PIXELSTREAM_FINISH_FRAME:
-        emit receivedFrameFinished(_streamId, _sourceId);
+        _parseFinishFrameMessage(byteArray);
+        _post(FrameDispatcher::SourceMessage::Type::frame);
         break;
 
     case MESSAGE_TYPE_PIXELSTREAM:
-        _handlePixelStreamMessage(byteArray);
+        _handlePixelStreamMessage();
         break;
 
     case MESSAGE_TYPE_SIZE_HINTS:
@@ -252,24 +370,18 @@ void ServerWorker::_handleMessage(const MessageHeader& messageHeader,
 
     case MESSAGE_TYPE_BIND_EVENTS:
     case MESSAGE_TYPE_BIND_EVENTS_EX:
-        if (_registeredToEvents)
+        if (_registeredToEvents || _bindReply.valid())
             std::cerr << "We are already bound!!" << std::endl;
         else
         {
             const bool exclusive =
                 (messageHeader.type == MESSAGE_TYPE_BIND_EVENTS_EX);
             auto promise = std::make_shared<std::promise<bool>>();
-            auto future = promise->get_future();
+            _bindReply = promise->get_future();
             emit registerToEvents(_streamId, exclusive, this,
                                   std::move(promise));
-            try
-            {
-                _registeredToEvents = future.get();
-            }
-            catch (...)
-            {
-            }
-            _sendBindReply(_registeredToEvents);
+            // Do not block the other connections served by this thread
+            _checkBindReply();
         }
         break;
 
@@ -278,24 +390,123 @@ void ServerWorker::_handleMessage(const MessageHeader& messageHeader,
     }
 }
 
-void ServerWorker::_parseClientProtocolVersion(const QByteArray& message)
+void ServerWorker::_checkBindReply()
+{
+    if (!_bindReply.valid())
+        return;
+
+    const auto status = _bindReply.wait_for(std::chrono::seconds(0));
+    if (status != std::future_status::ready)
+    {
+        if (!_bindReplyTimer->isActive())
+            _bindReplyTimer->start();
+        return;
+    }
+    _bindReplyTimer->stop();
+
+    try
+    {
+        _registeredToEvents = _bindReply.get();
+    }
+    catch (...)
+    {
+    }
+    _sendBindReply(_registeredToEvents);
+}
+
+void ServerWorker::_parseOpenMessage(const QByteArray& message)
 {
+    // "version" until protocol 10, "version clientTimeUs" since then
+    const auto fields = message.split(' ');
+
     bool ok = false;
-    const int version = message.toInt(&ok);
+    const int version = fields[0].toInt(&ok);
     if (ok)
         _clientProtocolVersion = version;
+
+    if (fields.size() > 1)
+    {
+        const qint64 clientTimeUs = fields[1].toLongLong(&ok);
+        if (ok)
+            _updateClockOffset(clientTimeUs);
+    }
 }
 
-void ServerWorker::_handlePixelStreamMessage(const QByteArray& message)
+void ServerWorker::_parseFinishFrameMessage(const QByteArray& message)
 {
-    Segment segment;
+    // Sent since protocol 11, older clients leave the timestamps unknown
+    if (message.size() < FINISH_FRAME_MESSAGE_SIZE)
+        return;
 
-    const auto data = message.data();
-    segment.parameters = *reinterpret_cast<const SegmentParameters*>(data);
-    segment.imageData =
-        message.right(message.size() - sizeof(SegmentParameters));
-    segment.view = _activeView;
-    emit(receivedSegment(_streamId, _sourceId, segment));
+    quint64 index = 0;
+    qint64 captureUs = 0;
+    qint64 sentUs = 0;
+    QDataStream stream(message);
+    stream >> index >> captureUs >> sentUs;
+
+    _updateClockOffset(sentUs);
+    _frameTimestamps.index = index;
+    if (captureUs >= 0)
+        _frameTimestamps.captureUs = captureUs + _clockOffsetUs;
+}
+
+void ServerWorker::_updateClockOffset(const int64_t clientTimeUs)
+{
+    // The smallest offset is the one with the least network delay in it
+    const auto offset = FrameTimestamps::getTimeUs() - clientTimeUs;
+    if (!_hasClockOffset || offset < _clockOffsetUs)
+        _clockOffsetUs = offset;
+    _hasClockOffset = true;
+}
+
+void ServerWorker::_handlePixelStreamMessage()
+{
+    if (!_segmentParametersReceived)
+        return; // malformed message without parameters
+
+    _segment.view = _activeView;
+    const auto dataType = _segment.parameters.dataType;
+    if (_decoder && (dataType == DataType::jpeg || dataType == DataType::fill))
+        _startDecoding();
+
+    if (_frameSegments.empty())
+        _frameTimestamps.arrivalUs = FrameTimestamps::getTimeUs();
+
+    // The frame's Segment shares the buffer, which comes back to the pool
+    _releaseImageBuffer(_segment.imageData);
+    _frameSegments.push_back(std::move(_segment));
+    _segment = Segment();
+}
+
+void ServerWorker::_startDecoding()
+{
+#ifdef DEFLECT_USE_LIBJPEGTURBO
+    auto task = std::make_shared<DecodeTask>(_segment);
+    task->toYUV = _decodeToYUV;
+    auto frameDispatcher = &_frameDispatcher;
+    task->onFinished = [frameDispatcher] {
+        frameDispatcher->notifyDecodingFinished();
+    };
+    _segment.decodeTask = task;
+    startDecodeTask(*_decoder, std::move(task));
+#endif
+}
+
+void ServerWorker::_post(const FrameDispatcher::SourceMessage::Type type)
+{
+    FrameDispatcher::SourceMessage message;
+    message.type = type;
+    message.streamIndex = _streamIndex;
+    message.sourceIndex = _sourceId;
+    if (type == FrameDispatcher::SourceMessage::Type::frame)
+    {
+        message.segments.swap(_frameSegments);
+        message.timestamps = _frameTimestamps;
+        _frameTimestamps = FrameTimestamps();
+    }
+    message.byteCount = _receivedByteCount;
+    _receivedByteCount = 0;
+    _frameDispatcher.post(std::move(message));
 }
 
 void ServerWorker::_sendProtocolVersion()
@@ -314,17 +525,65 @@ void ServerWorker::_sendBindReply(const bool successful)
     _flushSocket();
 }
 
+bool ServerWorker::_coalesce(const Event& evt)
+{
+    if (!_isCoalescable(evt))
+        return false;
+
+    // Merge with the last pending move/update of the same point, unless
+    // another type of event has been queued since then.
+    for (auto it = _events.rbegin(); it != _events.rend(); ++it)
+    {
+        if (!_isCoalescable(*it))
+            return false;
+
+        if (_isSamePoint(*it, evt))
+        {
+            const double dx = it->dx + evt.dx;
+            const double dy = it->dy + evt.dy;
+            *it = evt;
+            it->dx = dx;
+            it->dy = dy;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ServerWorker::_sendPendingEvents()
+{
+    if (_events.isEmpty())
+        return;
+
+    if (_clientProtocolVersion >= FIRST_PROTOCOL_VERSION_WITH_COMPACT_EVENTS)
+    {
+        const auto batch = serializeEvents(_events, EventEncoding::compact);
+        _send(MessageHeader(MESSAGE_TYPE_EVENT_BATCH_COMPACT, batch.size()));
+        _tcpSocket->write(batch);
+    }
+    else if (_clientProtocolVersion >= FIRST_PROTOCOL_VERSION_WITH_EVENT_BATCH)
+    {
+        const auto batch = serializeEvents(_events, EventEncoding::full);
+        _send(MessageHeader(MESSAGE_TYPE_EVENT_BATCH, batch.size()));
+        _tcpSocket->write(batch);
+    }
+    else
+    {
+        for (const auto& evt : _events)
+            _send(evt);
+    }
+    _events.clear();
+    _flushSocket();
+}
+
 void ServerWorker::_send(const Event& evt)
 {
     // send message header
     MessageHeader mh(MESSAGE_TYPE_EVENT, Event::serializedSize);
     _send(mh);
 
-    {
-        QDataStream stream(_tcpSocket);
-        stream << evt;
-    }
-    _flushSocket();
+    QDataStream stream(_tcpSocket);
+    stream << evt;
 }
 
 void ServerWorker::_sendQuit()
@@ -344,9 +603,8 @@ bool ServerWorker::_send(const MessageHeader& messageHeader)
 
 void ServerWorker::_flushSocket()
 {
+    // Data which can't be written immediately is sent by the event loop
     _tcpSocket->flush();
-    while (_tcpSocket->bytesToWrite() > 0 && _isConnected())
-        _tcpSocket->waitForBytesWritten();
 }
 
 bool ServerWorker::_isConnected() const
@@ -43,14 +43,19 @@
 
 #include <deflect/Event.h>
 #include <deflect/EventReceiver.h>
+#include <deflect/FrameDispatcher.h>
 #include <deflect/MessageHeader.h>
 #include <deflect/Segment.h>
 #include <deflect/SizeHints.h>
 #include <deflect/types.h>
 
 #include <QQueue>
+#include <QTimer>
 #include <QtNetwork/QTcpSocket>
 
+#include <future>
+#include <vector>
+
 namespace deflect
 {
 class ServerWorker : public EventReceiver
@@ -58,9 +63,12 @@ class ServerWorker : public EventReceiver
     Q_OBJECT
 
 public:
-    explicit ServerWorker(int socketDescriptor);
+    ServerWorker(int socketDescriptor, FrameDispatcher& frameDispatcher);
     ~ServerWorker();
 
+    /** Decode the JPEG segments on arrival with the given decoder. */
+    void setDecoder(FrameDecoder* decoder, bool toYUV);
+
 public slots:
     void processEvent(Event evt) final;
 
@@ -68,13 +76,6 @@ public slots:
     void closeConnection(QString uri);
 
 signals:
-    void addStreamSource(QString uri, size_t sourceIndex);
-    void removeStreamSource(QString uri, size_t sourceIndex);
-
-    void receivedSegment(QString uri, size_t sourceIndex,
-                         deflect::Segment segment);
-    void receivedFrameFinished(QString uri, size_t sourceIndex);
-
     void registerToEvents(QString uri, bool exclusive,
                           deflect::EventReceiver* receiver,
                           deflect::BoolPromisePtr success);
@@ -90,30 +91,74 @@ signals:
 
 private slots:
     void _processMessages();
+    void _checkBindReply();
 
 private:
     QTcpSocket* _tcpSocket;
+    FrameDispatcher& _frameDispatcher;
+    FrameDecoder* _decoder = nullptr;
+    bool _decodeToYUV = false;
 
     QString _streamId;
+    size_t _streamIndex = 0;
     int _sourceId;
     int _clientProtocolVersion;
 
     bool _registeredToEvents;
     QQueue<Event> _events;
 
+    /** The answer to a request to bind to events, polled until ready. */
+    std::future<bool> _bindReply;
+    QTimer* _bindReplyTimer;
+
     View _activeView;
 
-    void _receiveMessage();
-    MessageHeader _receiveMessageHeader();
-    QByteArray _receiveMessageBody(int size);
+    /** The segments of the current frame, posted at once when finished. */
+    Segments _frameSegments;
+
+    /** Bytes read from the socket since the last posted message. */
+    size_t _receivedByteCount = 0;
+
+    /** @name Timing of the frames */
+    //@{
+    /** Server minus client time, including the minimum network delay. */
+    int64_t _clockOffsetUs = 0;
+    bool _hasClockOffset = false;
+    FrameTimestamps _frameTimestamps;
+    //@}
+
+    /** @name State of the message being received. */
+    //@{
+    bool _headerReceived = false;
+    MessageHeader _messageHeader;
+    QByteArray _messageBody;
+    int _bodyBytesReceived = 0;
+    bool _segmentParametersReceived = false;
+    Segment _segment;
+    //@}
+
+    /** Image buffers of the segments, reused once released by consumers. */
+    std::vector<QByteArray> _imageBuffers;
+    size_t _imageBufferBytes = 0;
+
+    bool _receiveMessage();
+    bool _receiveBody();
+    QByteArray _acquireImageBuffer(int size);
+    void _releaseImageBuffer(const QByteArray& buffer);
 
     void _handleMessage(const MessageHeader& messageHeader,
                         const QByteArray& message);
-    void _parseClientProtocolVersion(const QByteArray& message);
-    void _handlePixelStreamMessage(const QByteArray& message);
+    void _parseOpenMessage(const QByteArray& message);
+    void _parseFinishFrameMessage(const QByteArray& message);
+    void _updateClockOffset(int64_t clientTimeUs);
+    void _handlePixelStreamMessage();
+    void _startDecoding();
+    void _post(FrameDispatcher::SourceMessage::Type type);
 
     void _sendProtocolVersion();
     void _sendBindReply(bool successful);
+    bool _coalesce(const Event& evt);
+    void _sendPendingEvents();
     void _send(const Event& evt);
     void _sendQuit();
     bool _send(const MessageHeader& messageHeader);
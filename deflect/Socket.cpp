@@ -40,25 +40,32 @@
 
 #include "MessageHeader.h"
 #include "NetworkProtocol.h"
+#include "Trace.h"
 
 #include <QCoreApplication>
 #include <QDataStream>
+#include <QElapsedTimer>
 #include <QLoggingCategory>
 #include <QTcpSocket>
+
+#include <algorithm>
 #include <iostream>
 
 namespace
 {
 const int INVALID_NETWORK_PROTOCOL_VERSION = -1;
 const int RECEIVE_TIMEOUT_MS = 1000;
+const int RECEIVE_POLL_MS = 10;
 }
 
 namespace deflect
 {
 const unsigned short Socket::defaultPortNumber = DEFAULT_PORT_NUMBER;
 
-Socket::Socket(const std::string& host, const unsigned short port)
+Socket::Socket(const std::string& host, const unsigned short port,
+               const bool autoConnect)
     : _host(host)
+    , _port(port)
     , _socket(new QTcpSocket(this)) // Ensure that _socket parent is
                                     // *this* so it gets moved to thread
     , _serverProtocolVersion(INVALID_NETWORK_PROTOCOL_VERSION)
@@ -72,7 +79,8 @@ Socket::Socket(const std::string& host, const unsigned short port)
         log->setEnabled(QtWarningMsg, false);
     }
 
-    _connect(host, port);
+    if (autoConnect)
+        _connect(host, port);
 
     QObject::connect(_socket, &QTcpSocket::disconnected, this,
                      &Socket::disconnected);
@@ -83,6 +91,19 @@ const std::string& Socket::getHost() const
     return _host;
 }
 
+bool Socket::connectToHost()
+{
+    QMutexLocker locker(&_socketMutex);
+
+    _socket->abort();
+    _serverProtocolVersion = INVALID_NETWORK_PROTOCOL_VERSION;
+    {
+        QMutexLocker receiveLocker(&_receiveMutex);
+        _receiveBuffer.clear();
+    }
+    return _connect(_host, _port);
+}
+
 bool Socket::isConnected() const
 {
     return _socket->state() == QTcpSocket::ConnectedState;
@@ -98,18 +119,18 @@ int Socket::getFileDescriptor() const
     return _socket->socketDescriptor();
 }
 
-bool Socket::hasMessage(const size_t messageSize) const
+bool Socket::hasMessage() const
 {
-    QMutexLocker locker(&_socketMutex);
+    _pollIncomingData();
 
-    // needed to 'wakeup' socket when no data was streamed for a while
-    _socket->waitForReadyRead(0);
-    return _socket->bytesAvailable() >=
-           (int)(MessageHeader::serializedSize + messageSize);
+    MessageHeader messageHeader;
+    QMutexLocker locker(&_receiveMutex);
+    return _peekMessage(0, messageHeader);
 }
 
 bool Socket::send(const MessageHeader& messageHeader, const QByteArray& message)
 {
+    DEFLECT_TRACE_SCOPE("Socket::send");
     QMutexLocker locker(&_socketMutex);
     if (!isConnected())
         return false;
@@ -125,53 +146,158 @@ bool Socket::send(const MessageHeader& messageHeader, const QByteArray& message)
 
     // Needed in the absence of event loop, otherwise the reception is frozen.
     while (_socket->bytesToWrite() > 0 && isConnected())
+    {
         _socket->waitForBytesWritten();
+        _fetchIncomingData();
+    }
 
     return allSent;
 }
 
 bool Socket::receive(MessageHeader& messageHeader, QByteArray& message)
 {
-    QMutexLocker locker(&_socketMutex);
-
-    if (!_receiveHeader(messageHeader))
+    if (!_waitForData(MessageHeader::serializedSize))
         return false;
 
-    // get the message
-    if (messageHeader.size > 0)
     {
-        message = _socket->read(messageHeader.size);
+        QMutexLocker locker(&_receiveMutex);
+        QDataStream stream(_receiveBuffer);
+        stream >> messageHeader;
+        if (stream.status() != QDataStream::Ok)
+            return false;
+    }
 
-        while (message.size() < int(messageHeader.size))
-        {
-            if (!_socket->waitForReadyRead(RECEIVE_TIMEOUT_MS))
-                return false;
+    const size_t messageSize =
+        MessageHeader::serializedSize + messageHeader.size;
+    if (!_waitForData(messageSize))
+        return false;
 
-            message.append(_socket->read(messageHeader.size - message.size()));
-        }
+    {
+        QMutexLocker locker(&_receiveMutex);
+        message = _receiveBuffer.mid(MessageHeader::serializedSize,
+                                     messageHeader.size);
+        _receiveBuffer.remove(0, messageSize);
     }
 
     if (messageHeader.type == MESSAGE_TYPE_QUIT)
     {
-        _socket->disconnectFromHost();
+        _disconnectOnQuit();
         return false;
     }
 
     return true;
 }
 
-bool Socket::_receiveHeader(MessageHeader& messageHeader)
+bool Socket::receiveAvailable(std::vector<Message>& messages)
 {
-    while (_socket->bytesAvailable() < qint64(MessageHeader::serializedSize))
+    _pollIncomingData();
+
+    bool quit = false;
     {
-        if (!_socket->waitForReadyRead(RECEIVE_TIMEOUT_MS))
-            return false;
+        QMutexLocker locker(&_receiveMutex);
+        int offset = 0;
+        MessageHeader messageHeader;
+        while (_peekMessage(offset, messageHeader))
+        {
+            const int dataOffset = offset + MessageHeader::serializedSize;
+            offset = dataOffset + messageHeader.size;
+
+            if (messageHeader.type == MESSAGE_TYPE_QUIT)
+            {
+                quit = true;
+                break;
+            }
+            messages.emplace_back(messageHeader,
+                                  _receiveBuffer.mid(dataOffset,
+                                                     messageHeader.size));
+        }
+        _receiveBuffer.remove(0, offset);
     }
 
-    QDataStream stream(_socket);
+    if (quit)
+        _disconnectOnQuit();
+    return !quit;
+}
+
+void Socket::_pollIncomingData() const
+{
+    // needed to 'wakeup' socket when no data was streamed for a while. If a
+    // send is in progress, it takes care of fetching the incoming data.
+    if (_socketMutex.tryLock())
+    {
+        _socket->waitForReadyRead(0);
+        _fetchIncomingData();
+        _socketMutex.unlock();
+    }
+}
+
+void Socket::_fetchIncomingData() const
+{
+    if (_socket->bytesAvailable() <= 0)
+        return;
+
+    const QByteArray data = _socket->readAll();
+
+    QMutexLocker locker(&_receiveMutex);
+    _receiveBuffer.append(data);
+    _dataReceived.wakeAll();
+}
+
+bool Socket::_peekMessage(const int offset, MessageHeader& messageHeader) const
+{
+    const int available = _receiveBuffer.size() - offset;
+    if (available < int(MessageHeader::serializedSize))
+        return false;
+
+    const auto header =
+        QByteArray::fromRawData(_receiveBuffer.constData() + offset,
+                                MessageHeader::serializedSize);
+    QDataStream stream(header);
     stream >> messageHeader;
+    if (stream.status() != QDataStream::Ok)
+        return false;
+
+    return available >= int(MessageHeader::serializedSize + messageHeader.size);
+}
+
+void Socket::_disconnectOnQuit()
+{
+    QMutexLocker locker(&_socketMutex);
+    _socket->disconnectFromHost();
+}
+
+bool Socket::_waitForData(const size_t size)
+{
+    QElapsedTimer timer;
+    timer.start();
 
-    return stream.status() == QDataStream::Ok;
+    QMutexLocker locker(&_receiveMutex);
+    while (size_t(_receiveBuffer.size()) < size)
+    {
+        const int remaining = RECEIVE_TIMEOUT_MS - int(timer.elapsed());
+        if (remaining <= 0)
+            return false;
+
+        // Read from the socket only if no send is in progress, otherwise wait
+        // for the sending thread to fetch the data. Short waits make sure that
+        // a pending receive does not delay a send for too long either.
+        if (_socketMutex.tryLock())
+        {
+            locker.unlock();
+            _socket->waitForReadyRead(std::min(remaining, RECEIVE_POLL_MS));
+            _fetchIncomingData();
+            const bool connected = isConnected();
+            _socketMutex.unlock();
+            locker.relock();
+
+            if (!connected && size_t(_receiveBuffer.size()) < size)
+                return false;
+        }
+        else
+            _dataReceived.wait(&_receiveMutex,
+                               std::min(remaining, RECEIVE_POLL_MS));
+    }
+    return true;
 }
 
 bool Socket::_connect(const std::string& host, const unsigned short port)
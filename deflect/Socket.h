@@ -47,10 +47,13 @@ typedef __int32 int32_t;
 #include <deflect/types.h>
 
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <QByteArray>
 #include <QMutex>
 #include <QObject>
+#include <QWaitCondition>
 
 class QTcpSocket;
 
@@ -58,12 +61,19 @@ namespace deflect
 {
 /**
  * Represent a communication Socket for the Stream Library.
+ *
+ * The Socket is full-duplex: incoming data is moved to an internal receive
+ * buffer by whichever thread currently owns the connection, so that reading
+ * messages never waits for a send operation to complete.
  */
 class Socket : public QObject
 {
     Q_OBJECT
 
 public:
+    /** A message header and its associated data. */
+    using Message = std::pair<MessageHeader, QByteArray>;
+
     /** The default communication port */
     static const unsigned short defaultPortNumber;
 
@@ -71,9 +81,12 @@ public:
      * Construct a Socket and connect to host.
      * @param host The target host (IP address or hostname)
      * @param port The target port
+     * @param autoConnect Connect immediately, otherwise connectToHost() must
+     *        be called before using the Socket.
      */
     DEFLECT_API Socket(const std::string& host,
-                       unsigned short port = defaultPortNumber);
+                       unsigned short port = defaultPortNumber,
+                       bool autoConnect = true);
 
     /** Destruct a Socket, disconnecting from host. */
     DEFLECT_API ~Socket() = default;
@@ -81,6 +94,13 @@ public:
     /** Get the host passed to the constructor. */
     const std::string& getHost() const;
 
+    /**
+     * Connect to the host, closing any previous connection first.
+     * @return true if the connection was established with a server which
+     *         uses a supported protocol, false otherwise.
+     */
+    DEFLECT_API bool connectToHost();
+
     /** Is the Socket connected */
     DEFLECT_API bool isConnected() const;
 
@@ -93,11 +113,8 @@ public:
      */
     int getFileDescriptor() const;
 
-    /**
-     * Is there a pending message
-     * @param messageSize Minimum size of the message
-     */
-    bool hasMessage(const size_t messageSize = 0) const;
+    /** Is there a complete message ready to be received without waiting. */
+    bool hasMessage() const;
 
     /**
      * Send a message.
@@ -115,17 +132,37 @@ public:
      */
     bool receive(MessageHeader& messageHeader, QByteArray& message);
 
+    /**
+     * Receive all the complete messages which are already available, without
+     * waiting for more data.
+     * @param messages The list to which the received messages are appended
+     * @return false if the server has closed the connection, true otherwise
+     */
+    bool receiveAvailable(std::vector<Message>& messages);
+
 signals:
     /** Signal that the socket has been disconnected. */
     void disconnected();
 
 private:
     const std::string _host;
+    const unsigned short _port;
     QTcpSocket* _socket; // Child QObject
-    mutable QMutex _socketMutex;
     int32_t _serverProtocolVersion;
 
-    bool _receiveHeader(MessageHeader& messageHeader);
+    /** Serializes all the operations on the QTcpSocket. */
+    mutable QMutex _socketMutex;
+
+    /** Incoming data not yet consumed by receive(). */
+    mutable QByteArray _receiveBuffer;
+    mutable QMutex _receiveMutex;
+    mutable QWaitCondition _dataReceived;
+
+    void _pollIncomingData() const;
+    void _fetchIncomingData() const;
+    bool _peekMessage(int offset, MessageHeader& messageHeader) const;
+    void _disconnectOnQuit();
+    bool _waitForData(size_t size);
     bool _connect(const std::string& host, const unsigned short port);
     bool _receiveProtocolVersion();
     bool _write(const QByteArray& data);
@@ -39,6 +39,8 @@
 
 #include "SourceBuffer.h"
 
+#include "DecodeTask.h"
+
 #include <exception>
 
 namespace deflect
@@ -53,6 +55,12 @@ const Segments& SourceBuffer::getSegments() const
     return _segments.front();
 }
 
+const FrameTimestamps& SourceBuffer::getTimestamps() const
+{
+    static const FrameTimestamps unknown;
+    return _timestamps.empty() ? unknown : _timestamps.front();
+}
+
 FrameIndex SourceBuffer::getBackFrameIndex() const
 {
     return _backFrameIndex;
@@ -65,11 +73,16 @@ bool SourceBuffer::isBackFrameEmpty() const
 
 void SourceBuffer::pop()
 {
+    for (const auto& segment : _segments.front())
+        _byteCount -= getBufferedByteCount(segment);
     _segments.pop();
+    if (!_timestamps.empty())
+        _timestamps.pop();
 }
 
-void SourceBuffer::push()
+void SourceBuffer::push(const FrameTimestamps& timestamps)
 {
+    _timestamps.push(timestamps);
     _segments.push(Segments());
     ++_backFrameIndex;
 }
@@ -77,10 +90,16 @@ void SourceBuffer::push()
 void SourceBuffer::insert(const Segment& segment)
 {
     _segments.back().push_back(segment);
+    _byteCount += getBufferedByteCount(segment);
 }
 
 size_t SourceBuffer::getQueueSize() const
 {
     return _segments.size();
 }
+
+size_t SourceBuffer::getByteCount() const
+{
+    return _byteCount;
+}
 }
@@ -40,6 +40,7 @@
 #ifndef DEFLECT_SOURCEBUFFER_H
 #define DEFLECT_SOURCEBUFFER_H
 
+#include <deflect/Frame.h>
 #include <deflect/Segment.h>
 #include <deflect/api.h>
 #include <deflect/types.h>
@@ -63,6 +64,9 @@ public:
     /** @return the segments at the front of the queue. */
     const Segments& getSegments() const;
 
+    /** @return the timestamps of the front frame, if it is finished. */
+    const FrameTimestamps& getTimestamps() const;
+
     /** @return the frame index of the back of the buffer. */
     FrameIndex getBackFrameIndex() const;
 
@@ -72,8 +76,11 @@ public:
     /** Insert a segment into the back frame. */
     void insert(const Segment& segment);
 
-    /** Push a new frame to the back. */
-    void push();
+    /**
+     * Push a new frame to the back.
+     * @param timestamps of the frame being finished
+     */
+    void push(const FrameTimestamps& timestamps = FrameTimestamps());
 
     /** Pop the front frame. */
     void pop();
@@ -81,10 +88,22 @@ public:
     /** @return the size of the queue. */
     size_t getQueueSize() const;
 
+    /**
+     * @return the number of bytes held by the segments of the queue.
+     * @see getBufferedByteCount(const Segment&)
+     */
+    size_t getByteCount() const;
+
 private:
     /** The collections of segments for each mono/left/right view. */
     std::queue<Segments> _segments;
 
+    /** The timestamps of the finished frames of the queue. */
+    std::queue<FrameTimestamps> _timestamps;
+
+    /** The sum of the buffered byte counts of all the segments. */
+    size_t _byteCount = 0;
+
     /** The current indices of the mono/left/right frame for this source. */
     FrameIndex _backFrameIndex = 0u;
 };
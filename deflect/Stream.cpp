@@ -45,25 +45,46 @@
 #include "Event.h"
 #include "ImageWrapper.h"
 #include "MessageHeader.h"
+#include "NetworkProtocol.h"
 #include "Segment.h"
 #include "SegmentParameters.h"
-#include "Socket.h"
 
 #include <QDataStream>
 
 #include <cassert>
 #include <iostream>
 
+namespace
+{
+deflect::Stream::Future _makeReadyFuture(const bool value)
+{
+    std::promise<bool> promise;
+    promise.set_value(value);
+    return promise.get_future();
+}
+}
+
 namespace deflect
 {
+const unsigned short Stream::defaultPortNumber = DEFAULT_PORT_NUMBER;
+
 Stream::Stream()
-    : _impl(new StreamPrivate("", "", Socket::defaultPortNumber))
+    : _impl(new StreamPrivate("", "", defaultPortNumber,
+                              PendingFrames::queue))
 {
+    _impl->connection.wait();
 }
 
 Stream::Stream(const std::string& id, const std::string& host,
                const unsigned short port)
-    : _impl(new StreamPrivate(id, host, port))
+    : _impl(new StreamPrivate(id, host, port, PendingFrames::queue))
+{
+    _impl->connection.wait();
+}
+
+Stream::Stream(const std::string& id, const std::string& host,
+               const unsigned short port, const PendingFrames pendingFrames)
+    : _impl(new StreamPrivate(id, host, port, pendingFrames))
 {
 }
 
@@ -76,6 +97,11 @@ bool Stream::isConnected() const
     return _impl->socket.isConnected();
 }
 
+std::shared_future<bool> Stream::getConnectionFuture() const
+{
+    return _impl->connection;
+}
+
 const std::string& Stream::getId() const
 {
     return _impl->id;
@@ -88,21 +114,29 @@ const std::string& Stream::getHost() const
 
 Stream::Future Stream::send(const ImageWrapper& image)
 {
+    if (_impl->isDroppingFrames())
+        return _makeReadyFuture(false);
     return _impl->sendWorker.enqueueImage(image, false);
 }
 
 Stream::Future Stream::finishFrame()
 {
+    if (_impl->isDroppingFrames())
+        return _makeReadyFuture(false);
     return _impl->sendWorker.enqueueFinish();
 }
 
 Stream::Future Stream::sendAndFinish(const ImageWrapper& image)
 {
+    if (_impl->isDroppingFrames())
+        return _makeReadyFuture(false);
     return _impl->sendWorker.enqueueImage(image, true);
 }
 
 bool Stream::registerForEvents(const bool exclusive)
 {
+    _impl->connection.wait();
+
     if (!isConnected())
     {
         std::cerr << "deflect::Stream::registerForEvents: Stream is not "
@@ -153,35 +187,34 @@ int Stream::getDescriptor() const
 
 bool Stream::hasEvent() const
 {
-    return _impl->socket.hasMessage(Event::serializedSize);
+    // Read the available messages, the bind replies which follow a
+    // reconnection are not events
+    if (_impl->pendingEvents.empty())
+        _impl->receiveAvailableEvents();
+    return !_impl->pendingEvents.empty();
 }
 
 Event Stream::getEvent()
 {
-    MessageHeader mh;
-    QByteArray message;
-    if (!_impl->socket.receive(mh, message))
-    {
-        std::cerr << "deflect::Stream::getEvent: receive failed" << std::endl;
-        return Event();
-    }
-    if (mh.type != MESSAGE_TYPE_EVENT)
-    {
-        std::cerr << "deflect::Stream::getEvent: received unexpected message "
-                  << "type (" << int(mh.type) << ")" << std::endl;
+    if (_impl->pendingEvents.empty() && !_impl->receiveEvents())
         return Event();
-    }
 
-    assert((size_t)message.size() == Event::serializedSize);
-
-    Event event;
-    {
-        QDataStream stream(message);
-        stream >> event;
-    }
+    const Event event = _impl->pendingEvents.front();
+    _impl->pendingEvents.pop_front();
     return event;
 }
 
+size_t Stream::getEvents(std::vector<Event>& events)
+{
+    _impl->receiveAvailableEvents();
+
+    const size_t count = _impl->pendingEvents.size();
+    events.insert(events.end(), _impl->pendingEvents.begin(),
+                  _impl->pendingEvents.end());
+    _impl->pendingEvents.clear();
+    return count;
+}
+
 void Stream::sendSizeHints(const SizeHints& hints)
 {
     _impl->sendWorker.enqueueSizeHints(hints);
@@ -192,6 +225,11 @@ void Stream::setDisconnectedCallback(const std::function<void()> callback)
     _impl->disconnectedCallback = callback;
 }
 
+void Stream::setAutoReconnect(const bool enable)
+{
+    _impl->sendWorker.setAutoReconnect(enable);
+}
+
 bool Stream::sendData(const char* data, const size_t count)
 {
     return _impl->sendWorker
@@ -51,6 +51,7 @@
 #include <future>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace deflect
 {
@@ -69,6 +70,20 @@ class StreamPrivate;
 class Stream
 {
 public:
+    /** The default port number of the Server. @version 1.7 */
+    DEFLECT_API static const unsigned short defaultPortNumber;
+
+    /**
+     * What to do with the frames sent before an asynchronous connection is
+     * established.
+     * @version 1.7
+     */
+    enum class PendingFrames
+    {
+        queue, /**< send them once connected */
+        drop   /**< discard them, their futures return false */
+    };
+
     /**
      * Open a new connection to the Server using environment variables.
      *
@@ -97,12 +112,30 @@ public:
      *             hostname like "localhost" or an IP in string format like
      *             "192.168.1.83". If left empty, the environment variable
      *             DEFLECT_HOST will be used instead.
-     * @param port Port of the Server instance, default 1701.
+     * @param port Port of the Server instance, default defaultPortNumber.
      * @throw std::runtime_error if no host was provided.
      * @version 1.0
      */
     DEFLECT_API Stream(const std::string& id, const std::string& host,
-                       unsigned short port = 1701);
+                       unsigned short port = defaultPortNumber);
+
+    /**
+     * Open a new connection to the Server asynchronously.
+     *
+     * The constructor returns immediately and the connection is established
+     * in the background. Its outcome can be obtained with
+     * getConnectionFuture(). Until then, isConnected() returns false.
+     *
+     * @param id The identifier for the stream, see above.
+     * @param host The address of the target Server instance, see above.
+     * @param port Port of the Server instance.
+     * @param pendingFrames What to do with the frames sent before the
+     *        connection is established.
+     * @throw std::runtime_error if no host was provided.
+     * @version 1.7
+     */
+    DEFLECT_API Stream(const std::string& id, const std::string& host,
+                       unsigned short port, PendingFrames pendingFrames);
 
     /** Destruct the Stream, closing the connection. @version 1.0 */
     DEFLECT_API virtual ~Stream();
@@ -110,6 +143,12 @@ public:
     /** @return true if the stream is connected, false otherwise. @version 1.0*/
     DEFLECT_API bool isConnected() const;
 
+    /**
+     * @return a future signaling if the connection could be established.
+     * @version 1.7
+     */
+    DEFLECT_API std::shared_future<bool> getConnectionFuture() const;
+
     /** @return the identifier defined by the constructor. @version 1.3 */
     DEFLECT_API const std::string& getId() const;
 
@@ -176,8 +215,9 @@ public:
      * The current registration status can be checked with
      * isRegisteredForEvents().
      *
-     * This method is synchronous and waits for a registration reply from the
-     * Server before returning.
+     * This method is synchronous and waits for a pending connection to be
+     * established and for a registration reply from the Server before
+     * returning.
      *
      * @param exclusive Binds only one stream source for the same identifier.
      * @return true if the registration could be or was already established.
@@ -231,11 +271,27 @@ public:
      * Check if an Event is available with hasEvent() before calling this
      * method.
      *
+     * Consecutive move events of the same point may be merged by the Server
+     * into a single one before being sent, with dx and dy accumulated.
+     *
      * @return The next Event if available, otherwise an empty (default) Event.
      * @version 1.0
      */
     DEFLECT_API Event getEvent();
 
+    /**
+     * Get all the Events which have already been received.
+     *
+     * This method is non-blocking. It is more efficient than calling
+     * hasEvent() and getEvent() in a loop when many events are expected, for
+     * instance with multi-touch interaction.
+     *
+     * @param events the list to which the available Events are appended.
+     * @return the number of Events appended to the list.
+     * @version 1.7
+     */
+    DEFLECT_API size_t getEvents(std::vector<Event>& events);
+
     /**
      * Send size hints to the stream server to indicate sizes that should be
      * respected by resize operations on the server side.
@@ -266,6 +322,24 @@ public:
      */
     DEFLECT_API void setDisconnectedCallback(std::function<void()> callback);
 
+    /**
+     * Automatically reconnect to the Server after the connection was lost.
+     *
+     * The reconnection is attempted by the next send operation, retrying with
+     * an exponential backoff during which send operations fail immediately.
+     * Once reconnected, the Stream is opened again and the registration for
+     * events and last size hints are sent again, so that the next frame
+     * restores the window on the Server. The disconnected callback is still
+     * called when the connection is lost.
+     *
+     * Reconnection is disabled when the Server closes the Stream's window
+     * (Event::EVT_CLOSE) and when the Stream is destroyed.
+     *
+     * @param enable true to enable, false to disable (default).
+     * @version 1.7
+     */
+    DEFLECT_API void setAutoReconnect(bool enable);
+
 private:
     Stream(const Stream&) = delete;
     const Stream& operator=(const Stream&) = delete;
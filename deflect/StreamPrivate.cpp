@@ -41,8 +41,13 @@
 
 #include "StreamPrivate.h"
 
+#include "EventBatch.h"
+#include "MessageHeader.h"
+
 #include <QHostInfo>
 
+#include <chrono>
+#include <iostream>
 #include <stdexcept>
 
 namespace
@@ -80,27 +85,99 @@ std::string _getStreamId(const std::string& id)
 namespace deflect
 {
 StreamPrivate::StreamPrivate(const std::string& id_, const std::string& host,
-                             const unsigned short port)
+                             const unsigned short port,
+                             const Stream::PendingFrames pendingFrames_)
     : id{_getStreamId(id_)}
-    , socket{_getStreamHost(host), port}
+    , socket{_getStreamHost(host), port, false}
     , sendWorker{socket, id}
+    , pendingFrames{pendingFrames_}
 {
-    if (!socket.isConnected())
-        return;
-
     socket.connect(&socket, &Socket::disconnected, [this]() {
         if (disconnectedCallback)
             disconnectedCallback();
     });
 
+    // The connection is done in the worker thread so that it does not block
+    // the caller. Requests enqueued in the meantime are processed after it.
     socket.moveToThread(&sendWorker);
     sendWorker.start();
-    sendWorker.enqueueOpen().wait();
+    connection = sendWorker.enqueueConnect().share();
 }
 
 StreamPrivate::~StreamPrivate()
 {
-    if (socket.isConnected())
-        sendWorker.enqueueClose().wait();
+    // Also waits for a pending connection, the close fails if there is none
+    sendWorker.enqueueClose().wait();
+}
+
+bool StreamPrivate::isDroppingFrames() const
+{
+    return pendingFrames == Stream::PendingFrames::drop &&
+           connection.wait_for(std::chrono::seconds(0)) !=
+               std::future_status::ready;
+}
+
+bool StreamPrivate::receiveEvents()
+{
+    // Loop over bind replies which follow an automatic reconnection
+    while (pendingEvents.empty())
+    {
+        MessageHeader mh;
+        QByteArray message;
+        if (!socket.receive(mh, message))
+        {
+            std::cerr << "deflect::Stream::getEvent: receive failed"
+                      << std::endl;
+            return false;
+        }
+        if (!_decodeEvents(mh, message))
+            return false;
+    }
+    return true;
+}
+
+void StreamPrivate::receiveAvailableEvents()
+{
+    std::vector<Socket::Message> messages;
+    socket.receiveAvailable(messages);
+
+    for (const auto& message : messages)
+        _decodeEvents(message.first, message.second);
+}
+
+bool StreamPrivate::_decodeEvents(const MessageHeader& messageHeader,
+                                  const QByteArray& message)
+{
+    const auto firstNewEvent = pendingEvents.size();
+
+    bool success = false;
+    switch (messageHeader.type)
+    {
+    case MESSAGE_TYPE_EVENT:
+    case MESSAGE_TYPE_EVENT_BATCH:
+        success =
+            deserializeEvents(message, EventEncoding::full, pendingEvents);
+        break;
+    case MESSAGE_TYPE_EVENT_BATCH_COMPACT:
+        success = deserializeEvents(message, EventEncoding::compact,
+                                    pendingEvents);
+        break;
+    case MESSAGE_TYPE_BIND_EVENTS_REPLY:
+        // Registration replayed by the sendWorker after a reconnection
+        registeredForEvents = !message.isEmpty() && *(bool*)(message.data());
+        return true;
+    default:
+        std::cerr << "deflect::Stream::getEvent: received unexpected message "
+                  << "type (" << int(messageHeader.type) << ")" << std::endl;
+        return false;
+    }
+
+    // The window was closed on the Server, do not come back
+    for (auto i = firstNewEvent; i < pendingEvents.size(); ++i)
+    {
+        if (pendingEvents[i].type == Event::EVT_CLOSE)
+            sendWorker.setAutoReconnect(false);
+    }
+    return success;
 }
 }
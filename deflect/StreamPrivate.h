@@ -42,9 +42,11 @@
 #ifndef DEFLECT_STREAMPRIVATE_H
 #define DEFLECT_STREAMPRIVATE_H
 
+#include "Event.h"            // member
 #include "Socket.h"           // member
 #include "StreamSendWorker.h" // member
 
+#include <deque>
 #include <functional>
 #include <string>
 
@@ -55,18 +57,33 @@ class StreamPrivate
 {
 public:
     /**
-     * Create a new stream and open a new connection to the deflect::Server.
+     * Create a new stream and start opening a new connection to the
+     * deflect::Server in the background.
      *
      * @param id the unique stream identifier
      * @param host Address of the target Server instance.
      * @param port Port of the target Server instance.
+     * @param pendingFrames What to do with frames sent before the connection
+     *        is established.
      */
     StreamPrivate(const std::string& id, const std::string& host,
-                  unsigned short port);
+                  unsigned short port, Stream::PendingFrames pendingFrames);
 
     /** Destructor, close the Stream. */
     ~StreamPrivate();
 
+    /**
+     * Wait for the next event message and add its events to pendingEvents.
+     * @return true if at least one event is pending, false otherwise.
+     */
+    bool receiveEvents();
+
+    /** Add the events of all the messages already received to pendingEvents. */
+    void receiveAvailableEvents();
+
+    /** @return true if frames must be dropped while connecting. */
+    bool isDroppingFrames() const;
+
     /** The stream identifier. */
     const std::string id;
 
@@ -76,11 +93,24 @@ public:
     /** Has a successful event registration reply been received */
     bool registeredForEvents = false;
 
+    /** Events received in a batch but not yet retrieved by the user. */
+    std::deque<Event> pendingEvents;
+
     /** Optional callback when the socket is disconnected. */
     std::function<void()> disconnectedCallback;
 
     /** The worker doing all the socket send operations. */
     StreamSendWorker sendWorker;
+
+    /** What to do with frames sent before the connection is established. */
+    const Stream::PendingFrames pendingFrames;
+
+    /** The outcome of the connection, set by the sendWorker. */
+    std::shared_future<bool> connection;
+
+private:
+    bool _decodeEvents(const MessageHeader& messageHeader,
+                       const QByteArray& message);
 };
 }
 #endif
@@ -0,0 +1,206 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#include "StreamRecorder.h"
+
+#include <stdexcept>
+
+namespace deflect
+{
+namespace
+{
+qint64 _getPadding(const qint64 pos)
+{
+    return (RECORDING_DATA_ALIGNMENT - pos % RECORDING_DATA_ALIGNMENT) %
+           RECORDING_DATA_ALIGNMENT;
+}
+
+void _writeImageData(QDataStream& out, const QByteArray& data)
+{
+    static const char zeros[RECORDING_DATA_ALIGNMENT] = {};
+
+    out << quint32(data.size());
+    out.writeRawData(zeros, _getPadding(out.device()->pos()));
+    out.writeRawData(data.constData(), data.size());
+}
+
+QByteArray _readImageData(QDataStream& in, const char* mappedFile)
+{
+    quint32 size = 0;
+    in >> size;
+    if (in.status() != QDataStream::Ok)
+        return QByteArray();
+
+    auto device = in.device();
+    const auto offset = device->pos() + _getPadding(device->pos());
+    if (offset + size > device->size())
+    {
+        in.setStatus(QDataStream::ReadPastEnd);
+        return QByteArray();
+    }
+    if (mappedFile)
+    {
+        device->seek(offset + size);
+        return QByteArray::fromRawData(mappedFile + offset, size);
+    }
+
+    QByteArray data(size, Qt::Uninitialized);
+    device->seek(offset);
+    if (in.readRawData(data.data(), size) != int(size))
+        in.setStatus(QDataStream::ReadPastEnd);
+    return data;
+}
+}
+
+StreamRecorder::StreamRecorder(const QString& filename)
+    : _file(filename)
+    , _startTimeUs(FrameTimestamps::getTimeUs())
+{
+    if (!_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        throw std::runtime_error("could not create recording: " +
+                                 filename.toStdString());
+
+    _stream.setDevice(&_file);
+    _stream.setVersion(RECORDING_STREAM_VERSION);
+    _stream << RECORDING_MAGIC << RECORDING_FORMAT_VERSION
+            << qint64(_startTimeUs);
+}
+
+int64_t StreamRecorder::getStartTimeUs() const
+{
+    return _startTimeUs;
+}
+
+StreamRecorder::~StreamRecorder()
+{
+    const qint64 indexOffset = _file.pos();
+    for (const auto& entry : _index)
+        _stream << entry.offset << entry.timeUs;
+    _stream << indexOffset << quint32(_index.size()) << RECORDING_INDEX_MAGIC;
+}
+
+void StreamRecorder::write(const StreamRecording::Record& record)
+{
+    _index.push_back({_file.pos(), record.timeUs});
+    _stream << record;
+}
+
+QDataStream& operator<<(QDataStream& out,
+                        const StreamRecording::Record& record)
+{
+    out << quint8(record.type) << qint64(record.timeUs) << record.uri
+        << quint64(record.sourceIndex);
+
+    if (record.type != StreamRecording::Record::Type::frame)
+        return out;
+
+    const auto& timestamps = record.timestamps;
+    out << quint64(timestamps.index) << qint64(timestamps.captureUs)
+        << qint64(timestamps.arrivalUs) << qint64(timestamps.completeUs)
+        << qint64(timestamps.dispatchUs);
+
+    out << quint32(record.segments.size());
+    for (const auto& segment : record.segments)
+    {
+        const auto& params = segment.parameters;
+        out << quint32(params.x) << quint32(params.y) << quint32(params.width)
+            << quint32(params.height) << quint8(params.dataType)
+            << quint8(segment.view);
+        _writeImageData(out, segment.imageData);
+    }
+    return out;
+}
+
+QDataStream& operator>>(QDataStream& in, StreamRecording::Record& record)
+{
+    readRecord(in, record, nullptr);
+    return in;
+}
+
+bool readRecord(QDataStream& in, StreamRecording::Record& record,
+                const std::shared_ptr<const char>& mappedFile)
+{
+    quint8 type = 0;
+    qint64 timeUs = 0;
+    quint64 sourceIndex = 0;
+    in >> type >> timeUs >> record.uri >> sourceIndex;
+
+    if (type > quint8(StreamRecording::Record::Type::close))
+        in.setStatus(QDataStream::ReadCorruptData);
+    if (in.status() != QDataStream::Ok)
+        return false;
+
+    record.type = StreamRecording::Record::Type(type);
+    record.timeUs = timeUs;
+    record.sourceIndex = sourceIndex;
+    record.timestamps = FrameTimestamps();
+    record.segments.clear();
+
+    if (record.type != StreamRecording::Record::Type::frame)
+        return true;
+
+    quint64 index = 0;
+    qint64 captureUs = 0, arrivalUs = 0, completeUs = 0, dispatchUs = 0;
+    in >> index >> captureUs >> arrivalUs >> completeUs >> dispatchUs;
+    record.timestamps.index = index;
+    record.timestamps.captureUs = captureUs;
+    record.timestamps.arrivalUs = arrivalUs;
+    record.timestamps.completeUs = completeUs;
+    record.timestamps.dispatchUs = dispatchUs;
+
+    quint32 segmentCount = 0;
+    in >> segmentCount;
+    for (quint32 i = 0; i < segmentCount && in.status() == QDataStream::Ok;
+         ++i)
+    {
+        Segment segment;
+        auto& params = segment.parameters;
+        quint8 dataType = 0;
+        quint8 view = 0;
+        in >> params.x >> params.y >> params.width >> params.height >>
+            dataType >> view;
+        params.dataType = DataType(dataType);
+        segment.view = View(view);
+        segment.imageData = _readImageData(in, mappedFile.get());
+        if (mappedFile)
+            segment.imageDataOwner = mappedFile;
+        record.segments.push_back(std::move(segment));
+    }
+    return in.status() == QDataStream::Ok;
+}
+}
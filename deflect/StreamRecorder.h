@@ -0,0 +1,125 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#ifndef DEFLECT_STREAMRECORDER_H
+#define DEFLECT_STREAMRECORDER_H
+
+#include <deflect/StreamRecording.h>
+#include <deflect/api.h>
+
+#include <QDataStream>
+#include <QFile>
+
+#include <memory>
+#include <vector>
+
+namespace deflect
+{
+/**
+ * Write a StreamRecording.
+ *
+ * The records are appended as they come, the index of their offsets is
+ * written at the end of the file when the recorder is destroyed.
+ */
+class StreamRecorder
+{
+public:
+    /**
+     * Create a new recording.
+     *
+     * @param filename the file to create, replaced if it exists
+     * @throw std::runtime_error if the file cannot be created
+     */
+    DEFLECT_API explicit StreamRecorder(const QString& filename);
+
+    /** @return the start of the recording, see FrameTimestamps::getTimeUs() */
+    DEFLECT_API int64_t getStartTimeUs() const;
+
+    /** Write the index and close the file. */
+    DEFLECT_API ~StreamRecorder();
+
+    /** Append a record. */
+    DEFLECT_API void write(const StreamRecording::Record& record);
+
+private:
+    QFile _file;
+    QDataStream _stream;
+    const int64_t _startTimeUs;
+
+    struct IndexEntry
+    {
+        qint64 offset;
+        qint64 timeUs;
+    };
+    std::vector<IndexEntry> _index;
+};
+
+/** @name Serialization of the recordings, shared with StreamRecording. */
+//@{
+const quint32 RECORDING_MAGIC = 0xdef1ec7d;
+const quint32 RECORDING_INDEX_MAGIC = 0xdef1ec1d;
+const quint32 RECORDING_FORMAT_VERSION = 2;
+const int RECORDING_STREAM_VERSION = QDataStream::Qt_5_0;
+
+/** The image data are aligned in the file, for use directly from a mapping. */
+const qint64 RECORDING_DATA_ALIGNMENT = 64;
+
+/** Trailer: index offset (qint64), record count and index magic (quint32). */
+const qint64 RECORDING_TRAILER_SIZE = 16;
+
+DEFLECT_API QDataStream& operator<<(QDataStream& out,
+                                    const StreamRecording::Record& record);
+DEFLECT_API QDataStream& operator>>(QDataStream& in,
+                                    StreamRecording::Record& record);
+
+/**
+ * Read a record.
+ *
+ * @param in the stream to read from
+ * @param record the record to read
+ * @param mappedFile the mapping of the whole file which the stream reads, if
+ *        mapped: the image data are then views on it at the offsets of the
+ *        file instead of copies, which keep the mapping alive
+ * @return false if the record could not be read
+ */
+DEFLECT_API bool readRecord(QDataStream& in, StreamRecording::Record& record,
+                            const std::shared_ptr<const char>& mappedFile);
+//@}
+}
+
+#endif
@@ -0,0 +1,139 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#include "StreamRecorderWorker.h"
+
+#include <iostream>
+
+namespace deflect
+{
+namespace
+{
+size_t _getByteCount(const StreamRecording::Record& record)
+{
+    size_t byteCount = 0;
+    for (const auto& segment : record.segments)
+        byteCount += segment.imageData.size();
+    return byteCount;
+}
+}
+
+StreamRecorderWorker::StreamRecorderWorker(const QString& filename,
+                                           const size_t maxQueuedBytes)
+    : _recorder(filename)
+    , _maxQueuedBytes(maxQueuedBytes)
+{
+    setObjectName("StreamRecorder");
+    start();
+}
+
+StreamRecorderWorker::~StreamRecorderWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _running = false;
+    }
+    _condition.notify_all();
+    wait();
+
+    if (_droppedFrameCount > 0)
+        std::cerr << "recording fell behind, dropped " << _droppedFrameCount
+                  << " frames" << std::endl;
+}
+
+int64_t StreamRecorderWorker::getStartTimeUs() const
+{
+    return _recorder.getStartTimeUs();
+}
+
+bool StreamRecorderWorker::write(StreamRecording::Record record)
+{
+    const auto byteCount = _getByteCount(record);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (record.type == StreamRecording::Record::Type::frame)
+        {
+            if (_queuedBytes + byteCount > _maxQueuedBytes)
+            {
+                if (!_dropping)
+                    std::cerr << "recording falls behind, dropping frames"
+                              << std::endl;
+                _dropping = true;
+                ++_droppedFrameCount;
+                return false;
+            }
+            _dropping = false;
+        }
+        _queuedBytes += byteCount;
+        _records.push_back(std::move(record));
+    }
+    _condition.notify_one();
+    return true;
+}
+
+size_t StreamRecorderWorker::getDroppedFrameCount() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _droppedFrameCount;
+}
+
+void StreamRecorderWorker::run()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true)
+    {
+        while (_records.empty() && _running)
+            _condition.wait(lock);
+
+        if (_records.empty())
+            return;
+
+        // Unlock write() while writing, the record releases its image data
+        size_t byteCount = 0;
+        {
+            const auto record = std::move(_records.front());
+            _records.pop_front();
+            lock.unlock();
+            _recorder.write(record);
+            byteCount = _getByteCount(record);
+        }
+        lock.lock();
+        _queuedBytes -= byteCount;
+    }
+}
+}
@@ -0,0 +1,111 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#ifndef DEFLECT_STREAMRECORDERWORKER_H
+#define DEFLECT_STREAMRECORDERWORKER_H
+
+#include <deflect/StreamRecorder.h>
+#include <deflect/api.h>
+
+#include <QThread>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace deflect
+{
+/**
+ * Write a StreamRecording from a dedicated thread.
+ *
+ * The records are queued by write() and written by the worker thread, so
+ * that a slow disk does not stall the thread which receives the frames. The
+ * queue is bounded by the size of the image data of its frame records: when
+ * the writer falls behind, the new frame records are dropped and reported.
+ * The open and close records are always written, so that the sources of the
+ * recording remain consistent.
+ */
+class StreamRecorderWorker : public QThread
+{
+public:
+    /**
+     * Create a new recording and start the writer thread.
+     *
+     * @param filename the file to create, replaced if it exists
+     * @param maxQueuedBytes the maximum size of the image data of the frame
+     *        records waiting to be written
+     * @throw std::runtime_error if the file cannot be created
+     */
+    DEFLECT_API StreamRecorderWorker(const QString& filename,
+                                     size_t maxQueuedBytes);
+
+    /** Write the records still queued, then finish the recording. */
+    DEFLECT_API ~StreamRecorderWorker();
+
+    /** @return the start of the recording, see FrameTimestamps::getTimeUs() */
+    DEFLECT_API int64_t getStartTimeUs() const;
+
+    /**
+     * Queue a record to be written.
+     *
+     * @param record the record, which shares its image data until written
+     * @return false if the frame record was dropped because the queue is full
+     */
+    DEFLECT_API bool write(StreamRecording::Record record);
+
+    /** @return the number of frame records dropped so far. */
+    DEFLECT_API size_t getDroppedFrameCount() const;
+
+private:
+    StreamRecorder _recorder;
+
+    std::deque<StreamRecording::Record> _records;
+    const size_t _maxQueuedBytes;
+    size_t _queuedBytes = 0;
+    size_t _droppedFrameCount = 0;
+    bool _dropping = false;
+    bool _running = true;
+    mutable std::mutex _mutex;
+    std::condition_variable _condition;
+
+    /** Write the queued records until stopped and the queue is empty. */
+    void run() final;
+};
+}
+
+#endif
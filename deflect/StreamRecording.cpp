@@ -0,0 +1,212 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#include "StreamRecording.h"
+
+#include "StreamRecorder.h"
+
+#include <QDataStream>
+#include <QFile>
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+namespace deflect
+{
+class StreamRecording::Impl
+{
+public:
+    explicit Impl(const QString& filename)
+        : file(filename)
+    {
+        if (!file.open(QIODevice::ReadOnly))
+            throw std::runtime_error("could not open recording: " +
+                                     filename.toStdString());
+
+        // Map the whole file when possible: the image data of the records are
+        // then views on it, without copies. The index and headers are always
+        // read from the file, whose offsets are not limited to 2 GiB.
+        mapping = mapFile(filename);
+        stream.setDevice(&file);
+        stream.setVersion(RECORDING_STREAM_VERSION);
+
+        quint32 magic = 0;
+        quint32 version = 0;
+        qint64 start = 0;
+        stream >> magic >> version >> start;
+        if (stream.status() != QDataStream::Ok || magic != RECORDING_MAGIC ||
+            version != RECORDING_FORMAT_VERSION)
+        {
+            throw std::runtime_error("not a supported recording: " +
+                                     filename.toStdString());
+        }
+        startTimeUs = start;
+
+        const auto firstRecord = stream.device()->pos();
+        if (!readIndex(firstRecord))
+            scanRecords(firstRecord);
+    }
+
+    bool readIndex(const qint64 firstRecord)
+    {
+        auto device = stream.device();
+        if (device->size() < firstRecord + RECORDING_TRAILER_SIZE)
+            return false;
+
+        device->seek(device->size() - RECORDING_TRAILER_SIZE);
+        qint64 indexOffset = 0;
+        quint32 count = 0;
+        quint32 magic = 0;
+        stream >> indexOffset >> count >> magic;
+        if (stream.status() != QDataStream::Ok ||
+            magic != RECORDING_INDEX_MAGIC || indexOffset < firstRecord)
+        {
+            stream.resetStatus();
+            return false;
+        }
+
+        device->seek(indexOffset);
+        offsets.resize(count);
+        times.resize(count);
+        for (quint32 i = 0; i < count; ++i)
+        {
+            qint64 timeUs = 0;
+            stream >> offsets[i] >> timeUs;
+            times[i] = timeUs;
+        }
+        return stream.status() == QDataStream::Ok;
+    }
+
+    void scanRecords(const qint64 firstRecord)
+    {
+        // No index: the recording was not stopped, keep the complete records
+        auto device = stream.device();
+        stream.resetStatus();
+        offsets.clear();
+        times.clear();
+        device->seek(firstRecord);
+
+        Record record;
+        while (!device->atEnd())
+        {
+            const auto offset = device->pos();
+            if (!readRecord(stream, record, mapping))
+                break;
+            offsets.push_back(offset);
+            times.push_back(record.timeUs);
+        }
+        stream.resetStatus();
+    }
+
+    /**
+     * Map a file with its own QFile, which unmaps it once destroyed, shared
+     * with the segments which reference the mapping.
+     */
+    static std::shared_ptr<const char> mapFile(const QString& filename)
+    {
+        std::shared_ptr<QFile> mappedFile{new QFile(filename)};
+        if (!mappedFile->open(QIODevice::ReadOnly) || mappedFile->size() <= 0)
+            return nullptr;
+
+        const auto data = mappedFile->map(0, mappedFile->size());
+        if (!data)
+            return nullptr;
+        return {mappedFile, reinterpret_cast<const char*>(data)};
+    }
+
+    QFile file;
+    std::shared_ptr<const char> mapping;
+    QDataStream stream;
+
+    int64_t startTimeUs = 0;
+    std::vector<qint64> offsets;
+    std::vector<int64_t> times;
+};
+
+StreamRecording::StreamRecording(const QString& filename)
+    : _impl(new Impl(filename))
+{
+}
+
+StreamRecording::~StreamRecording()
+{
+}
+
+size_t StreamRecording::getRecordCount() const
+{
+    return _impl->offsets.size();
+}
+
+int64_t StreamRecording::getDurationUs() const
+{
+    return _impl->times.empty() ? 0 : _impl->times.back();
+}
+
+int64_t StreamRecording::getStartTimeUs() const
+{
+    return _impl->startTimeUs;
+}
+
+bool StreamRecording::isMapped() const
+{
+    return _impl->mapping != nullptr;
+}
+
+size_t StreamRecording::findRecord(const int64_t timeUs) const
+{
+    const auto& times = _impl->times;
+    const auto it = std::lower_bound(times.begin(), times.end(), timeUs);
+    return std::distance(times.begin(), it);
+}
+
+StreamRecording::Record StreamRecording::read(const size_t index) const
+{
+    if (index >= _impl->offsets.size())
+        throw std::runtime_error("record index out of range");
+
+    Record record;
+    _impl->stream.device()->seek(_impl->offsets[index]);
+    if (!readRecord(_impl->stream, record, _impl->mapping))
+    {
+        _impl->stream.resetStatus();
+        throw std::runtime_error("could not read record");
+    }
+    return record;
+}
+}
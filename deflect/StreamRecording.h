@@ -0,0 +1,147 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#ifndef DEFLECT_STREAMRECORDING_H
+#define DEFLECT_STREAMRECORDING_H
+
+#include <deflect/Frame.h>
+#include <deflect/Segment.h>
+#include <deflect/api.h>
+#include <deflect/types.h>
+
+#include <QString>
+
+#include <cstdint>
+#include <memory>
+
+namespace deflect
+{
+/**
+ * A recording of the streams received by a Server.
+ *
+ * The file is an append-only sequence of records which keep the segments in
+ * their received encoding, followed by an index once the recording is
+ * stopped. Recordings without index, for instance after a crash, are indexed
+ * by scanning them when opened.
+ *
+ * The file is memory-mapped when possible, in which case the image data of
+ * the records read are views on the mapping, aligned to 64 bytes, instead of
+ * copies. Their segments keep the mapping alive, even after the recording is
+ * destroyed.
+ *
+ * @see Server::startRecording()
+ * @version 1.7
+ */
+class StreamRecording
+{
+public:
+    /** A message received from a source of a stream. */
+    struct Record
+    {
+        enum class Type : uint8_t
+        {
+            open,
+            frame,
+            close
+        };
+        Type type = Type::open;
+
+        /** Time of reception since the start of the recording. */
+        int64_t timeUs = 0;
+
+        QString uri;
+        size_t sourceIndex = 0;
+
+        /** @name Frame records */
+        //@{
+        FrameTimestamps timestamps;
+        Segments segments;
+        //@}
+    };
+
+    /**
+     * Open a recording.
+     *
+     * @param filename the recording to open
+     * @throw std::runtime_error if the file is not a valid recording
+     */
+    DEFLECT_API explicit StreamRecording(const QString& filename);
+
+    DEFLECT_API ~StreamRecording();
+
+    /** @return the number of records. */
+    DEFLECT_API size_t getRecordCount() const;
+
+    /** @return the time of the last record in microseconds. */
+    DEFLECT_API int64_t getDurationUs() const;
+
+    /**
+     * @return the start of the recording in the clock of the recording
+     *         Server, the reference of the frame timestamps.
+     */
+    DEFLECT_API int64_t getStartTimeUs() const;
+
+    /** @return true if the image data of the records are views on the file. */
+    DEFLECT_API bool isMapped() const;
+
+    /**
+     * Find a record by time, to seek in the recording.
+     *
+     * @param timeUs since the start of the recording
+     * @return the index of the first record at or after the given time,
+     *         getRecordCount() if there is none.
+     */
+    DEFLECT_API size_t findRecord(int64_t timeUs) const;
+
+    /**
+     * Read a record.
+     *
+     * @param index of the record, less than getRecordCount()
+     * @return the record, whose image data reference the recording if it is
+     *         mapped
+     * @throw std::runtime_error if the record cannot be read
+     */
+    DEFLECT_API Record read(size_t index) const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> _impl;
+};
+}
+
+#endif
@@ -0,0 +1,249 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#include "StreamReplayer.h"
+
+#ifdef DEFLECT_USE_LIBJPEGTURBO
+#include "DecodeTask.h"
+#include "FrameDecoder.h"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <thread>
+
+namespace
+{
+const int64_t MAX_SLEEP_US = 10000; // to react to stop requests
+
+/** @name Frames in flight, to replay as fast as the server keeps up. */
+//@{
+const size_t MAX_QUEUED_FRAMES = 4;
+const size_t MAX_DECODING_SEGMENTS_PER_THREAD = 4;
+const int64_t BACKPRESSURE_SLEEP_US = 1000;
+//@}
+
+void _shift(int64_t& timeUs, const int64_t shiftUs)
+{
+    if (timeUs >= 0)
+        timeUs += shiftUs;
+}
+}
+
+namespace deflect
+{
+StreamReplayer::StreamReplayer(const QString& filename,
+                               FrameDispatcher& dispatcher,
+                               const bool realTime)
+    : _recording(filename)
+    , _frameDispatcher(dispatcher)
+    , _realTime(realTime)
+{
+}
+
+StreamReplayer::~StreamReplayer()
+{
+    stop();
+}
+
+void StreamReplayer::stop()
+{
+    _stopped = true;
+    wait();
+}
+
+void StreamReplayer::setDecoder(FrameDecoder* decoder, const bool toYUV)
+{
+    _decoder = decoder;
+    _decodeToYUV = toYUV;
+}
+
+void StreamReplayer::run()
+{
+    using Type = StreamRecording::Record::Type;
+
+    // The stream index of each open source, released by its close message
+    std::map<std::pair<QString, size_t>, size_t> openSources;
+    const auto startUs = FrameTimestamps::getTimeUs();
+    for (size_t i = 0; i < _recording.getRecordCount() && !_stopped; ++i)
+    {
+        StreamRecording::Record record;
+        try
+        {
+            record = _recording.read(i);
+        }
+        catch (const std::runtime_error& e)
+        {
+            std::cerr << "Stopping replay: " << e.what() << std::endl;
+            break;
+        }
+
+        if (_realTime && !_waitUntil(startUs + record.timeUs))
+            break;
+
+        if (record.type == Type::frame && !_waitForFramesInFlight())
+            break;
+
+        // The frame timestamps move to the replay time, in the server clock
+        const auto recordedUs = _recording.getStartTimeUs() + record.timeUs;
+        const auto shiftUs = FrameTimestamps::getTimeUs() - recordedUs;
+
+        const auto source = std::make_pair(record.uri, record.sourceIndex);
+        auto it = openSources.find(source);
+        if (record.type == Type::open)
+        {
+            if (it != openSources.end())
+                continue;
+            const auto index = _frameDispatcher.getStreamIndex(record.uri);
+            it = openSources.emplace(source, index).first;
+        }
+        else if (it == openSources.end())
+        {
+            std::cerr << "Skipping record of a source which is not open"
+                      << std::endl;
+            continue;
+        }
+
+        _frameDispatcher.post(_toMessage(record, it->second, shiftUs));
+        if (record.type == Type::close)
+            openSources.erase(it);
+    }
+
+    // Close the sources of a replay stopped early, or of a recording stopped
+    // while they were open, so that they can be opened again
+    for (const auto& source : openSources)
+    {
+        FrameDispatcher::SourceMessage message;
+        message.type = FrameDispatcher::SourceMessage::Type::close;
+        message.streamIndex = source.second;
+        message.sourceIndex = source.first.second;
+        _frameDispatcher.post(std::move(message));
+    }
+}
+
+bool StreamReplayer::_waitUntil(const int64_t timeUs) const
+{
+    int64_t remainingUs = timeUs - FrameTimestamps::getTimeUs();
+    while (remainingUs > 0 && !_stopped)
+    {
+        const auto sleepUs = std::min(remainingUs, MAX_SLEEP_US);
+        std::this_thread::sleep_for(std::chrono::microseconds(sleepUs));
+        remainingUs = timeUs - FrameTimestamps::getTimeUs();
+    }
+    return !_stopped;
+}
+
+bool StreamReplayer::_waitForFramesInFlight() const
+{
+    size_t maxDecodingSegments = 0;
+#ifdef DEFLECT_USE_LIBJPEGTURBO
+    if (_decoder)
+        maxDecodingSegments =
+            MAX_DECODING_SEGMENTS_PER_THREAD * _decoder->getThreadCount();
+#endif
+    while (!_stopped &&
+           (_frameDispatcher.getQueuedFrameCount() >= MAX_QUEUED_FRAMES ||
+            (_decoder && *_decodingSegments >= maxDecodingSegments)))
+    {
+        std::this_thread::sleep_for(
+            std::chrono::microseconds(BACKPRESSURE_SLEEP_US));
+    }
+    return !_stopped;
+}
+
+FrameDispatcher::SourceMessage StreamReplayer::_toMessage(
+    StreamRecording::Record& record, const size_t streamIndex,
+    const int64_t timeShiftUs)
+{
+    using Type = FrameDispatcher::SourceMessage::Type;
+
+    FrameDispatcher::SourceMessage message;
+    message.streamIndex = streamIndex;
+    message.sourceIndex = record.sourceIndex;
+    switch (record.type)
+    {
+    case StreamRecording::Record::Type::open:
+        message.type = Type::open;
+        break;
+    case StreamRecording::Record::Type::frame:
+        message.type = Type::frame;
+        break;
+    case StreamRecording::Record::Type::close:
+        message.type = Type::close;
+        break;
+    }
+
+    message.timestamps = record.timestamps;
+    _shift(message.timestamps.captureUs, timeShiftUs);
+    _shift(message.timestamps.arrivalUs, timeShiftUs);
+
+    for (auto& segment : record.segments)
+    {
+        message.byteCount += segment.imageData.size();
+        const auto dataType = segment.parameters.dataType;
+        if (_decoder &&
+            (dataType == DataType::jpeg || dataType == DataType::fill))
+        {
+            _startDecoding(segment);
+        }
+    }
+    message.segments = std::move(record.segments);
+    return message;
+}
+
+void StreamReplayer::_startDecoding(Segment& segment)
+{
+#ifdef DEFLECT_USE_LIBJPEGTURBO
+    auto task = std::make_shared<DecodeTask>(segment);
+    task->toYUV = _decodeToYUV;
+    auto frameDispatcher = &_frameDispatcher;
+    auto decodingSegments = _decodingSegments;
+    ++*decodingSegments;
+    task->onFinished = [frameDispatcher, decodingSegments] {
+        --*decodingSegments;
+        frameDispatcher->notifyDecodingFinished();
+    };
+    segment.decodeTask = task;
+    startDecodeTask(*_decoder, std::move(task));
+#else
+    (void)segment;
+#endif
+}
+}
@@ -0,0 +1,112 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#ifndef DEFLECT_STREAMREPLAYER_H
+#define DEFLECT_STREAMREPLAYER_H
+
+#include <deflect/FrameDispatcher.h>
+#include <deflect/StreamRecording.h>
+#include <deflect/types.h>
+
+#include <QThread>
+
+#include <atomic>
+#include <memory>
+
+namespace deflect
+{
+/**
+ * Replay a StreamRecording into a FrameDispatcher.
+ *
+ * The records are posted as if they were received by ServerWorkers, which
+ * exercises the buffering and decoding paths of the Server without network.
+ * The frames are posted as fast as the dispatcher processes them and as the
+ * decoder decodes them, so that a long recording is not loaded at once.
+ */
+class StreamReplayer : public QThread
+{
+public:
+    /**
+     * Prepare the replay of a recording.
+     *
+     * @param filename the recording to replay
+     * @param dispatcher receiving the records
+     * @param realTime true to respect the original timing, false to replay as
+     *        fast as the frames are processed, with a few frames in flight
+     * @throw std::runtime_error if the recording cannot be opened
+     */
+    StreamReplayer(const QString& filename, FrameDispatcher& dispatcher,
+                   bool realTime);
+
+    /** Stop the replay. */
+    ~StreamReplayer();
+
+    /** Stop the replay, closing the sources which are still open. */
+    void stop();
+
+    /**
+     * Decode the segments on arrival, like ServerWorker::setDecoder().
+     *
+     * @param decoder to use, must outlive the replayer
+     * @param toYUV decode to YUV instead of RGBA
+     */
+    void setDecoder(FrameDecoder* decoder, bool toYUV);
+
+private:
+    StreamRecording _recording;
+    FrameDispatcher& _frameDispatcher;
+    const bool _realTime;
+    FrameDecoder* _decoder = nullptr;
+    bool _decodeToYUV = false;
+    std::atomic<bool> _stopped{false};
+
+    /** Shared with the decoding tasks, which may outlive the replayer. */
+    std::shared_ptr<std::atomic<size_t>> _decodingSegments{
+        std::make_shared<std::atomic<size_t>>(0)};
+
+    void run() final;
+    bool _waitUntil(int64_t timeUs) const;
+    bool _waitForFramesInFlight() const;
+    FrameDispatcher::SourceMessage _toMessage(StreamRecording::Record& record,
+                                              size_t streamIndex,
+                                              int64_t timeShiftUs);
+    void _startDecoding(Segment& segment);
+};
+}
+
+#endif
@@ -40,15 +40,23 @@
 
 #include "StreamSendWorker.h"
 
+#include "Frame.h"
 #include "NetworkProtocol.h"
 #include "Segment.h"
 #include "SizeHints.h"
+#include "Trace.h"
 
+#include <algorithm>
 #include <iostream>
 
+#include <QDataStream>
+
 namespace
 {
 const unsigned int SEGMENT_SIZE = 512;
+const std::chrono::milliseconds RECONNECT_DELAY_MIN{100};
+const std::chrono::milliseconds RECONNECT_DELAY_MAX{10000};
+const int FIRST_PROTOCOL_VERSION_WITH_FILL_SEGMENTS = 12;
 }
 
 namespace deflect
@@ -56,6 +64,7 @@ namespace deflect
 StreamSendWorker::StreamSendWorker(Socket& socket, const std::string& id)
     : _socket(socket)
     , _id(id)
+    , _reconnectDelay(RECONNECT_DELAY_MIN)
 {
     _imageSegmenter.setNominalSegmentDimensions(SEGMENT_SIZE, SEGMENT_SIZE);
 }
@@ -82,14 +91,13 @@ void StreamSendWorker::run()
         _requests.pop_front();
         lock.unlock();
 
-        bool success = true;
+        DEFLECT_TRACE_SCOPE("StreamSendWorker::request");
+        bool success = !_mustReconnect() || _reconnect();
         for (auto& task : request.tasks)
         {
-            if (!task())
-            {
-                success = false;
+            if (!success)
                 break;
-            }
+            success = task();
         }
         request.promise->set_value(success);
     }
@@ -115,6 +123,11 @@ void StreamSendWorker::stop()
     }
 }
 
+void StreamSendWorker::setAutoReconnect(const bool enable)
+{
+    _autoReconnect = enable;
+}
+
 Stream::Future StreamSendWorker::enqueueImage(const ImageWrapper& image,
                                               const bool finish)
 {
@@ -128,7 +141,12 @@ Stream::Future StreamSendWorker::enqueueImage(const ImageWrapper& image,
         return promise.get_future();
     }
 
-    auto tasks = std::vector<Task>{[this, image] { return _sendImage(image); }};
+    auto stampedImage = image;
+    if (stampedImage.captureTimeUs < 0)
+        stampedImage.captureTimeUs = FrameTimestamps::getTimeUs();
+
+    auto tasks = std::vector<Task>{
+        [this, stampedImage] { return _sendImage(stampedImage); }};
     if (finish)
         tasks.emplace_back([this] { return _sendFinish(); });
 
@@ -140,33 +158,38 @@ Stream::Future StreamSendWorker::enqueueFinish()
     return _enqueueRequest({[this] { return _sendFinish(); }});
 }
 
-Stream::Future StreamSendWorker::enqueueOpen()
+Stream::Future StreamSendWorker::enqueueClose()
 {
-    return _enqueueRequest({[this] {
-        return _send(MESSAGE_TYPE_PIXELSTREAM_OPEN,
-                     QByteArray::number(NETWORK_PROTOCOL_VERSION));
-    }});
+    _autoReconnect = false;
+    return _enqueueRequest({[this] { return _send(MESSAGE_TYPE_QUIT, {}); }});
 }
 
-Stream::Future StreamSendWorker::enqueueClose()
+Stream::Future StreamSendWorker::enqueueConnect()
 {
-    return _enqueueRequest({[this] { return _send(MESSAGE_TYPE_QUIT, {}); }});
+    return _enqueueRequest({[this] { return _connect(); }});
 }
 
 Stream::Future StreamSendWorker::enqueueBindRequest(const bool exclusive)
 {
     return _enqueueRequest({[this, exclusive] {
-        return _send(exclusive ? MESSAGE_TYPE_BIND_EVENTS_EX
-                               : MESSAGE_TYPE_BIND_EVENTS,
-                     {});
+        const auto type =
+            exclusive ? MESSAGE_TYPE_BIND_EVENTS_EX : MESSAGE_TYPE_BIND_EVENTS;
+        if (!_send(type, {}))
+            return false;
+        _bindRequest = type;
+        return true;
     }});
 }
 
 Stream::Future StreamSendWorker::enqueueSizeHints(const SizeHints& hints)
 {
     return _enqueueRequest({[this, hints] {
-        return _send(MESSAGE_TYPE_SIZE_HINTS,
-                     QByteArray{(const char*)(&hints), sizeof(SizeHints)});
+        const auto message =
+            QByteArray{(const char*)(&hints), sizeof(SizeHints)};
+        if (!_send(MESSAGE_TYPE_SIZE_HINTS, message))
+            return false;
+        _sizeHints = message;
+        return true;
     }});
 }
 
@@ -186,8 +209,59 @@ Stream::Future StreamSendWorker::_enqueueRequest(std::vector<Task>&& tasks)
     return promise->get_future();
 }
 
+bool StreamSendWorker::_connect()
+{
+    _opened = _socket.connectToHost() && _sendOpen();
+    return _opened;
+}
+
+bool StreamSendWorker::_mustReconnect() const
+{
+    return _autoReconnect && _opened && !_socket.isConnected();
+}
+
+bool StreamSendWorker::_reconnect()
+{
+    // Requests fail without blocking until the next attempt is due
+    if (Clock::now() < _nextReconnectAttempt)
+        return false;
+
+    // The new ServerWorker starts from a blank state, replay the current one
+    _currentView = View::mono;
+    if (_socket.connectToHost() && _sendOpen() &&
+        (_bindRequest == MESSAGE_TYPE_NONE || _send(_bindRequest, {})) &&
+        (_sizeHints.isEmpty() || _send(MESSAGE_TYPE_SIZE_HINTS, _sizeHints)))
+    {
+        _reconnectDelay = RECONNECT_DELAY_MIN;
+        return true;
+    }
+
+    _nextReconnectAttempt = Clock::now() + _reconnectDelay;
+    _reconnectDelay = std::min(2 * _reconnectDelay,
+                               Clock::duration(RECONNECT_DELAY_MAX));
+    return false;
+}
+
+bool StreamSendWorker::_sendOpen()
+{
+    // The client time lets the server estimate the offset between the clocks
+    const auto version = QByteArray::number(NETWORK_PROTOCOL_VERSION);
+    const auto time = QByteArray::number(qint64(FrameTimestamps::getTimeUs()));
+    return _send(MESSAGE_TYPE_PIXELSTREAM_OPEN, version + ' ' + time);
+}
+
 bool StreamSendWorker::_sendImage(const ImageWrapper& image)
 {
+    if (_frameCaptureTimeUs < 0 || image.captureTimeUs < _frameCaptureTimeUs)
+        _frameCaptureTimeUs = image.captureTimeUs;
+
+    // Opt-in: consumers which only handle jpeg and raw segments would read
+    // fill segments as pixels. Older servers can not decode them either.
+    const auto version = _socket.getServerProtocolVersion();
+    _imageSegmenter.setUniformTileDetection(
+        image.uniformTileDetection &&
+        version >= FIRST_PROTOCOL_VERSION_WITH_FILL_SEGMENTS);
+
     const auto sendFunc =
         std::bind(&StreamSendWorker::_sendSegment, this, std::placeholders::_1);
     return _imageSegmenter.generate(image, sendFunc);
@@ -216,7 +290,12 @@ bool StreamSendWorker::_sendSegment(const Segment& segment)
 
 bool StreamSendWorker::_sendFinish()
 {
-    return _send(MESSAGE_TYPE_PIXELSTREAM_FINISH_FRAME, {});
+    QByteArray message;
+    QDataStream stream(&message, QIODevice::WriteOnly);
+    stream << quint64(_frameIndex++) << qint64(_frameCaptureTimeUs)
+           << qint64(FrameTimestamps::getTimeUs());
+    _frameCaptureTimeUs = -1;
+    return _send(MESSAGE_TYPE_PIXELSTREAM_FINISH_FRAME, message);
 }
 
 bool StreamSendWorker::_send(const MessageType type, const QByteArray& message)
@@ -48,6 +48,8 @@
 
 #include <QThread>
 
+#include <atomic>
+#include <chrono>
 #include <deque>
 #include <mutex>
 
@@ -74,12 +76,17 @@ public:
     /** Stop the worker and clear any pending send tasks. */
     void stop();
 
+    /** @sa Stream::setAutoReconnect */
+    void setAutoReconnect(bool enable);
+
     /** Enqueue an image to be send during the execution of run(). */
     Stream::Future enqueueImage(const ImageWrapper& image, bool finish);
     Stream::Future enqueueFinish(); //!< Enqueue a finishFrame()
-    Stream::Future enqueueOpen();   //!< Enqueue an open message
     Stream::Future enqueueClose();  //!< Enqueue a close message
 
+    /** Enqueue the connection to the host followed by an open message. */
+    Stream::Future enqueueConnect();
+
     /** @sa Stream::registerForEvents */
     Stream::Future enqueueBindRequest(bool exclusive);
 
@@ -93,6 +100,7 @@ private:
     using Promise = std::promise<bool>;
     using PromisePtr = std::shared_ptr<Promise>;
     using Task = std::function<bool()>;
+    using Clock = std::chrono::steady_clock;
 
     struct Request
     {
@@ -110,12 +118,32 @@ private:
     bool _running = false;
     View _currentView = View::mono;
 
+    /** @name Timestamps of the frame being sent. */
+    //@{
+    uint64_t _frameIndex = 0;
+    int64_t _frameCaptureTimeUs = -1;
+    //@}
+
+    /** @name Automatic reconnection, state replayed after reconnecting. */
+    //@{
+    std::atomic<bool> _autoReconnect{false};
+    bool _opened = false;
+    MessageType _bindRequest = MESSAGE_TYPE_NONE;
+    QByteArray _sizeHints;
+    Clock::duration _reconnectDelay;
+    Clock::time_point _nextReconnectAttempt;
+    //@}
+
     /** Main QThread loop doing asynchronous processing of queued tasks. */
     void run() final;
 
     Stream::Future _enqueueRequest(std::vector<Task>&& actions);
 
     friend class deflect::test::Application; // to send pre-compressed segments
+    bool _connect();
+    bool _mustReconnect() const;
+    bool _reconnect();
+    bool _sendOpen();
     bool _sendImage(const ImageWrapper& image);
     bool _sendImageView(View view);
     bool _sendSegment(const Segment& segment);
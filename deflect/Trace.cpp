@@ -0,0 +1,379 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#include "Trace.h"
+
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace deflect
+{
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+// Events kept per thread, the oldest ones are overwritten
+const uint64_t BUFFER_CAPACITY = 1 << 16;
+
+const char* const TRACE_ENV_VAR = "DEFLECT_TRACE";
+
+struct TraceEvent
+{
+    const char* name;
+    int64_t startNs;
+    int64_t endNs;
+};
+
+// A slot of a ThreadBuffer, protected by a sequence lock: the sequence is
+// odd while the owning thread writes the event, and 2 * (index + 1) once the
+// event of the given index is written. Readers skip the slots which change
+// while they are read.
+struct Slot
+{
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<const char*> name{nullptr};
+    std::atomic<int64_t> startNs{0};
+    std::atomic<int64_t> endNs{0};
+};
+
+// Written only by the thread which owns it; head and tail allow concurrent
+// reads and clear() without locking the writer. The buffer of a thread which
+// exits is reused by the next thread which records events, after the unread
+// events of the previous one.
+struct ThreadBuffer
+{
+    ThreadBuffer()
+        : ring(new Slot[BUFFER_CAPACITY])
+    {
+    }
+
+    void add(const TraceEvent& event)
+    {
+        const auto index = head.load(std::memory_order_relaxed);
+        auto& slot = ring[index % BUFFER_CAPACITY];
+        slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.name.store(event.name, std::memory_order_relaxed);
+        slot.startNs.store(event.startNs, std::memory_order_relaxed);
+        slot.endNs.store(event.endNs, std::memory_order_relaxed);
+        slot.sequence.store(2 * index + 2, std::memory_order_release);
+        head.store(index + 1, std::memory_order_release);
+    }
+
+    /** @return false if the event was overwritten or is being written. */
+    bool read(const uint64_t index, TraceEvent& event) const
+    {
+        const auto& slot = ring[index % BUFFER_CAPACITY];
+        const auto sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence != 2 * index + 2)
+            return false;
+        event.name = slot.name.load(std::memory_order_relaxed);
+        event.startNs = slot.startNs.load(std::memory_order_relaxed);
+        event.endNs = slot.endNs.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot.sequence.load(std::memory_order_relaxed) == sequence;
+    }
+
+    /** @return the index of the oldest event which can still be read. */
+    uint64_t getBegin() const
+    {
+        const auto end = head.load(std::memory_order_acquire);
+        const auto oldest = end > BUFFER_CAPACITY ? end - BUFFER_CAPACITY : 0;
+        return std::max(tail.load(), oldest);
+    }
+
+    /** A thread which wrote the events of the buffer from firstIndex. */
+    struct Owner
+    {
+        uint64_t firstIndex;
+        uint32_t threadId;
+        QString name;
+    };
+
+    /** Forget the previous owners whose events are overwritten or cleared. */
+    void pruneOwners()
+    {
+        const auto begin = getBegin();
+        while (owners.size() > 1 && owners[1].firstIndex <= begin)
+            owners.erase(owners.begin());
+    }
+
+    std::unique_ptr<Slot[]> ring;
+    std::atomic<uint64_t> head{0};
+    std::atomic<uint64_t> tail{0};
+
+    /** The owners, the last one being current; guarded by the Registry. */
+    std::vector<Owner> owners;
+};
+
+double toUs(const int64_t ns)
+{
+    return ns / 1000.0;
+}
+
+QJsonObject makeThreadName(const qint64 pid, const ThreadBuffer::Owner& owner)
+{
+    QJsonObject args;
+    args["name"] = owner.name;
+
+    QJsonObject object;
+    object["name"] = "thread_name";
+    object["ph"] = "M";
+    object["pid"] = pid;
+    object["tid"] = double(owner.threadId);
+    object["args"] = args;
+    return object;
+}
+
+QJsonObject makeEvent(const qint64 pid, const ThreadBuffer::Owner& owner,
+                      const TraceEvent& event)
+{
+    QJsonObject object;
+    object["name"] = event.name;
+    object["cat"] = "deflect";
+    object["ph"] = "X";
+    object["ts"] = toUs(event.startNs);
+    object["dur"] = toUs(event.endNs - event.startNs);
+    object["pid"] = pid;
+    object["tid"] = double(owner.threadId);
+    return object;
+}
+
+bool writeFile(const QString& filename, const QByteArray& data)
+{
+    QSaveFile file(filename);
+    return file.open(QIODevice::WriteOnly) && file.write(data) >= 0 &&
+           file.commit();
+}
+
+class Registry
+{
+public:
+    Registry()
+        : origin(Clock::now())
+    {
+        exitFilename = qgetenv(TRACE_ENV_VAR);
+        enabled = !exitFilename.isEmpty();
+    }
+
+    ~Registry()
+    {
+        if (!exitFilename.isEmpty() && !writeFile(exitFilename, toJson()))
+        {
+            std::cerr << "Could not write trace to: "
+                      << exitFilename.toStdString() << std::endl;
+        }
+    }
+
+    /** Get a buffer for the calling thread, reusing a released one. */
+    std::shared_ptr<ThreadBuffer> acquire()
+    {
+        auto name = QThread::currentThread()->objectName();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto id = ++lastThreadId;
+        if (name.isEmpty())
+            name = QString("Thread %1").arg(id);
+
+        std::shared_ptr<ThreadBuffer> buffer;
+        if (freeBuffers.empty())
+        {
+            buffer = std::make_shared<ThreadBuffer>();
+            buffers.push_back(buffer);
+        }
+        else
+        {
+            buffer = std::move(freeBuffers.front());
+            freeBuffers.pop_front();
+            buffer->pruneOwners();
+        }
+        buffer->owners.push_back({buffer->head.load(), id, name});
+        return buffer;
+    }
+
+    /** Give back the buffer of a thread which exits, keeping its events. */
+    void release(std::shared_ptr<ThreadBuffer> buffer)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        freeBuffers.push_back(std::move(buffer));
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& buffer : buffers)
+            buffer->tail = buffer->head.load(std::memory_order_acquire);
+    }
+
+    QByteArray toJson()
+    {
+        const auto pid = QCoreApplication::applicationPid();
+
+        QJsonArray events;
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& buffer : buffers)
+        {
+            const auto& owners = buffer->owners;
+            const auto head = buffer->head.load(std::memory_order_acquire);
+            const auto begin = buffer->getBegin();
+
+            size_t owner = 0;
+            while (owner + 1 < owners.size() &&
+                   owners[owner + 1].firstIndex <= begin)
+            {
+                ++owner;
+            }
+            for (size_t i = owner; i < owners.size(); ++i)
+                events.append(makeThreadName(pid, owners[i]));
+
+            TraceEvent event{nullptr, 0, 0};
+            for (auto i = begin; i < head; ++i)
+            {
+                while (owner + 1 < owners.size() &&
+                       owners[owner + 1].firstIndex <= i)
+                {
+                    ++owner;
+                }
+                // The owning thread may be overwriting the oldest events
+                if (buffer->read(i, event) && event.name)
+                    events.append(makeEvent(pid, owners[owner], event));
+            }
+        }
+
+        QJsonObject document;
+        document["traceEvents"] = events;
+        document["displayTimeUnit"] = "ms";
+        return QJsonDocument{document}.toJson(QJsonDocument::Compact);
+    }
+
+    std::atomic<bool> enabled{false};
+    const Clock::time_point origin;
+    QString exitFilename;
+
+private:
+    std::mutex mutex;
+    uint32_t lastThreadId = 0;
+
+    // One per thread recording events at the same time: the buffers of the
+    // threads which exit are kept for their events, until reused
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    std::deque<std::shared_ptr<ThreadBuffer>> freeBuffers;
+};
+
+Registry& getRegistry()
+{
+    static Registry registry;
+    return registry;
+}
+
+// Read DEFLECT_TRACE when the library is loaded
+struct RegistryInitializer
+{
+    RegistryInitializer() { getRegistry(); }
+} registryInitializer;
+
+// Gives the buffer of its thread back to the Registry when the thread exits
+struct ThreadBufferOwner
+{
+    ~ThreadBufferOwner()
+    {
+        if (buffer)
+            getRegistry().release(std::move(buffer));
+    }
+    std::shared_ptr<ThreadBuffer> buffer;
+};
+
+ThreadBuffer& getThreadBuffer()
+{
+    thread_local ThreadBufferOwner owner;
+    if (!owner.buffer)
+        owner.buffer = getRegistry().acquire();
+    return *owner.buffer;
+}
+}
+
+void Trace::setEnabled(const bool enabled)
+{
+    getRegistry().enabled = enabled;
+}
+
+bool Trace::isEnabled()
+{
+    return getRegistry().enabled.load(std::memory_order_relaxed);
+}
+
+void Trace::clear()
+{
+    getRegistry().clear();
+}
+
+QByteArray Trace::toJson()
+{
+    return getRegistry().toJson();
+}
+
+bool Trace::write(const QString& filename)
+{
+    return writeFile(filename, toJson());
+}
+
+int64_t Trace::getTimeNs()
+{
+    const auto elapsed = Clock::now() - getRegistry().origin;
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+        .count();
+}
+
+void Trace::addEvent(const char* name, const int64_t startNs)
+{
+    getThreadBuffer().add({name, startNs, getTimeNs()});
+}
+}
@@ -0,0 +1,143 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#ifndef DEFLECT_TRACE_H
+#define DEFLECT_TRACE_H
+
+#include <deflect/api.h>
+
+#include <QByteArray>
+#include <QString>
+
+#include <cstdint>
+
+namespace deflect
+{
+/**
+ * Timeline of the streaming pipeline, to analyze stalls on the client and
+ * server sides.
+ *
+ * The library records the duration of its main steps in a ring buffer per
+ * thread. The buffer of a thread which exits is reused by the next thread,
+ * after its remaining events, so the memory used depends on the number of
+ * threads recording at the same time. Tracing is disabled by default and
+ * costs a single check per trace point. It is enabled by setEnabled(), or by
+ * setting the DEFLECT_TRACE environment variable to the name of a file where
+ * the trace is written when the process exits.
+ *
+ * The trace is written in the Chrome trace event JSON format, which can be
+ * opened by chrome://tracing and by the Perfetto UI.
+ *
+ * @version 1.7
+ */
+class Trace
+{
+public:
+    /** Enable or disable the recording of trace events. */
+    DEFLECT_API static void setEnabled(bool enabled);
+
+    /** @return true if trace events are recorded. */
+    DEFLECT_API static bool isEnabled();
+
+    /** Discard the events recorded so far. */
+    DEFLECT_API static void clear();
+
+    /**
+     * Get the recorded events.
+     *
+     * Only the most recent events of each thread are kept. The events which
+     * are recorded or overwritten during the call may be missing.
+     *
+     * @return the events in Chrome trace event JSON format.
+     */
+    DEFLECT_API static QByteArray toJson();
+
+    /**
+     * Write the recorded events to a file.
+     *
+     * @param filename the name of the JSON file to write
+     * @return true on success
+     * @see toJson()
+     */
+    DEFLECT_API static bool write(const QString& filename);
+
+    /** @internal @return the current time of the trace in nanoseconds. */
+    DEFLECT_API static int64_t getTimeNs();
+
+    /**
+     * @internal Add an event to the buffer of the calling thread.
+     * @param name of the event, must be a string literal
+     * @param startNs the start time of the event, see getTimeNs()
+     */
+    DEFLECT_API static void addEvent(const char* name, int64_t startNs);
+};
+
+/**
+ * Records the duration of the enclosing scope when tracing is enabled.
+ *
+ * @version 1.7
+ */
+class TraceScope
+{
+public:
+    /** @param name of the scope, must be a string literal */
+    explicit TraceScope(const char* name)
+        : _name(Trace::isEnabled() ? name : nullptr)
+        , _startNs(_name ? Trace::getTimeNs() : 0)
+    {
+    }
+
+    ~TraceScope()
+    {
+        if (_name)
+            Trace::addEvent(_name, _startNs);
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* const _name;
+    const int64_t _startNs;
+};
+}
+
+/** Trace the enclosing scope under the given name (a string literal). */
+#define DEFLECT_TRACE_SCOPE(name) deflect::TraceScope deflectTraceScope(name)
+
+#endif
@@ -76,10 +76,11 @@ void EventReceiver::_onEvent(const int socket)
     if (socket != _stream.getDescriptor())
         return;
 
-    while (_stream.hasEvent())
-    {
-        const Event& deflectEvent = _stream.getEvent();
+    std::vector<Event> events;
+    _stream.getEvents(events);
 
+    for (const auto& deflectEvent : events)
+    {
         switch (deflectEvent.type)
         {
         case Event::EVT_CLOSE:
@@ -91,6 +91,11 @@ QmlStreamer::Impl::Impl(const QString& qmlFile, const std::string& streamHost,
     if (!_quickView->load(qmlFile).get())
         throw std::runtime_error("Failed to setup/load QML");
 
+    // Connect in the background while the first frame is being rendered
+    _stream.reset(new Stream(_getDeflectStreamIdentifier(), _streamHost,
+                             Stream::defaultPortNumber,
+                             Stream::PendingFrames::queue));
+
 #ifdef __APPLE__
     _napSuspender.suspend();
 #endif
@@ -105,9 +110,10 @@ void QmlStreamer::Impl::_afterRender(const QImage image)
     if (!_sendFuture.valid() || !_sendFuture.get())
         return;
 
-    if (!_stream && !_setupDeflectStream())
+    if (!_eventReceiver && !_setupDeflectStream())
     {
         qWarning() << "Could not setup Deflect stream";
+        _sendFuture = make_ready_future(false); // stop streaming
         return;
     }
 
@@ -250,10 +256,8 @@ std::string QmlStreamer::Impl::_getDeflectStreamIdentifier() const
 
 bool QmlStreamer::Impl::_setupDeflectStream()
 {
-    if (!_stream)
-        _stream.reset(new Stream(_getDeflectStreamIdentifier(), _streamHost));
-
-    if (!_stream->isConnected())
+    // Only waits for what remains of the connection started by the ctor
+    if (!_stream->getConnectionFuture().get())
         return false;
 
     if (!_stream->registerForEvents())
@@ -75,11 +75,14 @@ constexpr typename std::underlying_type<E>::type as_underlying_type(E e)
 
 class EventReceiver;
 class Frame;
+class FrameDecoder;
 class FrameDispatcher;
 class SegmentDecoder;
 class Server;
 class Stream;
+class StreamRecording;
 
+struct DecodeTask;
 struct Event;
 struct ImageWrapper;
 struct MessageHeader;
@@ -0,0 +1,109 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#define BOOST_TEST_MODULE MPSCQueueTests
+#include <boost/test/unit_test.hpp>
+namespace ut = boost::unit_test;
+
+#include <deflect/MPSCQueue.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_CASE(testPopFromEmptyQueue)
+{
+    deflect::MPSCQueue<int> queue;
+    int value = 0;
+    BOOST_CHECK(!queue.pop(value));
+}
+
+BOOST_AUTO_TEST_CASE(testValuesArePoppedInOrder)
+{
+    deflect::MPSCQueue<std::unique_ptr<int>> queue;
+    for (int i = 0; i < 3; ++i)
+        queue.push(std::unique_ptr<int>(new int(i)));
+
+    std::unique_ptr<int> value;
+    for (int i = 0; i < 3; ++i)
+    {
+        BOOST_REQUIRE(queue.pop(value));
+        BOOST_CHECK_EQUAL(*value, i);
+    }
+    BOOST_CHECK(!queue.pop(value));
+}
+
+BOOST_AUTO_TEST_CASE(testConcurrentProducers)
+{
+    const int producerCount = 4;
+    const int valuesPerProducer = 10000;
+
+    deflect::MPSCQueue<std::pair<int, int>> queue;
+
+    std::vector<std::thread> producers;
+    for (int producer = 0; producer < producerCount; ++producer)
+    {
+        producers.emplace_back([&queue, producer] {
+            for (int i = 0; i < valuesPerProducer; ++i)
+                queue.push(std::make_pair(producer, i));
+        });
+    }
+
+    // The values of each producer must come out in the order they were pushed
+    std::vector<int> nextValue(producerCount, 0);
+    int received = 0;
+    std::pair<int, int> value;
+    while (received < producerCount * valuesPerProducer)
+    {
+        if (!queue.pop(value))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        BOOST_REQUIRE_EQUAL(value.second, nextValue[value.first]);
+        ++nextValue[value.first];
+        ++received;
+    }
+
+    for (auto& producer : producers)
+        producer.join();
+
+    BOOST_CHECK(!queue.pop(value));
+    for (int producer = 0; producer < producerCount; ++producer)
+        BOOST_CHECK_EQUAL(nextValue[producer], valuesPerProducer);
+}
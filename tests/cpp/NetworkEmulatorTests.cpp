@@ -0,0 +1,178 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#define BOOST_TEST_MODULE NetworkEmulatorTests
+#include <boost/test/unit_test.hpp>
+namespace ut = boost::unit_test;
+
+#include "MinimalGlobalQtApp.h"
+#include "NetworkEmulator.h"
+#include "Timer.h"
+
+#include <QTcpServer>
+#include <QTcpSocket>
+
+#include <memory>
+
+BOOST_GLOBAL_FIXTURE(MinimalGlobalQtApp);
+
+namespace
+{
+const int TIMEOUT_MS = 5000;
+
+QByteArray makeData(const int size)
+{
+    QByteArray data(size, 0);
+    for (int i = 0; i < size; ++i)
+        data[i] = char(i % 251);
+    return data;
+}
+}
+
+// A client connected to a local server through a NetworkEmulator
+struct EmulatedConnection
+{
+    EmulatedConnection(const LinkConditions& upstream,
+                       const LinkConditions& downstream = LinkConditions())
+    {
+        BOOST_REQUIRE(server.listen(QHostAddress::LocalHost));
+        emulator.reset(new NetworkEmulator("localhost", server.serverPort(),
+                                           upstream, downstream));
+        client.connectToHost("localhost", emulator->getPort());
+        BOOST_REQUIRE(client.waitForConnected(TIMEOUT_MS));
+        BOOST_REQUIRE(server.waitForNewConnection(TIMEOUT_MS));
+        serverSide.reset(server.nextPendingConnection());
+        BOOST_REQUIRE(serverSide);
+    }
+
+    void send(QTcpSocket& socket, const QByteArray& data)
+    {
+        socket.write(data);
+        while (socket.bytesToWrite() > 0)
+            BOOST_REQUIRE(socket.waitForBytesWritten(TIMEOUT_MS));
+    }
+
+    QByteArray receive(QTcpSocket& socket, const int size)
+    {
+        QByteArray data;
+        while (data.size() < size)
+        {
+            if (socket.bytesAvailable() == 0)
+                BOOST_REQUIRE(socket.waitForReadyRead(TIMEOUT_MS));
+            data.append(socket.readAll());
+        }
+        return data;
+    }
+
+    QTcpServer server;
+    std::unique_ptr<NetworkEmulator> emulator;
+    QTcpSocket client;
+    std::unique_ptr<QTcpSocket> serverSide;
+};
+
+BOOST_AUTO_TEST_CASE(testProfiles)
+{
+    LinkConditions conditions;
+    BOOST_CHECK(LinkConditions::fromProfile("wan", conditions));
+    BOOST_CHECK_EQUAL(conditions.bandwidthMbps, 1000.0);
+    BOOST_CHECK_EQUAL(conditions.latencyUs, 10000u);
+
+    BOOST_CHECK(LinkConditions::fromProfile("none", conditions));
+    BOOST_CHECK_EQUAL(conditions.bandwidthMbps, 0.0);
+    BOOST_CHECK_EQUAL(conditions.latencyUs, 0u);
+
+    BOOST_CHECK(!LinkConditions::fromProfile("carrier pigeon", conditions));
+}
+
+BOOST_AUTO_TEST_CASE(testLatencyIsAppliedInBothDirections)
+{
+    LinkConditions conditions;
+    conditions.latencyUs = 50000;
+    EmulatedConnection connection(conditions, conditions);
+
+    const auto data = makeData(1000);
+    Timer timer;
+    timer.start();
+    connection.send(connection.client, data);
+    BOOST_CHECK(connection.receive(*connection.serverSide, 1000) == data);
+    connection.send(*connection.serverSide, data);
+    BOOST_CHECK(connection.receive(connection.client, 1000) == data);
+    BOOST_CHECK_GE(timer.elapsed(), 0.1f);
+
+    BOOST_CHECK_EQUAL(connection.emulator->getUpstreamStatistics()
+                          .forwardedBytes,
+                      1000u);
+    BOOST_CHECK_EQUAL(connection.emulator->getDownstreamStatistics()
+                          .forwardedBytes,
+                      1000u);
+}
+
+BOOST_AUTO_TEST_CASE(testBandwidthLimitsTransferTime)
+{
+    LinkConditions conditions;
+    conditions.bandwidthMbps = 80.0;
+    EmulatedConnection connection(conditions);
+
+    // 1 MB at 80 Mbit/s takes 100 ms
+    const auto data = makeData(1000000);
+    Timer timer;
+    timer.start();
+    connection.send(connection.client, data);
+    BOOST_CHECK(connection.receive(*connection.serverSide, data.size()) ==
+                data);
+    BOOST_CHECK_GE(timer.elapsed(), 0.099f);
+    BOOST_CHECK_GT(connection.emulator->getUpstreamStatistics().maxQueuedBytes,
+                   0u);
+    BOOST_CHECK_EQUAL(connection.emulator->getUpstreamStatistics().queuedBytes,
+                      0u);
+}
+
+BOOST_AUTO_TEST_CASE(testJitterAndLossPreserveOrder)
+{
+    LinkConditions conditions;
+    conditions.jitterUs = 5000;
+    conditions.lossRate = 0.01;
+    conditions.retransmissionUs = 10000;
+    EmulatedConnection connection(conditions);
+
+    const auto data = makeData(500000);
+    for (int i = 0; i < data.size(); i += 1000)
+        connection.send(connection.client, data.mid(i, 1000));
+    BOOST_CHECK(connection.receive(*connection.serverSide, data.size()) ==
+                data);
+}
@@ -42,6 +42,7 @@
 namespace ut = boost::unit_test;
 
 #include <deflect/Event.h>
+#include <deflect/EventBatch.h>
 #include <deflect/MessageHeader.h>
 
 #include <QByteArray>
@@ -103,3 +104,45 @@ BOOST_AUTO_TEST_CASE(testEventSerialization)
     BOOST_CHECK_EQUAL(eventDeserialized.key, event.key);
     BOOST_CHECK_EQUAL(eventDeserialized.modifiers, event.modifiers);
 }
+
+BOOST_AUTO_TEST_CASE(testCompactEventBatchSerialization)
+{
+    QList<deflect::Event> events;
+
+    deflect::Event touch;
+    touch.type = deflect::Event::EVT_TOUCH_UPDATE;
+    touch.mouseX = 0.25;
+    touch.mouseY = 0.75;
+    touch.key = 3;
+    events.append(touch);
+
+    deflect::Event keyPress;
+    keyPress.type = deflect::Event::EVT_KEY_PRESS;
+    keyPress.mouseLeft = true;
+    keyPress.key = 'Y';
+    keyPress.modifiers = Qt::ControlModifier;
+    keyPress.text[0] = 'y';
+    events.append(keyPress);
+
+    const auto data =
+        deflect::serializeEvents(events, deflect::EventEncoding::compact);
+    BOOST_CHECK_LT(size_t(data.size()), 2 * deflect::Event::serializedSize);
+
+    std::deque<deflect::Event> deserialized;
+    BOOST_REQUIRE(deflect::deserializeEvents(
+        data, deflect::EventEncoding::compact, deserialized));
+    BOOST_REQUIRE_EQUAL(deserialized.size(), size_t(2));
+
+    BOOST_CHECK_EQUAL(deserialized[0].type, touch.type);
+    BOOST_CHECK_EQUAL(deserialized[0].mouseX, touch.mouseX);
+    BOOST_CHECK_EQUAL(deserialized[0].mouseY, touch.mouseY);
+    BOOST_CHECK_EQUAL(deserialized[0].key, touch.key);
+    BOOST_CHECK_EQUAL(deserialized[0].modifiers, 0);
+
+    BOOST_CHECK_EQUAL(deserialized[1].type, keyPress.type);
+    BOOST_CHECK(deserialized[1].mouseLeft);
+    BOOST_CHECK(!deserialized[1].mouseRight);
+    BOOST_CHECK_EQUAL(deserialized[1].key, keyPress.key);
+    BOOST_CHECK_EQUAL(deserialized[1].modifiers, keyPress.modifiers);
+    BOOST_CHECK_EQUAL(deserialized[1].text[0], 'y');
+}
@@ -317,6 +317,152 @@ void _insert(deflect::ReceiveBuffer& buffer, const size_t sourceIndex,
         buffer.insert(segment, sourceIndex);
 }
 
+BOOST_AUTO_TEST_CASE(TestOldestCompleteFramesDroppedBeyondMaximum)
+{
+    const size_t sourceIndex = 46;
+
+    deflect::ReceiveBuffer buffer;
+    buffer.addSource(sourceIndex);
+    buffer.setMaxCompleteFrames(2);
+
+    const auto testSegments = generateTestSegments();
+
+    // A fast producer never gets closed
+    for (size_t i = 0; i < 200; ++i)
+    {
+        deflect::Segment segment = testSegments[0];
+        segment.parameters.x = i;
+        buffer.insert(segment, sourceIndex);
+        BOOST_REQUIRE_NO_THROW(buffer.finishFrameForSource(sourceIndex));
+        BOOST_REQUIRE_LE(buffer.getCompleteFrameCount(), 2);
+    }
+    BOOST_CHECK_EQUAL(buffer.getDroppedFrameCount(), 198);
+
+    // The two latest frames are kept
+    BOOST_CHECK_EQUAL(buffer.popFrame()[0].parameters.x, 198);
+    BOOST_CHECK_EQUAL(buffer.popFrame()[0].parameters.x, 199);
+    BOOST_CHECK(!buffer.hasCompleteFrame());
+}
+
+BOOST_AUTO_TEST_CASE(TestBufferedBytesAccounting)
+{
+    const size_t sourceIndex1 = 46;
+    const size_t sourceIndex2 = 819;
+
+    deflect::ReceiveBuffer buffer;
+    buffer.addSource(sourceIndex1);
+    buffer.addSource(sourceIndex2);
+    BOOST_CHECK_EQUAL(buffer.getByteCount(), 0);
+
+    auto testSegments = generateTestSegments();
+    testSegments[0].imageData = QByteArray(100, 'a');
+    testSegments[1].imageData = QByteArray(200, 'b');
+    testSegments[2].imageData = QByteArray(300, 'c');
+
+    _insert(buffer, sourceIndex1, {testSegments[0], testSegments[1]});
+    buffer.finishFrameForSource(sourceIndex1);
+    _insert(buffer, sourceIndex2, {testSegments[2]});
+    BOOST_CHECK_EQUAL(buffer.getByteCount(sourceIndex1), 300);
+    BOOST_CHECK_EQUAL(buffer.getByteCount(sourceIndex2), 300);
+    BOOST_CHECK_EQUAL(buffer.getByteCount(), 600);
+
+    // No complete frame to drop yet
+    BOOST_CHECK(!buffer.dropFrame());
+
+    buffer.finishFrameForSource(sourceIndex2);
+    _insert(buffer, sourceIndex1, {testSegments[0]});
+    BOOST_CHECK(buffer.dropFrame());
+    BOOST_CHECK_EQUAL(buffer.getDroppedFrameCount(), 1);
+    BOOST_CHECK_EQUAL(buffer.getByteCount(sourceIndex1), 100);
+    BOOST_CHECK_EQUAL(buffer.getByteCount(sourceIndex2), 0);
+    BOOST_CHECK_EQUAL(buffer.getByteCount(), 100);
+
+    buffer.removeSource(sourceIndex1);
+    BOOST_CHECK_EQUAL(buffer.getByteCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(TestFramesDroppedConsistentlyAcrossSources)
+{
+    const size_t sourceIndex1 = 46;
+    const size_t sourceIndex2 = 819;
+
+    deflect::ReceiveBuffer buffer;
+    buffer.addSource(sourceIndex1);
+    buffer.addSource(sourceIndex2);
+    buffer.setMaxCompleteFrames(1);
+
+    const auto testSegments = generateTestSegments();
+
+    // Source 1 is three frames ahead, only complete frames are dropped
+    for (size_t i = 0; i < 3; ++i)
+    {
+        _insert(buffer, sourceIndex1, {testSegments[0], testSegments[1]});
+        buffer.finishFrameForSource(sourceIndex1);
+    }
+    BOOST_CHECK_EQUAL(buffer.getCompleteFrameCount(), 0);
+
+    for (size_t i = 0; i < 2; ++i)
+    {
+        _insert(buffer, sourceIndex2, {testSegments[2], testSegments[3]});
+        buffer.finishFrameForSource(sourceIndex2);
+    }
+    BOOST_CHECK_EQUAL(buffer.getCompleteFrameCount(), 1);
+    BOOST_CHECK_EQUAL(buffer.getDroppedFrameCount(), 1);
+
+    // The remaining frame has the segments of both sources
+    BOOST_CHECK_EQUAL(buffer.popFrame().size(), 4);
+    BOOST_CHECK(!buffer.hasCompleteFrame());
+
+    _insert(buffer, sourceIndex2, {testSegments[2], testSegments[3]});
+    buffer.finishFrameForSource(sourceIndex2);
+    BOOST_CHECK_EQUAL(buffer.popFrame().size(), 4);
+    BOOST_CHECK_EQUAL(buffer.getDroppedFrameCount(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(TestFrameTimestampsMergedAcrossSources)
+{
+    const size_t sourceIndex1 = 46;
+    const size_t sourceIndex2 = 819;
+
+    deflect::ReceiveBuffer buffer;
+    buffer.addSource(sourceIndex1);
+    buffer.addSource(sourceIndex2);
+
+    const auto testSegments = generateTestSegments();
+
+    deflect::FrameTimestamps timestamps1;
+    timestamps1.index = 7;
+    timestamps1.captureUs = 2000;
+    timestamps1.arrivalUs = 5000;
+
+    deflect::FrameTimestamps timestamps2;
+    timestamps2.index = 7;
+    timestamps2.captureUs = 1000;
+    timestamps2.arrivalUs = 6000;
+
+    const auto beforeUs = deflect::FrameTimestamps::getTimeUs();
+    _insert(buffer, sourceIndex1, {testSegments[0], testSegments[1]});
+    buffer.finishFrameForSource(sourceIndex1, timestamps1);
+    _insert(buffer, sourceIndex2, {testSegments[2], testSegments[3]});
+    buffer.finishFrameForSource(sourceIndex2, timestamps2);
+    BOOST_REQUIRE(buffer.hasCompleteFrame());
+
+    const auto merged = buffer.getFrameTimestamps();
+    BOOST_CHECK_EQUAL(merged.index, 7);
+    BOOST_CHECK_EQUAL(merged.captureUs, 1000);
+    BOOST_CHECK_EQUAL(merged.arrivalUs, 5000);
+    BOOST_CHECK_GE(merged.completeUs, beforeUs);
+    BOOST_CHECK_EQUAL(merged.dispatchUs, -1);
+
+    // Timestamps are consumed with their frame
+    buffer.popFrame();
+    _insert(buffer, sourceIndex1, {testSegments[0], testSegments[1]});
+    buffer.finishFrameForSource(sourceIndex1);
+    _insert(buffer, sourceIndex2, {testSegments[2], testSegments[3]});
+    buffer.finishFrameForSource(sourceIndex2);
+    BOOST_CHECK_EQUAL(buffer.getFrameTimestamps().captureUs, -1);
+}
+
 void _testStereoBuffer(deflect::ReceiveBuffer& buffer)
 {
     const auto segments = buffer.popFrame();
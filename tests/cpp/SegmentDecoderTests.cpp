@@ -276,6 +276,266 @@ BOOST_AUTO_TEST_CASE(testImageSegmentationWithCompressionAndDecompression)
                                   dataOut, dataOut + segment.imageData.size());
 }
 
+deflect::Segment makeJpegSegment(const unsigned int x, const unsigned int y)
+{
+    const auto data = makeTestImage();
+    deflect::ImageWrapper imageWrapper(data.data(), 8, 8, deflect::RGBA);
+    imageWrapper.compressionQuality = 100;
+
+    deflect::ImageJpegCompressor compressor;
+    deflect::Segment segment;
+    segment.parameters.x = x;
+    segment.parameters.y = y;
+    segment.parameters.width = 8;
+    segment.parameters.height = 8;
+    segment.parameters.dataType = deflect::DataType::jpeg;
+    segment.imageData = compressor.computeJpeg(imageWrapper, QRect(0, 0, 8, 8));
+    return segment;
+}
+
+BOOST_AUTO_TEST_CASE(testDecodeSegmentIntoCallerBuffer)
+{
+    const auto segment = makeJpegSegment(0, 0);
+    const auto data = makeTestImage();
+
+    // Rows padded to 64 bytes, the padding must be left untouched
+    const size_t pitch = 64;
+    std::vector<char> buffer(8 * pitch, 7);
+
+    deflect::SegmentDecoder decoder;
+    decoder.decode(segment, (uint8_t*)buffer.data(), pitch);
+
+    BOOST_CHECK(segment.parameters.dataType == deflect::DataType::jpeg);
+    for (size_t row = 0; row < 8; ++row)
+    {
+        const auto rowIn = data.data() + row * 8 * 4;
+        const auto rowOut = buffer.data() + row * pitch;
+        BOOST_CHECK_EQUAL_COLLECTIONS(rowIn, rowIn + 8 * 4, rowOut,
+                                      rowOut + 8 * 4);
+        BOOST_CHECK_EQUAL(rowOut[8 * 4], 7);
+        BOOST_CHECK_EQUAL(rowOut[pitch - 1], 7);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testDecodeSegmentsIntoFrameImage)
+{
+    // A 16x8 frame made of two 8x8 segments
+    deflect::Segments segments{makeJpegSegment(0, 0), makeJpegSegment(8, 0)};
+    const auto data = makeTestImage();
+
+    const size_t pitch = 16 * 4;
+    std::vector<char> frame(8 * pitch, 0);
+
+    deflect::SegmentDecoder decoder;
+    for (const auto& segment : segments)
+        decoder.decodeIntoFrame(segment, (uint8_t*)frame.data(), pitch);
+
+    for (size_t row = 0; row < 8; ++row)
+    {
+        const auto rowIn = data.data() + row * 8 * 4;
+        const auto rowOut = frame.data() + row * pitch;
+        BOOST_CHECK_EQUAL_COLLECTIONS(rowIn, rowIn + 8 * 4, rowOut,
+                                      rowOut + 8 * 4);
+        BOOST_CHECK_EQUAL_COLLECTIONS(rowIn, rowIn + 8 * 4, rowOut + 8 * 4,
+                                      rowOut + 16 * 4);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testDecodeSegmentOfUnexpectedSizeIntoCallerBuffer)
+{
+    auto segment = makeJpegSegment(0, 0);
+    segment.parameters.width = 16;
+
+    std::vector<char> buffer(16 * 8 * 4);
+    deflect::SegmentDecoder decoder;
+    BOOST_CHECK_THROW(decoder.decode(segment, (uint8_t*)buffer.data(), 64),
+                      std::runtime_error);
+}
+
+#ifndef DEFLECT_USE_LEGACY_LIBJPEGTURBO
+
+BOOST_AUTO_TEST_CASE(testDecodeSegmentToYUVIntoCallerPlanes)
+{
+    const auto segment = makeJpegSegment(0, 0);
+
+    // YUV444 planes with rows padded to 16 bytes
+    const size_t pitch = 16;
+    std::vector<char> y(8 * pitch), u(8 * pitch), v(8 * pitch);
+    uint8_t* const planes[3] = {(uint8_t*)y.data(), (uint8_t*)u.data(),
+                                (uint8_t*)v.data()};
+    const size_t pitches[3] = {pitch, pitch, pitch};
+
+    deflect::SegmentDecoder decoder;
+    BOOST_CHECK_EQUAL(decoder.decodeToYUV(segment, planes, pitches),
+                      deflect::ChromaSubsampling::YUV444);
+
+    for (size_t row = 0; row < 8; ++row)
+    {
+        const auto yRow = y.data() + row * pitch;
+        const auto uRow = u.data() + row * pitch;
+        const auto vRow = v.data() + row * pitch;
+        BOOST_CHECK_EQUAL_COLLECTIONS(yRow, yRow + 8, expectedYData.data(),
+                                      expectedYData.data() + 8);
+        BOOST_CHECK_EQUAL_COLLECTIONS(uRow, uRow + 8, expectedUData.data(),
+                                      expectedUData.data() + 8);
+        BOOST_CHECK_EQUAL_COLLECTIONS(vRow, vRow + 8, expectedVData.data(),
+                                      expectedVData.data() + 8);
+    }
+}
+
+#endif
+
+BOOST_AUTO_TEST_CASE(testDecodeSegmentAtReducedResolution)
+{
+    auto segment = makeJpegSegment(8, 16);
+
+    deflect::SegmentDecoder decoder;
+    BOOST_CHECK_EQUAL(decoder.decode(segment, 0.5), 0.5);
+
+    BOOST_CHECK_EQUAL(segment.parameters.dataType, deflect::DataType::rgba);
+    BOOST_CHECK_EQUAL(segment.parameters.x, 4);
+    BOOST_CHECK_EQUAL(segment.parameters.y, 8);
+    BOOST_CHECK_EQUAL(segment.parameters.width, 4);
+    BOOST_CHECK_EQUAL(segment.parameters.height, 4);
+    BOOST_REQUIRE_EQUAL(segment.imageData.size(), 4 * 4 * 4);
+
+    // The image is uniform, so is its reduced version
+    const auto data = makeTestImage();
+    const char* dataOut = segment.imageData.constData();
+    BOOST_CHECK_EQUAL_COLLECTIONS(data.data(), data.data() + 4 * 4 * 4,
+                                  dataOut, dataOut + 4 * 4 * 4);
+}
+
+BOOST_AUTO_TEST_CASE(testReducedResolutionUsesNearestLargerFactor)
+{
+    deflect::SegmentDecoder decoder;
+
+    auto segment = makeJpegSegment(0, 0);
+    BOOST_CHECK_EQUAL(decoder.decode(segment, 0.125), 0.125);
+    BOOST_CHECK_EQUAL(segment.parameters.width, 1);
+
+    segment = makeJpegSegment(0, 0);
+    const auto scale = decoder.decode(segment, 0.3);
+    BOOST_CHECK_GE(scale, 0.3);
+    BOOST_CHECK_LE(scale, 0.5);
+
+    segment = makeJpegSegment(0, 0);
+    BOOST_CHECK_EQUAL(decoder.decode(segment, 2.0), 1.0);
+    BOOST_CHECK_EQUAL(segment.parameters.width, 8);
+}
+
+#ifndef DEFLECT_USE_LEGACY_LIBJPEGTURBO
+
+BOOST_AUTO_TEST_CASE(testDecodeSegmentToYUVAtReducedResolution)
+{
+    auto segment = makeJpegSegment(0, 0);
+
+    deflect::SegmentDecoder decoder;
+    BOOST_CHECK_EQUAL(decoder.decodeToYUV(segment, 0.5), 0.5);
+
+    BOOST_CHECK_EQUAL(segment.parameters.dataType, deflect::DataType::yuv444);
+    BOOST_CHECK_EQUAL(segment.parameters.width, 4);
+    BOOST_CHECK_EQUAL(segment.parameters.height, 4);
+    BOOST_CHECK_EQUAL(segment.imageData.size(), 4 * 4 * 3);
+}
+
+#endif
+
+BOOST_AUTO_TEST_CASE(testUniformTilesAreSentAsFillSegments)
+{
+    // Two 8x8 tiles: the left one is uniform, the right one is not
+    std::vector<char> data;
+    const auto tile = makeTestImage();
+    for (size_t row = 0; row < 8; ++row)
+    {
+        for (size_t i = 0; i < 2; ++i)
+            data.insert(data.end(), tile.begin() + row * 8 * 4,
+                        tile.begin() + (row + 1) * 8 * 4);
+    }
+    data[(3 * 16 + 12) * 4] = 0;
+
+    deflect::ImageWrapper imageWrapper(data.data(), 16, 8, deflect::RGBA);
+    imageWrapper.compressionPolicy = deflect::COMPRESSION_ON;
+
+    deflect::Segments segments;
+    deflect::ImageSegmenter segmenter;
+    segmenter.setNominalSegmentDimensions(8, 8);
+    segmenter.setUniformTileDetection(true);
+    segmenter.generate(imageWrapper, std::bind(&append, std::ref(segments),
+                                               std::placeholders::_1));
+    BOOST_REQUIRE_EQUAL(segments.size(), 2);
+    if (segments[0].parameters.x != 0)
+        std::swap(segments[0], segments[1]);
+
+    BOOST_CHECK_EQUAL(segments[0].parameters.dataType,
+                      deflect::DataType::fill);
+    BOOST_CHECK_EQUAL(segments[0].imageData.size(), 5);
+    BOOST_CHECK_EQUAL(segments[1].parameters.dataType,
+                      deflect::DataType::jpeg);
+
+    deflect::SegmentDecoder decoder;
+    decoder.decode(segments[0]);
+    BOOST_CHECK_EQUAL(segments[0].parameters.dataType,
+                      deflect::DataType::rgba);
+    BOOST_REQUIRE_EQUAL(segments[0].imageData.size(), tile.size());
+
+    const char* dataOut = segments[0].imageData.constData();
+    BOOST_CHECK_EQUAL_COLLECTIONS(tile.data(), tile.data() + tile.size(),
+                                  dataOut, dataOut + tile.size());
+}
+
+deflect::Segment makeFillSegment(const deflect::ChromaSubsampling subsampling)
+{
+    deflect::Segment segment;
+    segment.parameters.width = 8;
+    segment.parameters.height = 8;
+    segment.parameters.dataType = deflect::DataType::fill;
+    const char fill[] = {char(128), char(128), char(128), char(255),
+                         char(subsampling)};
+    segment.imageData = QByteArray(fill, sizeof(fill));
+    return segment;
+}
+
+BOOST_AUTO_TEST_CASE(testDecodeFillSegmentAtReducedResolution)
+{
+    auto segment = makeFillSegment(deflect::ChromaSubsampling::YUV444);
+
+    deflect::SegmentDecoder decoder;
+    BOOST_CHECK_EQUAL(decoder.decode(segment, 0.5), 0.5);
+    BOOST_CHECK_EQUAL(segment.parameters.width, 4);
+    BOOST_CHECK_EQUAL(segment.parameters.height, 4);
+    BOOST_REQUIRE_EQUAL(segment.imageData.size(), 4 * 4 * 4);
+    BOOST_CHECK_EQUAL(segment.imageData.count(char(128)), 4 * 4 * 3);
+}
+
+#ifndef DEFLECT_USE_LEGACY_LIBJPEGTURBO
+
+BOOST_AUTO_TEST_CASE(testDecodeFillSegmentToYUV)
+{
+    auto segment = makeFillSegment(deflect::ChromaSubsampling::YUV420);
+
+    deflect::SegmentDecoder decoder;
+    BOOST_CHECK_EQUAL(decoder.decodeType(segment),
+                      deflect::ChromaSubsampling::YUV420);
+    decoder.decodeToYUV(segment);
+
+    // A grey colour has neutral chrominance
+    BOOST_CHECK_EQUAL(segment.parameters.dataType, deflect::DataType::yuv420);
+    BOOST_REQUIRE_EQUAL(segment.imageData.size(), 8 * 8 + 2 * 4 * 4);
+    BOOST_CHECK_EQUAL(segment.imageData.count(char(128)), 8 * 8 + 2 * 4 * 4);
+}
+
+#endif
+
+BOOST_AUTO_TEST_CASE(testDecodeInvalidFillSegment)
+{
+    auto segment = makeFillSegment(deflect::ChromaSubsampling::YUV444);
+    segment.imageData.chop(1);
+
+    deflect::SegmentDecoder decoder;
+    BOOST_CHECK_THROW(decoder.decode(segment), std::runtime_error);
+}
+
 BOOST_AUTO_TEST_CASE(testDecompressionOfInvalidData)
 {
     const QByteArray invalidJpegData{"notjpeg923%^#8"};
@@ -0,0 +1,119 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#define BOOST_TEST_MODULE ServerMetricsTests
+#include <boost/test/unit_test.hpp>
+namespace ut = boost::unit_test;
+
+#include <deflect/ServerMetrics.h>
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+BOOST_AUTO_TEST_CASE(testEmptyHistogram)
+{
+    const deflect::LatencyHistogram histogram;
+    BOOST_CHECK_EQUAL(histogram.count, 0u);
+    BOOST_CHECK_EQUAL(histogram.getMean(), 0.0);
+    BOOST_CHECK_EQUAL(histogram.getPercentile(50.0), 0.0);
+}
+
+BOOST_AUTO_TEST_CASE(testHistogramBuckets)
+{
+    deflect::LatencyHistogram histogram;
+    histogram.add(0.5);
+    histogram.add(3.0);
+    histogram.add(3.5);
+    histogram.add(1000.0);
+
+    BOOST_CHECK_EQUAL(histogram.count, 4u);
+    BOOST_CHECK_EQUAL(histogram.buckets[0], 1u);
+    BOOST_CHECK_EQUAL(histogram.buckets[2], 2u);
+    BOOST_CHECK_EQUAL(histogram.buckets[10], 1u);
+    BOOST_CHECK_EQUAL(histogram.getMean(), 1007.0 / 4);
+    BOOST_CHECK_EQUAL(histogram.maxUs, 1000.0);
+
+    BOOST_CHECK_EQUAL(histogram.getPercentile(50.0), 4.0);
+    BOOST_CHECK_EQUAL(histogram.getPercentile(100.0), 1000.0);
+}
+
+BOOST_AUTO_TEST_CASE(testHistogramClampsLongDurations)
+{
+    deflect::LatencyHistogram histogram;
+    histogram.add(1e12);
+    BOOST_CHECK_EQUAL(histogram.buckets.back(), 1u);
+    BOOST_CHECK_EQUAL(histogram.getPercentile(50.0), 1e12);
+}
+
+BOOST_AUTO_TEST_CASE(testMetricsToJson)
+{
+    deflect::SourceMetrics source;
+    source.sourceIndex = 3;
+    source.bytesReceived = 1024;
+
+    deflect::StreamMetrics stream;
+    stream.uri = "stream";
+    stream.framesDispatched = 7;
+    stream.framesDropped = 2;
+    stream.readyLatency.add(10.0);
+    stream.sources.push_back(source);
+
+    deflect::ServerMetrics metrics;
+    metrics.memoryBudget = 4096;
+    metrics.streams.push_back(stream);
+
+    const auto document = QJsonDocument::fromJson(metrics.toJson());
+    BOOST_REQUIRE(document.isObject());
+
+    const auto root = document.object();
+    BOOST_CHECK_EQUAL(root["memoryBudget"].toInt(), 4096);
+    BOOST_REQUIRE_EQUAL(root["streams"].toArray().size(), 1);
+
+    const auto streamObject = root["streams"].toArray()[0].toObject();
+    BOOST_CHECK_EQUAL(streamObject["uri"].toString().toStdString(), "stream");
+    BOOST_CHECK_EQUAL(streamObject["framesDispatched"].toInt(), 7);
+    BOOST_CHECK_EQUAL(streamObject["framesDropped"].toInt(), 2);
+    BOOST_CHECK_EQUAL(
+        streamObject["readyLatency"].toObject()["count"].toInt(), 1);
+
+    const auto sources = streamObject["sources"].toArray();
+    BOOST_REQUIRE_EQUAL(sources.size(), 1);
+    BOOST_CHECK_EQUAL(sources[0].toObject()["sourceIndex"].toInt(), 3);
+    BOOST_CHECK_EQUAL(sources[0].toObject()["bytesReceived"].toInt(), 1024);
+}
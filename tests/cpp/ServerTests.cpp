@@ -44,12 +44,27 @@ namespace ut = boost::unit_test;
 #include "MinimalGlobalQtApp.h"
 
 #include <deflect/EventReceiver.h>
+#include <deflect/Frame.h>
+#include <deflect/ImageWrapper.h>
+#include <deflect/MessageHeader.h>
+#include <deflect/NetworkProtocol.h>
 #include <deflect/Server.h>
 #include <deflect/Stream.h>
+#include <deflect/StreamRecorder.h>
 
+#include <algorithm>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <set>
+#include <vector>
 
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QElapsedTimer>
 #include <QMutex>
+#include <QTcpSocket>
+#include <QTemporaryDir>
 #include <QThread>
 #include <QWaitCondition>
 
@@ -235,3 +250,686 @@ BOOST_AUTO_TEST_CASE(testDataReceivedByServer)
     }
     BOOST_CHECK(!"reachable");
 }
+
+#ifdef DEFLECT_USE_LIBJPEGTURBO
+BOOST_AUTO_TEST_CASE(testFrameDecodedOnArrivalByServer)
+{
+    QThread serverThread;
+    deflect::Server* server = new deflect::Server(0 /* OS-chosen port */);
+    server->setDecoding(deflect::Server::Decoding::rgba);
+    server->moveToThread(&serverThread);
+    serverThread.connect(&serverThread, &QThread::finished, server,
+                         &deflect::Server::deleteLater);
+    serverThread.start();
+
+    QWaitCondition received;
+    QMutex mutex;
+    deflect::FramePtr frame;
+
+    server->connect(server, &deflect::Server::pixelStreamOpened,
+                    [&](const QString id) { server->requestFrame(id); });
+    server->connect(server, &deflect::Server::receivedFrame,
+                    [&](deflect::FramePtr frame_) {
+                        QMutexLocker lock(&mutex);
+                        frame = frame_;
+                        received.wakeAll();
+                    });
+
+    const unsigned int size = 64;
+    std::vector<uint8_t> pixels(size * size * 4, 128);
+    deflect::ImageWrapper image(pixels.data(), size, size, deflect::RGBA);
+    image.compressionPolicy = deflect::COMPRESSION_ON;
+
+    {
+        deflect::Stream stream(testStreamId.toStdString(), "localhost",
+                               server->serverPort());
+        BOOST_REQUIRE(stream.isConnected());
+        BOOST_REQUIRE(stream.sendAndFinish(image).get());
+
+        // Keep the stream open, closing it would cancel pending decodings
+        QMutexLocker lock(&mutex);
+        for (size_t i = 0; i < 20 && !frame; ++i)
+            received.wait(&mutex, 100 /*ms*/);
+    }
+    BOOST_REQUIRE(frame);
+    BOOST_REQUIRE_EQUAL(frame->segments.size(), 1);
+
+    const auto& segment = frame->segments.front();
+    BOOST_CHECK(segment.parameters.dataType == deflect::DataType::rgba);
+    BOOST_CHECK_EQUAL(segment.imageData.size(), int(pixels.size()));
+    BOOST_CHECK(!segment.decodeTask);
+
+    serverThread.quit();
+    serverThread.wait();
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(testMoveEventsCoalescedByServer)
+{
+    QThread serverThread;
+    deflect::Server* server = new deflect::Server(0 /* OS-chosen port */);
+    server->moveToThread(&serverThread);
+    serverThread.connect(&serverThread, &QThread::finished, server,
+                         &deflect::Server::deleteLater);
+    serverThread.start();
+
+    deflect::EventReceiver* eventReceiver = nullptr;
+    server->connect(server, &deflect::Server::registerToEvents,
+                    [&](const QString, const bool,
+                        deflect::EventReceiver* receiver,
+                        deflect::BoolPromisePtr success) {
+                        eventReceiver = receiver;
+                        success->set_value(true);
+                    });
+
+    {
+        deflect::Stream stream(testStreamId.toStdString(), "localhost",
+                               server->serverPort());
+        BOOST_REQUIRE(stream.isConnected());
+        BOOST_REQUIRE(stream.registerForEvents());
+        BOOST_REQUIRE(eventReceiver);
+
+        const size_t moveCount = 20;
+        std::vector<deflect::Event> sentEvents;
+        deflect::Event event;
+        event.type = deflect::Event::EVT_PRESS;
+        sentEvents.push_back(event);
+        event.type = deflect::Event::EVT_MOVE;
+        event.dx = 0.01;
+        for (size_t i = 1; i <= moveCount; ++i)
+        {
+            event.mouseX = 0.01 * i;
+            sentEvents.push_back(event);
+        }
+        event.type = deflect::Event::EVT_RELEASE;
+        event.dx = 0.0;
+        sentEvents.push_back(event);
+
+        for (const auto& evt : sentEvents)
+            QMetaObject::invokeMethod(eventReceiver, "processEvent",
+                                      Qt::QueuedConnection,
+                                      Q_ARG(deflect::Event, evt));
+
+        // Moves can be merged but never reordered with respect to press/release
+        std::vector<deflect::Event> receivedEvents;
+        for (size_t i = 0; i < 100; ++i)
+        {
+            while (stream.hasEvent())
+                receivedEvents.push_back(stream.getEvent());
+            if (!receivedEvents.empty() &&
+                receivedEvents.back().type == deflect::Event::EVT_RELEASE)
+            {
+                break;
+            }
+            QThread::msleep(10);
+        }
+
+        BOOST_REQUIRE_GE(receivedEvents.size(), size_t(3));
+        BOOST_REQUIRE_LE(receivedEvents.size(), sentEvents.size());
+        BOOST_CHECK_EQUAL(receivedEvents.front().type,
+                          deflect::Event::EVT_PRESS);
+        BOOST_CHECK_EQUAL(receivedEvents.back().type,
+                          deflect::Event::EVT_RELEASE);
+
+        double dx = 0.0;
+        for (size_t i = 1; i < receivedEvents.size() - 1; ++i)
+        {
+            BOOST_CHECK_EQUAL(receivedEvents[i].type, deflect::Event::EVT_MOVE);
+            dx += receivedEvents[i].dx;
+        }
+        BOOST_CHECK_CLOSE(dx, 0.01 * moveCount, 1e-3);
+        BOOST_CHECK_CLOSE(receivedEvents[receivedEvents.size() - 2].mouseX,
+                          0.01 * moveCount, 1e-3);
+    }
+
+    serverThread.quit();
+    serverThread.wait();
+}
+
+BOOST_AUTO_TEST_CASE(testStreamReconnectsAfterServerRestart)
+{
+    QThread serverThread;
+    deflect::Server* server = new deflect::Server(0 /* OS-chosen port */);
+    const auto port = server->serverPort();
+    server->moveToThread(&serverThread);
+    serverThread.connect(&serverThread, &QThread::finished, server,
+                         &deflect::Server::deleteLater);
+    const auto acceptBind = [](const QString, const bool,
+                               deflect::EventReceiver*,
+                               deflect::BoolPromisePtr success) {
+        success->set_value(true);
+    };
+    server->connect(server, &deflect::Server::registerToEvents, acceptBind);
+    serverThread.start();
+
+    deflect::SizeHints testHints;
+    testHints.maxWidth = 500;
+    testHints.preferredHeight = 200;
+
+    deflect::Stream stream(testStreamId.toStdString(), "localhost", port);
+    BOOST_REQUIRE(stream.isConnected());
+    stream.setAutoReconnect(true);
+    BOOST_REQUIRE(stream.registerForEvents());
+    stream.sendSizeHints(testHints);
+    BOOST_REQUIRE(stream.finishFrame().get());
+
+    // Restart the server on the same port
+    serverThread.quit();
+    serverThread.wait();
+
+    QThread newServerThread;
+    server = new deflect::Server(port);
+    server->moveToThread(&newServerThread);
+    newServerThread.connect(&newServerThread, &QThread::finished, server,
+                            &deflect::Server::deleteLater);
+
+    QMutex mutex;
+    deflect::SizeHints sizeHints;
+    size_t binds = 0;
+    server->connect(server, &deflect::Server::receivedSizeHints,
+                    [&](const QString, const deflect::SizeHints hints) {
+                        QMutexLocker lock(&mutex);
+                        sizeHints = hints;
+                    });
+    server->connect(server, &deflect::Server::registerToEvents,
+                    [&](const QString id, const bool exclusive,
+                        deflect::EventReceiver* receiver,
+                        deflect::BoolPromisePtr success) {
+                        acceptBind(id, exclusive, receiver, success);
+                        QMutexLocker lock(&mutex);
+                        ++binds;
+                    });
+    newServerThread.start();
+
+    // The first sends fail until the disconnection is detected and the
+    // reconnection succeeds, which replays the size hints and the bind.
+    bool restored = false;
+    for (size_t i = 0; i < 100 && !restored; ++i)
+    {
+        stream.finishFrame().wait();
+        QThread::msleep(50);
+        QMutexLocker lock(&mutex);
+        restored =
+            stream.isConnected() && sizeHints == testHints && binds > 0;
+    }
+    BOOST_CHECK(restored);
+
+    // The reply to the replayed bind is not mistaken for an event
+    QThread::msleep(200);
+    BOOST_CHECK(!stream.hasEvent());
+    BOOST_CHECK(stream.isRegisteredForEvents());
+
+    newServerThread.quit();
+    newServerThread.wait();
+}
+
+BOOST_AUTO_TEST_CASE(testMessageReceivedInSeveralChunksByServer)
+{
+    QThread serverThread;
+    deflect::Server* server = new deflect::Server(0 /* OS-chosen port */);
+    server->moveToThread(&serverThread);
+    serverThread.connect(&serverThread, &QThread::finished, server,
+                         &deflect::Server::deleteLater);
+    serverThread.start();
+
+    QWaitCondition received;
+    QMutex mutex;
+    QByteArray receivedData;
+    server->connect(server, &deflect::Server::receivedData,
+                    [&](const QString, QByteArray data) {
+                        QMutexLocker lock(&mutex);
+                        receivedData = data;
+                        received.wakeAll();
+                    });
+
+    QTcpSocket socket;
+    socket.connectToHost("localhost", server->serverPort());
+    BOOST_REQUIRE(socket.waitForConnected());
+
+    const auto serialize = [](const deflect::MessageType type,
+                              const QByteArray& payload) {
+        QByteArray message;
+        QDataStream stream(&message, QIODevice::WriteOnly);
+        stream << deflect::MessageHeader(type, payload.size(),
+                                         testStreamId.toStdString());
+        return message + payload;
+    };
+    const auto sentData = QByteArray(100000, 'x');
+    const auto version = QByteArray::number(NETWORK_PROTOCOL_VERSION);
+    const auto message =
+        serialize(deflect::MESSAGE_TYPE_PIXELSTREAM_OPEN, version) +
+        serialize(deflect::MESSAGE_TYPE_DATA, sentData);
+
+    // A slow client: the header and body are split in several chunks
+    const int chunkSize = 1000;
+    for (int i = 0; i < message.size(); i += chunkSize)
+    {
+        socket.write(message.mid(i, chunkSize));
+        socket.waitForBytesWritten();
+        if (i % (20 * chunkSize) == 0)
+            QThread::msleep(10);
+    }
+
+    {
+        QMutexLocker lock(&mutex);
+        if (receivedData.isEmpty())
+            received.wait(&mutex, 2000 /*ms*/);
+        BOOST_CHECK(receivedData == sentData);
+    }
+
+    serverThread.quit();
+    serverThread.wait();
+}
+
+namespace
+{
+struct ReceivedImageBuffers
+{
+    std::set<const char*> addresses;
+    size_t maxPooledBytes = 0;
+};
+
+/** Stream frames one by one, the server keeping or dropping them. */
+ReceivedImageBuffers _streamFramesOneByOne(const size_t frameCount,
+                                           const bool keepFrames)
+{
+    QThread serverThread;
+    deflect::Server* server = new deflect::Server(0 /* OS-chosen port */);
+    server->moveToThread(&serverThread);
+    serverThread.connect(&serverThread, &QThread::finished, server,
+                         &deflect::Server::deleteLater);
+    serverThread.start();
+
+    QWaitCondition received;
+    QMutex mutex;
+    size_t receivedFrames = 0;
+    std::vector<deflect::FramePtr> keptFrames;
+    ReceivedImageBuffers buffers;
+
+    server->connect(server, &deflect::Server::pixelStreamOpened,
+                    [&](const QString id) { server->requestFrame(id); });
+    server->connect(server, &deflect::Server::receivedFrame,
+                    [&](deflect::FramePtr frame) {
+                        QMutexLocker lock(&mutex);
+                        const auto& data = frame->segments[0].imageData;
+                        buffers.addresses.insert(data.constData());
+                        buffers.maxPooledBytes =
+                            std::max(buffers.maxPooledBytes,
+                                     server->getMetrics().pooledBytes);
+                        if (keepFrames)
+                            keptFrames.push_back(frame);
+                        ++receivedFrames;
+                        server->requestFrame(frame->uri);
+                        received.wakeAll();
+                    });
+
+    const unsigned int size = 64;
+    std::vector<uint8_t> pixels(size * size * 4, 0);
+    deflect::ImageWrapper image(pixels.data(), size, size, deflect::RGBA);
+    image.compressionPolicy = deflect::COMPRESSION_OFF;
+
+    {
+        deflect::Stream stream(testStreamId.toStdString(), "localhost",
+                               server->serverPort());
+        BOOST_REQUIRE(stream.isConnected());
+        for (size_t i = 0; i < frameCount; ++i)
+        {
+            BOOST_REQUIRE(stream.sendAndFinish(image).get());
+
+            // The next frame is only sent once this one was dispatched
+            QMutexLocker lock(&mutex);
+            for (size_t j = 0; j < 20 && receivedFrames <= i; ++j)
+                received.wait(&mutex, 100 /*ms*/);
+            BOOST_REQUIRE_EQUAL(receivedFrames, i + 1);
+        }
+    }
+
+    serverThread.quit();
+    serverThread.wait();
+    return buffers;
+}
+}
+
+BOOST_AUTO_TEST_CASE(testImageBuffersReusedOnceFramesAreDropped)
+{
+    const size_t frameCount = 10;
+    const size_t frameBytes = 64 * 64 * 4;
+
+    // Each frame still referenced needs its own buffer
+    const auto kept = _streamFramesOneByOne(frameCount, true);
+    BOOST_CHECK_EQUAL(kept.addresses.size(), frameCount);
+    BOOST_CHECK_GE(kept.maxPooledBytes, frameCount * frameBytes);
+
+    // Dropped frames give their buffer back for the next segments
+    const auto dropped = _streamFramesOneByOne(frameCount, false);
+    BOOST_CHECK_LE(dropped.addresses.size(), size_t(2));
+    BOOST_CHECK_GE(dropped.maxPooledBytes, frameBytes);
+    BOOST_CHECK_LT(dropped.maxPooledBytes, 3 * frameBytes);
+}
+
+namespace
+{
+const unsigned int largeImageSize = 128; // 64 KiB frames
+const unsigned int smallImageSize = 32;  // 4 KiB frames
+
+/** Process the events of the Server living in this thread until done. */
+bool _processEventsUntil(const std::function<bool()>& done)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!done() && timer.elapsed() < 5000 /*ms*/)
+    {
+        QCoreApplication::processEvents();
+        QThread::msleep(1);
+    }
+    return done();
+}
+
+size_t _getSourceCount(const deflect::Server& server)
+{
+    size_t count = 0;
+    for (const auto& stream : server.getMetrics().streams)
+        count += stream.sources.size();
+    return count;
+}
+
+size_t _getReceivedFrameCount(const deflect::Server& server)
+{
+    size_t count = 0;
+    for (const auto& stream : server.getMetrics().streams)
+        for (const auto& source : stream.sources)
+            count += source.framesReceived;
+    return count;
+}
+
+struct RawImage
+{
+    explicit RawImage(const unsigned int size)
+        : pixels(size * size * 4, 0)
+        , image(pixels.data(), size, size, deflect::RGBA)
+    {
+        image.compressionPolicy = deflect::COMPRESSION_OFF;
+    }
+    std::vector<uint8_t> pixels;
+    deflect::ImageWrapper image;
+};
+
+std::unique_ptr<deflect::Stream> _openStream(const deflect::Server& server,
+                                             const std::string& id)
+{
+    // Not blocking, the connection is accepted by this thread's event loop
+    return std::unique_ptr<deflect::Stream>{
+        new deflect::Stream(id, "localhost", server.serverPort(),
+                            deflect::Stream::PendingFrames::queue)};
+}
+}
+
+BOOST_AUTO_TEST_CASE(testMemoryBudgetEvictsFramesOfHeaviestStreamFirst)
+{
+    const size_t largeFrameBytes = largeImageSize * largeImageSize * 4;
+    const size_t budget = 100 * 1024;
+
+    deflect::Server server(0 /* OS-chosen port */);
+    server.setMaxBufferedFrames(4);
+    server.setMemoryBudget(budget);
+
+    QStringList closedStreams;
+    server.connect(&server, &deflect::Server::pixelStreamClosed,
+                   [&](const QString uri) { closedStreams << uri; });
+
+    const RawImage large(largeImageSize);
+    const RawImage small(smallImageSize);
+    {
+        auto heavy = _openStream(server, "heavy");
+        auto light = _openStream(server, "light");
+
+        // No frame is requested: all of them stay buffered until evicted
+        heavy->sendAndFinish(large.image);
+        light->sendAndFinish(small.image);
+        heavy->sendAndFinish(large.image);
+        BOOST_REQUIRE(_processEventsUntil(
+            [&] { return _getReceivedFrameCount(server) == 3; }));
+
+        BOOST_CHECK_EQUAL(server.getDroppedFrameCount("heavy"), size_t(1));
+        BOOST_CHECK_EQUAL(server.getDroppedFrameCount("light"), size_t(0));
+        BOOST_CHECK_EQUAL(server.getBufferedByteCount("heavy"),
+                          largeFrameBytes);
+        BOOST_CHECK_LE(server.getBufferedByteCount(), budget);
+        BOOST_CHECK(closedStreams.isEmpty());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testMemoryBudgetClosesHeaviestStreamWithoutCompleteFrame)
+{
+    const size_t budget = 32 * 1024;
+
+    deflect::Server server(0 /* OS-chosen port */);
+    server.setMemoryBudget(budget);
+
+    QStringList closedStreams;
+    server.connect(&server, &deflect::Server::pixelStreamClosed,
+                   [&](const QString uri) { closedStreams << uri; });
+
+    const RawImage large(largeImageSize);
+    const RawImage small(smallImageSize);
+    {
+        // The frames of the stream with two sources stay incomplete as long
+        // as only one of them has finished
+        auto heavy0 = _openStream(server, "heavy");
+        auto heavy1 = _openStream(server, "heavy");
+        auto light = _openStream(server, "light");
+        BOOST_REQUIRE(
+            _processEventsUntil([&] { return _getSourceCount(server) == 3; }));
+
+        light->sendAndFinish(small.image);
+        BOOST_REQUIRE(_processEventsUntil(
+            [&] { return _getReceivedFrameCount(server) == 1; }));
+
+        heavy0->sendAndFinish(large.image);
+        BOOST_REQUIRE(
+            _processEventsUntil([&] { return !closedStreams.isEmpty(); }));
+
+        // The complete frames are evicted first, but it is not enough
+        BOOST_CHECK_EQUAL(server.getDroppedFrameCount("light"), size_t(1));
+        BOOST_CHECK_EQUAL(closedStreams.join(",").toStdString(), "heavy");
+        BOOST_CHECK_EQUAL(server.getBufferedByteCount("heavy"), size_t(0));
+        BOOST_CHECK_LE(server.getBufferedByteCount(), budget);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testStreamIndicesReusedAfterClose)
+{
+    deflect::Server server(0 /* OS-chosen port */);
+
+    QStringList closedStreams;
+    QStringList receivedFrames;
+    server.connect(&server, &deflect::Server::pixelStreamOpened,
+                   [&](const QString uri) { server.requestFrame(uri); });
+    server.connect(&server, &deflect::Server::pixelStreamClosed,
+                   [&](const QString uri) { closedStreams << uri; });
+    server.connect(&server, &deflect::Server::receivedFrame,
+                   [&](deflect::FramePtr frame) {
+                       receivedFrames << frame->uri;
+                       server.requestFrame(frame->uri);
+                   });
+
+    const RawImage image(smallImageSize);
+
+    // The indices of short-lived streams are freed once they are closed
+    for (int i = 0; i < 10; ++i)
+    {
+        const auto id = QString("short%1").arg(i);
+        {
+            auto stream = _openStream(server, id.toStdString());
+            stream->sendAndFinish(image.image);
+            BOOST_REQUIRE(_processEventsUntil(
+                [&] { return receivedFrames.contains(id); }));
+        }
+        BOOST_REQUIRE(_processEventsUntil(
+            [&] { return closedStreams.contains(id); }));
+    }
+
+    // The reused indices still route the frames to their own stream
+    auto first = _openStream(server, "first");
+    auto second = _openStream(server, "second");
+    first->sendAndFinish(image.image);
+    second->sendAndFinish(image.image);
+    BOOST_REQUIRE(_processEventsUntil([&] {
+        return receivedFrames.contains("first") &&
+               receivedFrames.contains("second");
+    }));
+
+    QStringList openStreams;
+    for (const auto& stream : server.getMetrics().streams)
+        openStreams << stream.uri;
+    openStreams.sort();
+    BOOST_CHECK_EQUAL(openStreams.join(",").toStdString(), "first,second");
+    BOOST_CHECK_EQUAL(receivedFrames.size(), 12);
+}
+
+#ifdef DEFLECT_USE_LIBJPEGTURBO
+BOOST_AUTO_TEST_CASE(testMemoryBudgetCountsDecodedFrames)
+{
+    const size_t decodedFrameBytes = largeImageSize * largeImageSize * 4;
+
+    deflect::Server server(0 /* OS-chosen port */);
+    server.setDecoding(deflect::Server::Decoding::rgba);
+    server.setMaxBufferedFrames(2);
+
+    // A uniform image compresses to a small fraction of its decoded size
+    std::vector<uint8_t> pixels(decodedFrameBytes, 128);
+    deflect::ImageWrapper image(pixels.data(), largeImageSize, largeImageSize,
+                                deflect::RGBA);
+    image.compressionPolicy = deflect::COMPRESSION_ON;
+    {
+        auto stream = _openStream(server, "decoded");
+        stream->sendAndFinish(image);
+        stream->sendAndFinish(image);
+        BOOST_REQUIRE(_processEventsUntil(
+            [&] { return _getReceivedFrameCount(server) == 2; }));
+
+        BOOST_CHECK_GE(server.getBufferedByteCount("decoded"),
+                       2 * decodedFrameBytes);
+        BOOST_CHECK_EQUAL(server.getBufferedByteCount(),
+                          server.getBufferedByteCount("decoded"));
+
+        // The compressed frames alone would fit in this budget
+        const size_t budget = decodedFrameBytes * 3 / 2;
+        server.setMemoryBudget(budget);
+        BOOST_CHECK_EQUAL(server.getDroppedFrameCount("decoded"), size_t(1));
+        BOOST_CHECK_GE(server.getBufferedByteCount(), decodedFrameBytes);
+        BOOST_CHECK_LE(server.getBufferedByteCount(), budget);
+    }
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(testRecordedStreamReplayedByServer)
+{
+    QTemporaryDir dir;
+    const auto filename = dir.filePath("recording.dfr");
+    const RawImage image(smallImageSize);
+    {
+        deflect::Server server(0 /* OS-chosen port */);
+        server.startRecording(filename);
+
+        // A pause between the frames makes the real-time replays last
+        auto stream = _openStream(server, "recorded");
+        stream->sendAndFinish(image.image);
+        BOOST_REQUIRE(_processEventsUntil(
+            [&] { return _getReceivedFrameCount(server) == 1; }));
+        QThread::msleep(500);
+        stream->sendAndFinish(image.image);
+        BOOST_REQUIRE(_processEventsUntil(
+            [&] { return _getReceivedFrameCount(server) == 2; }));
+
+        // The recording ends while the stream is still open
+        server.stopRecording();
+    }
+
+    deflect::Server server(0 /* OS-chosen port */);
+    QStringList openedStreams;
+    QStringList closedStreams;
+    size_t receivedFrames = 0;
+    size_t finishedReplays = 0;
+    server.connect(&server, &deflect::Server::pixelStreamOpened,
+                   [&](const QString uri) {
+                       openedStreams << uri;
+                       server.requestFrame(uri);
+                   });
+    server.connect(&server, &deflect::Server::pixelStreamClosed,
+                   [&](const QString uri) { closedStreams << uri; });
+    server.connect(&server, &deflect::Server::receivedFrame,
+                   [&](deflect::FramePtr frame) {
+                       ++receivedFrames;
+                       server.requestFrame(frame->uri);
+                   });
+    server.connect(&server, &deflect::Server::replayFinished,
+                   [&] { ++finishedReplays; });
+
+    // The sources left open by the recording are closed at the end
+    server.replay(filename, false);
+    BOOST_REQUIRE(_processEventsUntil([&] { return finishedReplays == 1; }));
+    BOOST_REQUIRE(_processEventsUntil([&] { return !closedStreams.empty(); }));
+    BOOST_CHECK_EQUAL(openedStreams.join(",").toStdString(), "recorded");
+    BOOST_CHECK_EQUAL(closedStreams.join(",").toStdString(), "recorded");
+    BOOST_CHECK_GE(receivedFrames, size_t(1));
+
+    // A replay stopped early by the next one also closes its sources, so
+    // the same sources can be opened again
+    server.replay(filename, true);
+    BOOST_REQUIRE(
+        _processEventsUntil([&] { return openedStreams.size() == 2; }));
+    server.replay(filename, false);
+    BOOST_REQUIRE(_processEventsUntil([&] {
+        return openedStreams.size() == 3 && closedStreams.size() == 3;
+    }));
+    BOOST_CHECK_EQUAL(server.getBufferedByteCount(), size_t(0));
+
+    // Only the end of the last replay is notified
+    BOOST_REQUIRE(_processEventsUntil([&] { return finishedReplays >= 2; }));
+    QCoreApplication::processEvents();
+    BOOST_CHECK_EQUAL(finishedReplays, size_t(2));
+}
+
+BOOST_AUTO_TEST_CASE(testReplayLimitsFramesInFlight)
+{
+    using Record = deflect::StreamRecording::Record;
+
+    QTemporaryDir dir;
+    const auto filename = dir.filePath("recording.dfr");
+    const size_t frameCount = 50;
+    {
+        deflect::StreamRecorder recorder(filename);
+        Record record;
+        record.uri = "replayed";
+        recorder.write(record);
+
+        deflect::Segment segment;
+        segment.parameters.width = smallImageSize;
+        segment.parameters.height = smallImageSize;
+        segment.parameters.dataType = deflect::DataType::rgba;
+        segment.imageData.fill(0, smallImageSize * smallImageSize * 4);
+        record.type = Record::Type::frame;
+        record.segments.push_back(segment);
+        for (size_t i = 0; i < frameCount; ++i)
+            recorder.write(record);
+
+        record.type = Record::Type::close;
+        record.segments.clear();
+        recorder.write(record);
+    }
+
+    deflect::Server server(0 /* OS-chosen port */);
+    size_t finishedReplays = 0;
+    server.connect(&server, &deflect::Server::replayFinished,
+                   [&] { ++finishedReplays; });
+    server.replay(filename, false);
+
+    // The replay waits for the frames to be processed by this thread
+    QThread::msleep(200);
+    QCoreApplication::processEvents();
+    BOOST_CHECK_LT(_getReceivedFrameCount(server), frameCount);
+    BOOST_CHECK_EQUAL(finishedReplays, size_t(0));
+
+    BOOST_REQUIRE(_processEventsUntil([&] { return finishedReplays == 1; }));
+}
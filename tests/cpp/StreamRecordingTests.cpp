@@ -0,0 +1,227 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#define BOOST_TEST_MODULE StreamRecordingTests
+#include <boost/test/unit_test.hpp>
+namespace ut = boost::unit_test;
+
+#include <deflect/StreamRecorder.h>
+#include <deflect/StreamRecorderWorker.h>
+#include <deflect/StreamRecording.h>
+
+#include <QFile>
+#include <QTemporaryDir>
+
+namespace
+{
+using Record = deflect::StreamRecording::Record;
+
+Record makeRecord(const Record::Type type, const int64_t timeUs)
+{
+    Record record;
+    record.type = type;
+    record.timeUs = timeUs;
+    record.uri = "stream";
+    record.sourceIndex = 42;
+    return record;
+}
+
+Record makeFrameRecord(const int64_t timeUs)
+{
+    auto record = makeRecord(Record::Type::frame, timeUs);
+    record.timestamps.index = 3;
+    record.timestamps.captureUs = 1234;
+
+    deflect::Segment segment;
+    segment.parameters.x = 512;
+    segment.parameters.width = 256;
+    segment.parameters.height = 128;
+    segment.parameters.dataType = deflect::DataType::yuv420;
+    segment.view = deflect::View::right_eye;
+    segment.imageData = QByteArray(1000, 'x');
+    record.segments.push_back(segment);
+    return record;
+}
+
+void writeRecording(const QString& filename)
+{
+    deflect::StreamRecorder recorder(filename);
+    recorder.write(makeRecord(Record::Type::open, 0));
+    recorder.write(makeFrameRecord(100));
+    recorder.write(makeRecord(Record::Type::close, 200));
+}
+
+void checkRecording(const deflect::StreamRecording& recording)
+{
+    BOOST_REQUIRE_EQUAL(recording.getRecordCount(), 3);
+    BOOST_CHECK_EQUAL(recording.getDurationUs(), 200);
+
+    BOOST_CHECK(recording.read(0).type == Record::Type::open);
+    BOOST_CHECK(recording.read(2).type == Record::Type::close);
+
+    const auto frame = recording.read(1);
+    BOOST_CHECK(frame.type == Record::Type::frame);
+    BOOST_CHECK_EQUAL(frame.timeUs, 100);
+    BOOST_CHECK_EQUAL(frame.uri.toStdString(), "stream");
+    BOOST_CHECK_EQUAL(frame.sourceIndex, 42);
+    BOOST_CHECK_EQUAL(frame.timestamps.index, 3);
+    BOOST_CHECK_EQUAL(frame.timestamps.captureUs, 1234);
+    BOOST_CHECK_EQUAL(frame.timestamps.arrivalUs, -1);
+
+    BOOST_REQUIRE_EQUAL(frame.segments.size(), 1);
+    const auto& segment = frame.segments[0];
+    BOOST_CHECK_EQUAL(segment.parameters.x, 512);
+    BOOST_CHECK_EQUAL(segment.parameters.y, 0);
+    BOOST_CHECK_EQUAL(segment.parameters.width, 256);
+    BOOST_CHECK_EQUAL(segment.parameters.height, 128);
+    BOOST_CHECK(segment.parameters.dataType == deflect::DataType::yuv420);
+    BOOST_CHECK(segment.view == deflect::View::right_eye);
+    BOOST_CHECK(segment.imageData == QByteArray(1000, 'x'));
+    if (recording.isMapped())
+    {
+        const auto address = quintptr(segment.imageData.constData());
+        BOOST_CHECK_EQUAL(address % deflect::RECORDING_DATA_ALIGNMENT, 0);
+    }
+}
+}
+
+BOOST_AUTO_TEST_CASE(testReadIndexedRecording)
+{
+    QTemporaryDir dir;
+    const auto filename = dir.filePath("recording.dfr");
+    writeRecording(filename);
+
+    const deflect::StreamRecording recording(filename);
+    checkRecording(recording);
+    BOOST_CHECK_THROW(recording.read(3), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(testRecordingWrittenFromWorkerThread)
+{
+    QTemporaryDir dir;
+    const auto filename = dir.filePath("recording.dfr");
+    {
+        deflect::StreamRecorderWorker recorder(filename, 1024 * 1024);
+        BOOST_CHECK(recorder.write(makeRecord(Record::Type::open, 0)));
+        BOOST_CHECK(recorder.write(makeFrameRecord(100)));
+        BOOST_CHECK(recorder.write(makeRecord(Record::Type::close, 200)));
+        BOOST_CHECK_EQUAL(recorder.getDroppedFrameCount(), 0);
+    }
+    checkRecording(deflect::StreamRecording(filename));
+}
+
+BOOST_AUTO_TEST_CASE(testRecordingDropsFramesWhenWriterFallsBehind)
+{
+    QTemporaryDir dir;
+    const auto filename = dir.filePath("recording.dfr");
+    {
+        // No image data fits in the queue, as if the writer was behind
+        deflect::StreamRecorderWorker recorder(filename, 0);
+        BOOST_CHECK(recorder.write(makeRecord(Record::Type::open, 0)));
+        BOOST_CHECK(!recorder.write(makeFrameRecord(100)));
+        BOOST_CHECK(recorder.write(makeRecord(Record::Type::close, 200)));
+        BOOST_CHECK_EQUAL(recorder.getDroppedFrameCount(), 1);
+    }
+    const deflect::StreamRecording recording(filename);
+    BOOST_REQUIRE_EQUAL(recording.getRecordCount(), 2);
+    BOOST_CHECK(recording.read(0).type == Record::Type::open);
+    BOOST_CHECK(recording.read(1).type == Record::Type::close);
+}
+
+BOOST_AUTO_TEST_CASE(testFindRecordByTime)
+{
+    QTemporaryDir dir;
+    const auto filename = dir.filePath("recording.dfr");
+    writeRecording(filename);
+
+    const deflect::StreamRecording recording(filename);
+    BOOST_CHECK_EQUAL(recording.findRecord(0), 0);
+    BOOST_CHECK_EQUAL(recording.findRecord(50), 1);
+    BOOST_CHECK_EQUAL(recording.findRecord(100), 1);
+    BOOST_CHECK_EQUAL(recording.findRecord(200), 2);
+    BOOST_CHECK_EQUAL(recording.findRecord(201), 3);
+}
+
+BOOST_AUTO_TEST_CASE(testSegmentsOutliveRecording)
+{
+    QTemporaryDir dir;
+    const auto filename = dir.filePath("recording.dfr");
+    writeRecording(filename);
+
+    deflect::Segment segment;
+    {
+        const deflect::StreamRecording recording(filename);
+        segment = recording.read(1).segments.at(0);
+        BOOST_CHECK_EQUAL(bool(segment.imageDataOwner), recording.isMapped());
+    }
+    // The mapping is released with the last segment referencing it
+    BOOST_CHECK(segment.imageData == QByteArray(1000, 'x'));
+}
+
+BOOST_AUTO_TEST_CASE(testReadTruncatedRecording)
+{
+    QTemporaryDir dir;
+    const auto filename = dir.filePath("recording.dfr");
+    writeRecording(filename);
+
+    // Replace the index and trailer by a partially written record
+    const auto indexSize =
+        3 * 2 * sizeof(qint64) + deflect::RECORDING_TRAILER_SIZE;
+    QFile file(filename);
+    BOOST_REQUIRE(file.open(QIODevice::ReadWrite | QIODevice::Append));
+    BOOST_REQUIRE(file.resize(file.size() - indexSize));
+    file.write(QByteArray(7, '\0'));
+    file.close();
+
+    const deflect::StreamRecording recording(filename);
+    checkRecording(recording);
+}
+
+BOOST_AUTO_TEST_CASE(testInvalidRecording)
+{
+    QTemporaryDir dir;
+    const auto filename = dir.filePath("invalid.dfr");
+    {
+        QFile file(filename);
+        BOOST_REQUIRE(file.open(QIODevice::WriteOnly));
+        file.write("not a recording");
+    }
+    BOOST_CHECK_THROW(deflect::StreamRecording{filename}, std::runtime_error);
+    BOOST_CHECK_THROW(deflect::StreamRecording{dir.filePath("missing.dfr")},
+                      std::runtime_error);
+}
@@ -43,8 +43,14 @@ namespace ut = boost::unit_test;
 
 #include <deflect/Stream.h>
 
+#include <QElapsedTimer>
+#include <QHostAddress>
 #include <QString>
+#include <QTcpServer>
 #include <QtGlobal>
+
+#include <chrono>
+#include <future>
 #include <memory>
 
 namespace
@@ -116,3 +122,43 @@ BOOST_AUTO_TEST_CASE(testWhenNoSteamIdProvidedThenARandomOneIsGenerated)
         qunsetenv(STREAM_HOST_ENV_VAR);
     }
 }
+
+BOOST_AUTO_TEST_CASE(testAsynchronousConnectionToUnreachableHost)
+{
+    deflect::Stream stream("mystream", "somehost", 1701,
+                           deflect::Stream::PendingFrames::drop);
+    auto connection = stream.getConnectionFuture();
+    BOOST_REQUIRE(connection.valid());
+
+    const char pixel[4] = {0, 0, 0, 0};
+    deflect::ImageWrapper image(pixel, 1, 1, deflect::RGBA);
+    image.compressionPolicy = deflect::COMPRESSION_OFF;
+    BOOST_CHECK(!stream.sendAndFinish(image).get());
+
+    BOOST_CHECK(!connection.get());
+    BOOST_CHECK(!stream.isConnected());
+}
+
+BOOST_AUTO_TEST_CASE(testAsynchronousConnectionReturnsBeforeServerReplies)
+{
+    // The connection is accepted by the system but the server never sends
+    // its protocol version, so the connection attempt lasts until it times
+    // out (1 s).
+    QTcpServer silentServer;
+    BOOST_REQUIRE(silentServer.listen(QHostAddress::LocalHost));
+
+    QElapsedTimer timer;
+    timer.start();
+    deflect::Stream stream("mystream", "localhost", silentServer.serverPort(),
+                           deflect::Stream::PendingFrames::drop);
+    BOOST_CHECK_LT(timer.elapsed(), 500);
+
+    auto connection = stream.getConnectionFuture();
+    BOOST_REQUIRE(connection.valid());
+    BOOST_CHECK(connection.wait_for(std::chrono::seconds(0)) ==
+                std::future_status::timeout);
+    BOOST_CHECK(!stream.isConnected());
+
+    BOOST_CHECK(!connection.get());
+    BOOST_CHECK_GE(timer.elapsed(), 500);
+}
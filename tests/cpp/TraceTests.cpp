@@ -0,0 +1,139 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#define BOOST_TEST_MODULE TraceTests
+#include <boost/test/unit_test.hpp>
+namespace ut = boost::unit_test;
+
+#include <deflect/Trace.h>
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <set>
+#include <thread>
+
+namespace
+{
+QJsonArray getEvents(const char* name)
+{
+    const auto doc = QJsonDocument::fromJson(deflect::Trace::toJson());
+    QJsonArray events;
+    for (const auto& value : doc.object()["traceEvents"].toArray())
+    {
+        const auto event = value.toObject();
+        if (event["ph"].toString() == "X" && event["name"].toString() == name)
+            events.append(event);
+    }
+    return events;
+}
+
+void tracedFunction()
+{
+    DEFLECT_TRACE_SCOPE("tracedFunction");
+}
+}
+
+BOOST_AUTO_TEST_CASE(testNoEventsWhenDisabled)
+{
+    deflect::Trace::setEnabled(false);
+    deflect::Trace::clear();
+    tracedFunction();
+    BOOST_CHECK(!deflect::Trace::isEnabled());
+    BOOST_CHECK(getEvents("tracedFunction").isEmpty());
+}
+
+BOOST_AUTO_TEST_CASE(testScopesAreRecordedPerThread)
+{
+    deflect::Trace::setEnabled(true);
+    deflect::Trace::clear();
+
+    tracedFunction();
+    std::thread thread([] {
+        tracedFunction();
+        tracedFunction();
+    });
+    thread.join();
+    deflect::Trace::setEnabled(false);
+
+    const auto events = getEvents("tracedFunction");
+    BOOST_REQUIRE_EQUAL(events.size(), 3);
+
+    const auto mainTid = events[0].toObject()["tid"].toInt();
+    const auto otherTid = events[1].toObject()["tid"].toInt();
+    BOOST_CHECK_NE(mainTid, otherTid);
+    BOOST_CHECK_EQUAL(events[2].toObject()["tid"].toInt(), otherTid);
+
+    for (const auto& event : events)
+    {
+        BOOST_CHECK_GE(event.toObject()["ts"].toDouble(), 0.0);
+        BOOST_CHECK_GE(event.toObject()["dur"].toDouble(), 0.0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testClearDiscardsEvents)
+{
+    deflect::Trace::setEnabled(true);
+    tracedFunction();
+    deflect::Trace::clear();
+    tracedFunction();
+    deflect::Trace::setEnabled(false);
+
+    BOOST_CHECK_EQUAL(getEvents("tracedFunction").size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(testEventsOfExitedThreadsAreKept)
+{
+    deflect::Trace::setEnabled(true);
+    deflect::Trace::clear();
+
+    // Each thread reuses the buffer of the previous one, after its events
+    const int threadCount = 100;
+    for (int i = 0; i < threadCount; ++i)
+        std::thread(tracedFunction).join();
+    deflect::Trace::setEnabled(false);
+
+    const auto events = getEvents("tracedFunction");
+    BOOST_REQUIRE_EQUAL(events.size(), threadCount);
+
+    std::set<int> threadIds;
+    for (const auto& event : events)
+        threadIds.insert(event.toObject()["tid"].toInt());
+    BOOST_CHECK_EQUAL(threadIds.size(), size_t(threadCount));
+}
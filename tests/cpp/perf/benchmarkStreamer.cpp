@@ -37,6 +37,7 @@
 /* or implied, of The University of Texas at Austin.                 */
 /*********************************************************************/
 
+#include "NetworkEmulator.h"
 #include "Timer.h"
 
 #include <deflect/ImageSegmenter.h>
@@ -48,6 +49,7 @@
 #include <memory>
 #include <string>
 
+#include <QCoreApplication>
 #include <QImage>
 #include <QMutexLocker>
 
@@ -65,6 +67,7 @@ struct BenchmarkOptions
         , height(0)
         , nframes(0)
         , framerate(0)
+        , port(deflect::Stream::defaultPortNumber)
         , compress(false)
         , precompute(false)
         , quality(0)
@@ -92,6 +95,12 @@ struct BenchmarkOptions
                      "framerate at which to send frames (default: unlimited)")
             ("host", value<std::string>()->default_value("localhost"),
                      "Target Deflect server host")
+            ("port", value<unsigned short>()->default_value(
+                         deflect::Stream::defaultPortNumber),
+                     "Target Deflect server port")
+            ("link", value<std::string>()->default_value("none"),
+                     "emulated network link between the stream and the "
+                     "server: none, lan100, lan1g, wan or wifi")
             ("compress", "compress segments using jpeg")
             ("precompute", "send precomputed segments (no encoding time)")
             ("quality", value<unsigned int>()->default_value(80),
@@ -126,9 +135,15 @@ struct BenchmarkOptions
         nframes = vm["nframes"].as<unsigned int>();
         framerate = vm["framerate"].as<unsigned int>();
         host = vm["host"].as<std::string>();
+        port = vm["port"].as<unsigned short>();
         compress = vm.count("compress");
         precompute = vm.count("precompute");
         quality = vm["quality"].as<unsigned int>();
+
+        getHelp = getHelp ||
+                  !LinkConditions::fromProfile(vm["link"].as<std::string>(),
+                                               link);
+        emulateLink = vm["link"].as<std::string>() != "none";
     }
 
     boost::program_options::options_description desc;
@@ -139,6 +154,9 @@ struct BenchmarkOptions
     unsigned int nframes;
     unsigned int framerate;
     std::string host;
+    unsigned short port;
+    bool emulateLink = false;
+    LinkConditions link;
     bool compress;
     bool precompute;
     unsigned int quality;
@@ -154,9 +172,10 @@ namespace test
 class Application
 {
 public:
-    explicit Application(const BenchmarkOptions& options)
+    Application(const BenchmarkOptions& options, const std::string& host,
+                const unsigned short port)
         : _options(options)
-        , _stream(new deflect::Stream(options.id, options.host))
+        , _stream(new deflect::Stream(options.id, host, port))
     {
         generateNoiseImage(_options.width, _options.height);
         generateJpegSegments();
@@ -286,7 +305,22 @@ int main(int argc, char** argv)
         return 0;
     }
 
-    deflect::test::Application benchmarkStreamer(options);
+    QCoreApplication app(argc, argv);
+
+    std::string host = options.host;
+    unsigned short port = options.port;
+
+    // Shape the traffic of the stream through a local proxy
+    std::unique_ptr<NetworkEmulator> emulator;
+    if (options.emulateLink)
+    {
+        emulator.reset(new NetworkEmulator(QString::fromStdString(host), port,
+                                           options.link, options.link));
+        host = "localhost";
+        port = emulator->getPort();
+    }
+
+    deflect::test::Application benchmarkStreamer(options, host, port);
 
     Timer timer;
     timer.start();
@@ -315,5 +349,14 @@ int main(int argc, char** argv)
     std::cout << "Throughput [Mbytes/sec]: "
               << counter * frameSize / time / MEGABYTE << std::endl;
 
+    if (emulator)
+    {
+        const auto link = emulator->getUpstreamStatistics();
+        std::cout << "Link forwarded [MB/s]: "
+                  << link.forwardedBytes / time / MEGABYTE << std::endl;
+        std::cout << "Link max queued [MB]: "
+                  << double(link.maxQueuedBytes) / MEGABYTE << std::endl;
+    }
+
     return 0;
 }
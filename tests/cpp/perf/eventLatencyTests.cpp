@@ -0,0 +1,211 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#define BOOST_TEST_MODULE EventLatency
+#include <boost/test/unit_test.hpp>
+namespace ut = boost::unit_test;
+
+#include "MinimalGlobalQtApp.h"
+#include "Timer.h"
+
+#include <deflect/EventReceiver.h>
+#include <deflect/Frame.h>
+#include <deflect/Server.h>
+#include <deflect/Stream.h>
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <vector>
+
+#include <QThread>
+
+// Measures the round-trip latency of events sent by the server to a stream,
+// first on an idle link and then while a raw 4K stream saturates the link.
+// Reading events must not be blocked by the concurrent sending of frames.
+
+#define WIDTH (3840u)
+#define HEIGHT (2160u)
+#define NBYTES (WIDTH * HEIGHT * 4u)
+#define NEVENTS (100u)
+#define EVENT_TIMEOUT_S (5.f)
+
+BOOST_GLOBAL_FIXTURE(MinimalGlobalQtApp);
+
+namespace
+{
+const std::string testStreamId("eventlatency");
+
+struct Latency
+{
+    float mean = 0.f;
+    float max = 0.f;
+    size_t received = 0;
+};
+
+bool _isReady(const deflect::Stream::Future& future)
+{
+    return future.wait_for(std::chrono::seconds(0)) ==
+           std::future_status::ready;
+}
+}
+
+class EventThread : public QThread
+{
+public:
+    EventThread(const quint16 port,
+                const std::atomic<deflect::EventReceiver*>& receiver)
+        : _port(port)
+        , _receiver(receiver)
+    {
+    }
+
+    // Results of the run, only to be checked once the thread has finished
+    // because the Boost.Test assertions are not thread-safe.
+    bool connected = false;
+    bool registered = false;
+    Latency idle;
+    Latency busy;
+
+private:
+    const quint16 _port;
+    const std::atomic<deflect::EventReceiver*>& _receiver;
+
+    void run() final
+    {
+        deflect::Stream stream(testStreamId, "localhost", _port);
+        connected = stream.isConnected();
+        registered = stream.registerForEvents();
+
+        if (stream.isRegisteredForEvents())
+        {
+            idle = _measureLatency(stream, nullptr);
+
+            std::vector<uint8_t> pixels(NBYTES, 0);
+            deflect::ImageWrapper image(pixels.data(), WIDTH, HEIGHT,
+                                        deflect::RGBA);
+            image.compressionPolicy = deflect::COMPRESSION_OFF;
+            busy = _measureLatency(stream, &image);
+        }
+        QCoreApplication::instance()->exit();
+    }
+
+    Latency _measureLatency(deflect::Stream& stream,
+                            const deflect::ImageWrapper* image)
+    {
+        // keep the link busy by sending a new frame as soon as the previous
+        // one is done
+        deflect::Stream::Future sendFuture;
+        const auto keepSending = [&] {
+            if (image && (!sendFuture.valid() || _isReady(sendFuture)))
+                sendFuture = stream.sendAndFinish(*image);
+        };
+
+        Latency latency;
+        Timer timer;
+        for (size_t i = 0; i < NEVENTS; ++i)
+        {
+            keepSending();
+
+            deflect::Event event;
+            event.type = deflect::Event::EVT_MOVE;
+            event.key = int(i);
+
+            timer.start();
+            QMetaObject::invokeMethod(_receiver.load(), "processEvent",
+                                      Qt::QueuedConnection,
+                                      Q_ARG(deflect::Event, event));
+
+            while (!stream.hasEvent() && timer.elapsed() < EVENT_TIMEOUT_S)
+                keepSending();
+
+            if (!stream.hasEvent() || stream.getEvent().key != int(i))
+                break;
+
+            const float elapsed = timer.elapsed();
+            latency.mean += elapsed;
+            latency.max = std::max(latency.max, elapsed);
+            ++latency.received;
+        }
+        if (latency.received > 0)
+            latency.mean /= latency.received;
+
+        if (sendFuture.valid())
+            sendFuture.wait();
+        return latency;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(testEventLatencyWhileStreamingRawImages)
+{
+    deflect::Server server(0 /* OS-chosen port */);
+
+    std::atomic<deflect::EventReceiver*> eventReceiver{nullptr};
+    server.connect(&server, &deflect::Server::registerToEvents,
+                   [&](const QString, const bool,
+                       deflect::EventReceiver* receiver,
+                       deflect::BoolPromisePtr success) {
+                       eventReceiver = receiver;
+                       success->set_value(true);
+                   });
+
+    // consume frames as fast as possible
+    server.connect(&server, &deflect::Server::pixelStreamOpened,
+                   [&](const QString uri) { server.requestFrame(uri); });
+    server.connect(&server, &deflect::Server::receivedFrame,
+                   [&](deflect::FramePtr frame) {
+                       server.requestFrame(frame->uri);
+                   });
+
+    EventThread thread(server.serverPort(), eventReceiver);
+    thread.start();
+    QCoreApplication::instance()->exec();
+    BOOST_REQUIRE(thread.wait());
+
+    BOOST_CHECK(thread.connected);
+    BOOST_REQUIRE(thread.registered);
+
+    std::cout << "idle link: " << thread.idle.mean * 1000.f << " ms mean, "
+              << thread.idle.max * 1000.f << " ms max" << std::endl;
+    std::cout << "raw 4K stream: " << thread.busy.mean * 1000.f
+              << " ms mean, " << thread.busy.max * 1000.f << " ms max"
+              << std::endl;
+
+    BOOST_CHECK_EQUAL(thread.idle.received, NEVENTS);
+    BOOST_CHECK_EQUAL(thread.busy.received, NEVENTS);
+}
@@ -0,0 +1,166 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#define BOOST_TEST_MODULE FrameDecoder
+#include <boost/test/unit_test.hpp>
+namespace ut = boost::unit_test;
+
+#include "Timer.h"
+
+#include <deflect/Frame.h>
+#include <deflect/FrameDecoder.h>
+#include <deflect/ImageSegmenter.h>
+#include <deflect/ImageWrapper.h>
+#include <deflect/SegmentDecoder.h>
+
+#include <QMutex>
+
+#include <iostream>
+
+// Compares the decoding of whole 4K and 8K frames by a single SegmentDecoder
+// and by the parallel FrameDecoder.
+
+namespace
+{
+const unsigned int SEGMENT_SIZE = 512;
+const size_t NFRAMES = 20;
+
+deflect::Segments makeJpegSegments(const unsigned int width,
+                                   const unsigned int height)
+{
+    // A gradient with some noise, representative of rendered content
+    std::vector<uint8_t> pixels(width * height * 4);
+    for (size_t i = 0; i < width * height; ++i)
+    {
+        const auto x = i % width;
+        const auto y = i / width;
+        pixels[i * 4] = uint8_t(x * 255 / width);
+        pixels[i * 4 + 1] = uint8_t(y * 255 / height);
+        pixels[i * 4 + 2] = uint8_t(qrand() % 64);
+        pixels[i * 4 + 3] = 255;
+    }
+    deflect::ImageWrapper image(pixels.data(), width, height, deflect::RGBA);
+    image.compressionPolicy = deflect::COMPRESSION_ON;
+
+    deflect::Segments segments;
+    QMutex mutex;
+    deflect::ImageSegmenter segmenter;
+    segmenter.setNominalSegmentDimensions(SEGMENT_SIZE, SEGMENT_SIZE);
+    segmenter.generate(image, [&](const deflect::Segment& segment) {
+        QMutexLocker lock(&mutex);
+        segments.push_back(segment);
+        return true;
+    });
+    return segments;
+}
+
+std::vector<deflect::FramePtr> makeFrames(const deflect::Segments& segments)
+{
+    std::vector<deflect::FramePtr> frames;
+    for (size_t i = 0; i < NFRAMES; ++i)
+    {
+        frames.emplace_back(new deflect::Frame);
+        frames.back()->segments = segments;
+    }
+    return frames;
+}
+
+void printResult(const std::string& name, const unsigned int width,
+                 const unsigned int height, const float time)
+{
+    const auto megapixels = width * height / float(1024 * 1024) * NFRAMES;
+    std::cout << name << " " << width << "x" << height << ": "
+              << megapixels / time << " megapixel/s (" << NFRAMES / time
+              << " FPS)" << std::endl;
+}
+
+void benchmarkDecoding(const unsigned int width, const unsigned int height)
+{
+    const auto segments = makeJpegSegments(width, height);
+    BOOST_REQUIRE(!segments.empty());
+    Timer timer;
+
+    {
+        auto frames = makeFrames(segments);
+        deflect::SegmentDecoder decoder;
+        timer.start();
+        for (auto& frame : frames)
+            for (auto& segment : frame->segments)
+                decoder.decode(segment);
+        printResult("SegmentDecoder", width, height, timer.elapsed());
+    }
+
+    deflect::FrameDecoder decoder;
+    {
+        auto frames = makeFrames(segments);
+        std::vector<std::future<void>> futures;
+        timer.restart();
+        for (auto& frame : frames)
+            futures.push_back(decoder.startDecoding(frame));
+        for (auto& future : futures)
+            BOOST_CHECK_NO_THROW(future.get());
+        printResult("FrameDecoder", width, height, timer.elapsed());
+        BOOST_CHECK(frames.back()->segments.front().parameters.dataType ==
+                    deflect::DataType::rgba);
+    }
+#ifndef DEFLECT_USE_LEGACY_LIBJPEGTURBO
+    {
+        auto frames = makeFrames(segments);
+        std::vector<std::future<void>> futures;
+        timer.restart();
+        for (auto& frame : frames)
+            futures.push_back(decoder.startDecodingToYUV(frame));
+        for (auto& future : futures)
+            BOOST_CHECK_NO_THROW(future.get());
+        printResult("FrameDecoder (YUV)", width, height, timer.elapsed());
+    }
+#endif
+    std::cout << "(" << segments.size() << " segments, "
+              << decoder.getThreadCount() << " threads)" << std::endl;
+}
+}
+
+BOOST_AUTO_TEST_CASE(testDecode4KFrames)
+{
+    benchmarkDecoding(3840, 2160);
+}
+
+BOOST_AUTO_TEST_CASE(testDecode8KFrames)
+{
+    benchmarkDecoding(7680, 4320);
+}
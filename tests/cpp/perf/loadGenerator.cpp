@@ -0,0 +1,694 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#include <deflect/Frame.h>
+#include "NetworkEmulator.h"
+
+#include <deflect/ImageWrapper.h>
+#include <deflect/Server.h>
+#include <deflect/Stream.h>
+
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QTimer>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+// Starts many concurrent streams, each with several sources sharing the
+// stream id, to find the scaling limits of the Server. Without a host, the
+// streams are received by a Server running in this process, which consumes
+// and acknowledges the frames as soon as they are dispatched. With --link, the
+// sources connect through a NetworkEmulator to measure the send path under
+// constrained network conditions.
+
+#define MEGAPIXEL 1000000
+#define MEGABYTE 1000000
+
+enum class Content
+{
+    still,
+    text,
+    video,
+    noise
+};
+
+struct LoadOptions
+{
+    LoadOptions(int& argc, char** argv)
+        : desc("Allowed options")
+    {
+        initDesc();
+        parseCommandLineArguments(argc, argv);
+    }
+
+    void showSyntax() const { std::cout << desc; }
+    void initDesc()
+    {
+        using namespace boost::program_options;
+        // clang-format off
+        desc.add_options()
+            ("help", "produce help message")
+            ("host", value<std::string>()->default_value(""),
+                     "target Deflect server host (default: run a server in "
+                     "this process)")
+            ("port", value<unsigned short>()->default_value(1701),
+                     "target Deflect server port")
+            ("streams", value<unsigned int>()->default_value(1),
+                     "number of concurrent streams")
+            ("sources", value<unsigned int>()->default_value(1),
+                     "number of sources per stream, each sending a band of "
+                     "the image")
+            ("width", value<unsigned int>()->default_value(1920),
+                     "width of the streams in pixel")
+            ("height", value<unsigned int>()->default_value(1080),
+                     "height of the streams in pixel")
+            ("framerate", value<unsigned int>()->default_value(30),
+                     "frame rate of each stream (0: unlimited)")
+            ("duration", value<unsigned int>()->default_value(10),
+                     "duration of the test in seconds")
+            ("content", value<std::string>()->default_value("video"),
+                     "content of the images: still, text, video or noise")
+            ("raw", "send uncompressed segments")
+            ("quality", value<unsigned int>()->default_value(75),
+                     "quality of the jpeg compression")
+            ("subsampling", value<unsigned int>()->default_value(444),
+                     "chroma subsampling of the jpeg compression: 444, 422 "
+                     "or 420")
+            ("decoding", value<std::string>()->default_value("none"),
+                     "decoding on arrival by the local server: none, rgba "
+                     "or yuv")
+            ("metrics", value<std::string>()->default_value(""),
+                     "write the local server metrics to this JSON file")
+            ("link", value<std::string>()->default_value("none"),
+                     "emulated network link between the sources and the "
+                     "server: none, lan100, lan1g, wan or wifi")
+            ("output", value<std::string>()->default_value(""),
+                     "write the results to this JSON file, in the format of "
+                     "the microbenchmarks")
+        ;
+        // clang-format on
+    }
+
+    void parseCommandLineArguments(int& argc, char** argv)
+    {
+        if (argc <= 1)
+            return;
+
+        boost::program_options::variables_map vm;
+        try
+        {
+            using namespace boost::program_options;
+            store(parse_command_line(argc, argv, desc), vm);
+            notify(vm);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+            return;
+        }
+
+        getHelp = vm.count("help");
+        host = vm["host"].as<std::string>();
+        port = vm["port"].as<unsigned short>();
+        streams = vm["streams"].as<unsigned int>();
+        sources = std::max(vm["sources"].as<unsigned int>(), 1u);
+        width = vm["width"].as<unsigned int>();
+        height = vm["height"].as<unsigned int>();
+        framerate = vm["framerate"].as<unsigned int>();
+        duration = vm["duration"].as<unsigned int>();
+        compress = !vm.count("raw");
+        quality = vm["quality"].as<unsigned int>();
+        metrics = vm["metrics"].as<std::string>();
+        output = vm["output"].as<std::string>();
+
+        getHelp = getHelp ||
+                  !parseContent(vm["content"].as<std::string>()) ||
+                  !parseSubsampling(vm["subsampling"].as<unsigned int>()) ||
+                  !parseDecoding(vm["decoding"].as<std::string>()) ||
+                  !LinkConditions::fromProfile(vm["link"].as<std::string>(),
+                                               link);
+        emulateLink = vm["link"].as<std::string>() != "none";
+    }
+
+    bool parseContent(const std::string& name)
+    {
+        const std::map<std::string, Content> contents{
+            {"still", Content::still},
+            {"text", Content::text},
+            {"video", Content::video},
+            {"noise", Content::noise}};
+        const auto it = contents.find(name);
+        if (it == contents.end())
+            return false;
+        content = it->second;
+        return true;
+    }
+
+    bool parseSubsampling(const unsigned int value)
+    {
+        switch (value)
+        {
+        case 444:
+            subsampling = deflect::ChromaSubsampling::YUV444;
+            return true;
+        case 422:
+            subsampling = deflect::ChromaSubsampling::YUV422;
+            return true;
+        case 420:
+            subsampling = deflect::ChromaSubsampling::YUV420;
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    bool parseDecoding(const std::string& name)
+    {
+        if (name == "none")
+            decoding = deflect::Server::Decoding::none;
+        else if (name == "rgba")
+            decoding = deflect::Server::Decoding::rgba;
+        else if (name == "yuv")
+            decoding = deflect::Server::Decoding::yuv;
+        else
+            return false;
+        return true;
+    }
+
+    boost::program_options::options_description desc;
+
+    bool getHelp = true;
+    std::string host;
+    unsigned short port = 1701;
+    unsigned int streams = 1;
+    unsigned int sources = 1;
+    unsigned int width = 1920;
+    unsigned int height = 1080;
+    unsigned int framerate = 30;
+    unsigned int duration = 10;
+    Content content = Content::video;
+    bool compress = true;
+    unsigned int quality = 75;
+    deflect::ChromaSubsampling subsampling =
+        deflect::ChromaSubsampling::YUV444;
+    deflect::Server::Decoding decoding = deflect::Server::Decoding::none;
+    std::string metrics;
+    std::string output;
+    bool emulateLink = false;
+    LinkConditions link;
+};
+
+namespace deflect
+{
+namespace test
+{
+/**
+ * Generate the RGBA images of a band of a stream, cheaply enough not to limit
+ * the throughput of the sources.
+ */
+class ContentGenerator
+{
+public:
+    ContentGenerator(const Content content, const unsigned int width,
+                     const unsigned int height, const unsigned int y)
+        : _content(content)
+        , _width(width)
+        , _height(height)
+        , _y(y)
+    {
+        switch (content)
+        {
+        case Content::still:
+            _pixels.resize(_getSize());
+            _generateVideo(0);
+            break;
+        case Content::text:
+            _generateTextPage();
+            break;
+        case Content::video:
+            _pixels.resize(_getSize());
+            _noise = _makeNoise(_getSize() + NOISE_PERIOD, 32);
+            break;
+        case Content::noise:
+            _noise = _makeNoise(_getSize() * NOISE_FRAMES, 256);
+            break;
+        }
+    }
+
+    /** @return the pixels of the next image. */
+    const uint8_t* next()
+    {
+        const auto frame = _frame++;
+        switch (_content)
+        {
+        case Content::still:
+            return _pixels.data();
+        case Content::text:
+        {
+            // Scroll through a page which repeats its first screen at the end
+            const auto row = (frame * TEXT_SCROLL_SPEED) % _height;
+            return _pixels.data() + row * _width * 4;
+        }
+        case Content::video:
+            _generateVideo(frame);
+            return _pixels.data();
+        case Content::noise:
+            return _noise.data() + (frame % NOISE_FRAMES) * _getSize();
+        }
+        return nullptr;
+    }
+
+private:
+    static const size_t NOISE_PERIOD = 4093;
+    static const size_t NOISE_FRAMES = 4;
+    static const size_t TEXT_SCROLL_SPEED = 4;
+    static const unsigned int TEXT_LINE_HEIGHT = 16;
+    static const unsigned int TEXT_GLYPH_WIDTH = 8;
+
+    const Content _content;
+    const unsigned int _width;
+    const unsigned int _height;
+    const unsigned int _y;
+    size_t _frame = 0;
+    std::vector<uint8_t> _pixels;
+    std::vector<uint8_t> _noise;
+
+    size_t _getSize() const { return size_t(_width) * _height * 4; }
+    static std::vector<uint8_t> _makeNoise(const size_t size,
+                                           const unsigned int amplitude)
+    {
+        std::mt19937 generator(size);
+        std::vector<uint8_t> noise(size);
+        for (auto& value : noise)
+            value = generator() % amplitude;
+        return noise;
+    }
+
+    // Smooth moving gradients with a little noise, like natural video
+    void _generateVideo(const size_t frame)
+    {
+        const uint8_t* noise =
+            _noise.empty() ? nullptr : _noise.data() + frame % NOISE_PERIOD;
+        uint8_t* pixel = _pixels.data();
+        for (unsigned int y = 0; y < _height; ++y)
+        {
+            const auto green = uint8_t(((_y + y) * 256 / 1024 + frame * 2));
+            for (unsigned int x = 0; x < _width; ++x, pixel += 4)
+            {
+                pixel[0] = uint8_t(x * 256 / 1024 + frame);
+                pixel[1] = green;
+                pixel[2] = uint8_t(96 + (noise ? *noise++ : 0));
+                pixel[3] = 255;
+            }
+        }
+    }
+
+    // Lines of dark glyph-like blocks on a light background, twice the height
+    // of the band so that any scrolled window of it is contiguous.
+    void _generateTextPage()
+    {
+        _pixels.assign(_getSize() * 2, 255);
+        std::mt19937 generator(_y);
+        std::vector<bool> glyphs(_width / TEXT_GLYPH_WIDTH + 1);
+        for (unsigned int y = 0; y < _height; ++y)
+        {
+            const auto lineRow = (_y + y) % TEXT_LINE_HEIGHT;
+            if (lineRow == 0)
+                for (size_t i = 0; i < glyphs.size(); ++i)
+                    glyphs[i] = generator() % 5 != 0; // spaces between words
+            if (lineRow < 3 || lineRow > 12)
+                continue; // spacing between the lines
+
+            uint8_t* row = _pixels.data() + size_t(y) * _width * 4;
+            for (unsigned int x = 0; x < _width; ++x)
+            {
+                const auto column = x % TEXT_GLYPH_WIDTH;
+                if (!glyphs[x / TEXT_GLYPH_WIDTH] || column == 0 ||
+                    (column + lineRow + x / TEXT_GLYPH_WIDTH) % 3 == 0)
+                {
+                    continue;
+                }
+                std::fill(row + x * 4, row + x * 4 + 3, 32);
+            }
+        }
+        std::copy(_pixels.begin(), _pixels.begin() + _getSize(),
+                  _pixels.begin() + _getSize());
+    }
+};
+
+/** Release all the sources at once, once they are all connected. */
+class StartBarrier
+{
+public:
+    explicit StartBarrier(const size_t count)
+        : _count(count)
+    {
+    }
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (--_count == 0)
+            _condition.notify_all();
+        else
+            _condition.wait(lock, [this] { return _count == 0; });
+    }
+
+private:
+    size_t _count;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+};
+
+/**
+ * The sources of all the streams, each one sending from its own thread.
+ */
+class LoadGenerator
+{
+public:
+    LoadGenerator(const LoadOptions& options, const std::string& host,
+                  const unsigned short port)
+        : _options(options)
+        , _host(host)
+        , _port(port)
+        , _barrier(options.streams * options.sources)
+    {
+    }
+
+    ~LoadGenerator() { stop(); }
+
+    /** Connect all the sources, which start sending once all connected. */
+    void start()
+    {
+        for (unsigned int stream = 0; stream < _options.streams; ++stream)
+            for (unsigned int source = 0; source < _options.sources; ++source)
+                _threads.emplace_back([this, stream, source] {
+                    _runSource(stream, source);
+                });
+    }
+
+    void stop()
+    {
+        _stopped = true;
+        for (auto& thread : _threads)
+            thread.join();
+        _threads.clear();
+    }
+
+    /** @return the number of frames sent by all the sources. */
+    size_t getSentFrameCount() const { return _sentFrames; }
+    /** @return the number of pixels sent by all the sources. */
+    size_t getSentPixelCount() const { return _sentPixels; }
+    /** @return the number of sources which failed to connect or send. */
+    size_t getFailureCount() const { return _failures; }
+    /** @return the time since the sources started sending, in seconds. */
+    float getElapsedTime() const
+    {
+        const int64_t startUs = _startUs;
+        if (startUs < 0)
+            return 0.f;
+        return (FrameTimestamps::getTimeUs() - startUs) / 1e6f;
+    }
+
+private:
+    const LoadOptions& _options;
+    const std::string _host;
+    const unsigned short _port;
+    StartBarrier _barrier;
+    std::vector<std::thread> _threads;
+    std::atomic<bool> _stopped{false};
+    std::atomic<size_t> _sentFrames{0};
+    std::atomic<size_t> _sentPixels{0};
+    std::atomic<size_t> _failures{0};
+    std::atomic<int64_t> _startUs{-1};
+
+    void _runSource(const unsigned int streamIndex,
+                    const unsigned int sourceIndex)
+    {
+        // Horizontal bands, the last one taking the remaining rows
+        const auto bandHeight = _options.height / _options.sources;
+        const auto y = sourceIndex * bandHeight;
+        const auto height = sourceIndex + 1 == _options.sources
+                                ? _options.height - y
+                                : bandHeight;
+
+        ContentGenerator content(_options.content, _options.width, height, y);
+        const auto id = "LoadGenerator" + std::to_string(streamIndex);
+        std::unique_ptr<Stream> stream;
+        try
+        {
+            stream.reset(new Stream(id, _host, _port));
+        }
+        catch (const std::runtime_error& e)
+        {
+            std::cerr << "Source failed to connect: " << e.what() << std::endl;
+        }
+        _barrier.wait();
+        int64_t notStarted = -1;
+        _startUs.compare_exchange_strong(notStarted,
+                                         FrameTimestamps::getTimeUs());
+        if (!stream || !stream->isConnected())
+        {
+            ++_failures;
+            return;
+        }
+
+        using clock = std::chrono::steady_clock;
+        const auto period =
+            _options.framerate ? std::chrono::microseconds(1000000 /
+                                                           _options.framerate)
+                               : std::chrono::microseconds(0);
+        auto nextFrame = clock::now();
+        while (!_stopped)
+        {
+            ImageWrapper image(content.next(), _options.width, height, RGBA, 0,
+                               y);
+            image.compressionPolicy =
+                _options.compress ? COMPRESSION_ON : COMPRESSION_OFF;
+            image.compressionQuality = _options.quality;
+            image.subsampling = _options.subsampling;
+            if (!stream->sendAndFinish(image).get())
+            {
+                ++_failures;
+                return;
+            }
+            ++_sentFrames;
+            _sentPixels += size_t(_options.width) * height;
+
+            nextFrame += period;
+            std::this_thread::sleep_until(nextFrame);
+        }
+    }
+};
+}
+}
+
+// Median over the streams of their median end-to-end latency
+double getMedianLatency(const deflect::ServerMetrics& metrics)
+{
+    std::vector<double> latencies;
+    for (const auto& stream : metrics.streams)
+        if (stream.captureToAck.count > 0)
+            latencies.push_back(stream.captureToAck.getPercentile(50.0));
+    if (latencies.empty())
+        return 0.0;
+    std::sort(latencies.begin(), latencies.end());
+    return latencies[latencies.size() / 2];
+}
+
+bool writeResults(const std::string& filename, const double sentFps,
+                  const double acknowledgedFps,
+                  const deflect::ServerMetrics& metrics,
+                  const NetworkEmulator* emulator)
+{
+    QJsonArray benchmarks;
+
+    QJsonObject sent;
+    sent["name"] = "loadgenerator/sent";
+    sent["framesPerSecond"] = sentFps;
+    if (emulator)
+    {
+        const auto link = emulator->getUpstreamStatistics();
+        sent["maxQueuedBytes"] = double(link.maxQueuedBytes);
+    }
+    benchmarks.append(sent);
+
+    if (!metrics.streams.empty())
+    {
+        QJsonObject acknowledged;
+        acknowledged["name"] = "loadgenerator/acknowledged";
+        acknowledged["framesPerSecond"] = acknowledgedFps;
+        acknowledged["latencyUs"] = getMedianLatency(metrics);
+        benchmarks.append(acknowledged);
+    }
+
+    QJsonObject document;
+    document["benchmarks"] = benchmarks;
+
+    QSaveFile file(QString::fromStdString(filename));
+    return file.open(QIODevice::WriteOnly) &&
+           file.write(QJsonDocument{document}.toJson()) >= 0 && file.commit();
+}
+
+int main(int argc, char** argv)
+{
+    const LoadOptions options(argc, argv);
+    if (options.getHelp)
+    {
+        options.showSyntax();
+        return 0;
+    }
+
+    QCoreApplication app(argc, argv);
+
+    // Without host, receive the streams in this process
+    std::unique_ptr<deflect::Server> server;
+    std::string host = options.host;
+    unsigned short port = options.port;
+    std::map<QString, size_t> receivedFrames;
+    if (host.empty())
+    {
+        server.reset(new deflect::Server(0));
+        server->setDecoding(options.decoding);
+        if (!options.metrics.empty())
+            server->startMetricsDump(QString::fromStdString(options.metrics));
+
+        auto serverPtr = server.get();
+        QObject::connect(serverPtr, &deflect::Server::pixelStreamOpened,
+                         serverPtr, &deflect::Server::requestFrame);
+        QObject::connect(serverPtr, &deflect::Server::receivedFrame,
+                         [&receivedFrames, serverPtr](deflect::FramePtr frame) {
+                             ++receivedFrames[frame->uri];
+                             serverPtr->acknowledgeFrame(frame);
+                             serverPtr->requestFrame(frame->uri);
+                         });
+        host = "localhost";
+        port = server->serverPort();
+    }
+
+    // Shape the traffic of the sources through a local proxy
+    std::unique_ptr<NetworkEmulator> emulator;
+    if (options.emulateLink)
+    {
+        emulator.reset(new NetworkEmulator(QString::fromStdString(host), port,
+                                           options.link, options.link));
+        host = "localhost";
+        port = emulator->getPort();
+    }
+
+    deflect::test::LoadGenerator generator(options, host, port);
+    size_t acknowledgedFrames = 0;
+    float time = 0.f;
+    deflect::ServerMetrics serverMetrics;
+
+    // The sources connect while the event loop serves them
+    QTimer::singleShot(0, [&] { generator.start(); });
+    QTimer::singleShot(options.duration * 1000, [&] {
+        time = generator.getElapsedTime();
+        for (const auto& kv : receivedFrames)
+            acknowledgedFrames += kv.second;
+        if (server)
+            serverMetrics = server->getMetrics();
+        app.quit();
+    });
+    app.exec();
+    generator.stop();
+
+    if (time <= 0.f)
+    {
+        std::cerr << "The sources did not start within the duration"
+                  << std::endl;
+        return 1;
+    }
+
+    const auto sentFrames = generator.getSentFrameCount();
+    std::cout << "Streams x sources:          " << options.streams << " x "
+              << options.sources << std::endl;
+    std::cout << "Stream size:                " << options.width << " x "
+              << options.height << std::endl;
+    std::cout << "Failed sources:             " << generator.getFailureCount()
+              << std::endl;
+    std::cout << "Sent frames/s (sources):    " << sentFrames / time
+              << std::endl;
+    std::cout << "Sent frames/s (streams):    "
+              << sentFrames / time / options.sources << std::endl;
+    std::cout << "Sent [megapixel/s]:         "
+              << generator.getSentPixelCount() / time / MEGAPIXEL << std::endl;
+    if (server)
+    {
+        std::cout << "Acknowledged frames/s:      " << acknowledgedFrames / time
+                  << std::endl;
+        for (const auto& kv : receivedFrames)
+            std::cout << "  " << kv.first.toStdString() << ": "
+                      << kv.second / time << std::endl;
+    }
+
+    if (emulator)
+    {
+        const auto link = emulator->getUpstreamStatistics();
+        std::cout << "Link forwarded [MB/s]:      "
+                  << link.forwardedBytes / time / MEGABYTE << std::endl;
+        std::cout << "Link max queued [MB]:       "
+                  << double(link.maxQueuedBytes) / MEGABYTE << std::endl;
+    }
+
+    if (!options.output.empty() &&
+        !writeResults(options.output, sentFrames / time / options.sources,
+                      acknowledgedFrames / time, serverMetrics,
+                      emulator.get()))
+    {
+        std::cerr << "Could not write " << options.output << std::endl;
+        return 1;
+    }
+    return 0;
+}
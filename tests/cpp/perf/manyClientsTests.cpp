@@ -0,0 +1,191 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#define BOOST_TEST_MODULE ManyClients
+#include <boost/test/unit_test.hpp>
+namespace ut = boost::unit_test;
+
+#include "MinimalGlobalQtApp.h"
+#include "Timer.h"
+
+#include <deflect/Frame.h>
+#include <deflect/Server.h>
+#include <deflect/Stream.h>
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <QDir>
+#include <QFile>
+#include <QThread>
+
+// Tests the throughput of a server which receives many concurrent streams of
+// small raw images, like a wall hosting many windows. The server threads are
+// counted to check that they do not grow with the number of connections.
+
+#define NSTREAMS (64u)
+#define NFRAMES (100u)
+#define WIDTH (256u)
+#define HEIGHT (256u)
+#define NBYTES (WIDTH * HEIGHT * 4u)
+
+BOOST_GLOBAL_FIXTURE(MinimalGlobalQtApp);
+
+namespace
+{
+using Futures = std::vector<deflect::Stream::Future>;
+
+size_t _countServerThreads()
+{
+#ifdef __linux__
+    size_t count = 0;
+    const QDir tasks("/proc/self/task");
+    for (const auto& task : tasks.entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+        QFile comm(tasks.filePath(task + "/comm"));
+        if (comm.open(QIODevice::ReadOnly) &&
+            comm.readAll().startsWith("DeflectIO"))
+        {
+            ++count;
+        }
+    }
+    return count;
+#else
+    return 0;
+#endif
+}
+}
+
+class StreamsThread : public QThread
+{
+public:
+    explicit StreamsThread(const quint16 port)
+        : _port(port)
+    {
+    }
+
+    // Results of the run, only to be checked once the thread has finished
+    // because the Boost.Test assertions are not thread-safe.
+    size_t connectedStreams = 0;
+    size_t serverThreads = 0;
+    size_t sentFrames = 0;
+
+private:
+    const quint16 _port;
+
+    void run() final
+    {
+        std::vector<std::unique_ptr<deflect::Stream>> streams;
+        for (size_t i = 0; i < NSTREAMS; ++i)
+        {
+            const auto id = "stream" + std::to_string(i);
+            streams.emplace_back(
+                new deflect::Stream(id, "localhost", _port,
+                                    deflect::Stream::PendingFrames::queue));
+        }
+        for (auto& stream : streams)
+            if (stream->getConnectionFuture().get())
+                ++connectedStreams;
+
+        // All the connections are accepted, count the threads serving them
+        serverThreads = _countServerThreads();
+
+        std::vector<uint8_t> pixels(NBYTES, 0);
+        deflect::ImageWrapper image(pixels.data(), WIDTH, HEIGHT,
+                                    deflect::RGBA);
+        image.compressionPolicy = deflect::COMPRESSION_OFF;
+
+        Futures futures;
+        futures.reserve(NSTREAMS);
+        Timer timer;
+        timer.start();
+        for (size_t i = 0; i < NFRAMES; ++i)
+        {
+            futures.clear();
+            for (auto& stream : streams)
+                futures.push_back(stream->sendAndFinish(image));
+            for (auto& future : futures)
+                if (future.get())
+                    ++sentFrames;
+        }
+        const float time = timer.elapsed();
+
+        const auto frames = NSTREAMS * NFRAMES;
+        std::cout << "raw " << frames / time << " frames/s, "
+                  << frames * NBYTES / float(1024 * 1024) / time << " MB/s"
+                  << std::endl;
+
+        streams.clear();
+        QCoreApplication::instance()->exit();
+    }
+};
+
+BOOST_AUTO_TEST_CASE(testManyConcurrentStreams)
+{
+    deflect::Server server(0 /* OS-chosen port */);
+
+    // consume frames as fast as possible
+    size_t receivedFrames = 0;
+    server.connect(&server, &deflect::Server::pixelStreamOpened,
+                   [&](const QString uri) { server.requestFrame(uri); });
+    server.connect(&server, &deflect::Server::receivedFrame,
+                   [&](deflect::FramePtr frame) {
+                       ++receivedFrames;
+                       server.requestFrame(frame->uri);
+                   });
+
+    StreamsThread thread(server.serverPort());
+    thread.start();
+    QCoreApplication::instance()->exec();
+    BOOST_REQUIRE(thread.wait());
+
+    BOOST_CHECK_EQUAL(thread.connectedStreams, NSTREAMS);
+    BOOST_CHECK_EQUAL(thread.sentFrames, NSTREAMS * NFRAMES);
+
+    // Thread-per-connection would need one thread for each of the streams
+    std::cout << NSTREAMS << " streams served by " << thread.serverThreads
+              << " server threads instead of " << NSTREAMS
+              << " with thread-per-connection" << std::endl;
+    const auto maxThreads = size_t(std::max(QThread::idealThreadCount(), 1));
+    BOOST_CHECK_LE(thread.serverThreads, maxThreads);
+
+    std::cout << "server dispatched " << receivedFrames << " frames"
+              << std::endl;
+}
@@ -0,0 +1,541 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#include "Timer.h"
+
+#include <deflect/Event.h>
+#include <deflect/ImageSegmenter.h>
+#include <deflect/ImageWrapper.h>
+#include <deflect/MTQueue.h>
+#include <deflect/MessageHeader.h>
+#include <deflect/ReceiveBuffer.h>
+#include <deflect/Segment.h>
+
+#ifdef DEFLECT_USE_LIBJPEGTURBO
+#include <deflect/ImageJpegCompressor.h>
+#include <deflect/ImageJpegDecompressor.h>
+#endif
+
+#include <QBuffer>
+#include <QDataStream>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+// Measures the hot paths of the library in isolation and reports the results
+// as JSON, so that they can be compared across commits. Each benchmark runs
+// its operation repeatedly for a minimum time per sample; the median of the
+// samples is reported along with the samples themselves. No benchmark uses
+// the network, so there is no --link option: use loadGenerator --link or
+// benchmarkStreamer --link to measure the send path over an emulated link.
+
+#define NANOSEC 1e9
+#define MEGABYTE 1000000
+
+struct BenchmarkOptions
+{
+    BenchmarkOptions(int& argc, char** argv)
+        : desc("Allowed options")
+    {
+        initDesc();
+        parseCommandLineArguments(argc, argv);
+    }
+
+    void showSyntax() const { std::cout << desc; }
+    void initDesc()
+    {
+        using namespace boost::program_options;
+        // clang-format off
+        desc.add_options()
+            ("help", "produce help message")
+            ("list", "list the benchmarks without running them")
+            ("filter", value<std::string>()->default_value(""),
+                     "only run the benchmarks whose name contains this string")
+            ("output", value<std::string>()->default_value(""),
+                     "write the results to this JSON file (default: stdout)")
+            ("min-time", value<float>()->default_value(0.1f),
+                     "minimum duration of each sample in seconds")
+            ("samples", value<unsigned int>()->default_value(5),
+                     "number of samples per benchmark")
+        ;
+        // clang-format on
+    }
+
+    void parseCommandLineArguments(int& argc, char** argv)
+    {
+        boost::program_options::variables_map vm;
+        try
+        {
+            using namespace boost::program_options;
+            store(parse_command_line(argc, argv, desc), vm);
+            notify(vm);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+            getHelp = true;
+            return;
+        }
+
+        getHelp = vm.count("help");
+        list = vm.count("list");
+        filter = vm["filter"].as<std::string>();
+        output = vm["output"].as<std::string>();
+        minTime = vm["min-time"].as<float>();
+        samples = std::max(vm["samples"].as<unsigned int>(), 1u);
+    }
+
+    boost::program_options::options_description desc;
+
+    bool getHelp = false;
+    bool list = false;
+    std::string filter;
+    std::string output;
+    float minTime = 0.1f;
+    unsigned int samples = 5;
+};
+
+namespace
+{
+const unsigned int IMAGE_WIDTH = 1920;
+const unsigned int IMAGE_HEIGHT = 1080;
+const unsigned int SEGMENT_SIZE = 512;
+const unsigned int SEGMENTS_PER_FRAME = 16;
+
+// Written by the benchmarks so that their results can not be optimized away
+volatile size_t sink = 0;
+
+std::vector<uint8_t> makePixels(const unsigned int width,
+                                const unsigned int height,
+                                const unsigned int bpp)
+{
+    // A gradient with some noise, representative of rendered content
+    std::mt19937 rng(0);
+    std::vector<uint8_t> pixels(width * height * bpp);
+    for (size_t i = 0; i < width * height; ++i)
+    {
+        const auto x = i % width;
+        const auto y = i / width;
+        pixels[i * bpp] = uint8_t(x * 255 / width);
+        pixels[i * bpp + 1] = uint8_t(y * 255 / height);
+        pixels[i * bpp + 2] = uint8_t(rng() % 64);
+        if (bpp == 4)
+            pixels[i * bpp + 3] = 255;
+    }
+    return pixels;
+}
+
+#ifdef DEFLECT_USE_LIBJPEGTURBO
+const char* toString(const deflect::PixelFormat format)
+{
+    switch (format)
+    {
+    case deflect::RGB:
+        return "rgb";
+    case deflect::RGBA:
+        return "rgba";
+    case deflect::ARGB:
+        return "argb";
+    case deflect::BGR:
+        return "bgr";
+    case deflect::BGRA:
+        return "bgra";
+    case deflect::ABGR:
+        return "abgr";
+    }
+    return "unknown";
+}
+
+const char* toString(const deflect::ChromaSubsampling subsampling)
+{
+    switch (subsampling)
+    {
+    case deflect::ChromaSubsampling::YUV444:
+        return "444";
+    case deflect::ChromaSubsampling::YUV422:
+        return "422";
+    case deflect::ChromaSubsampling::YUV420:
+        return "420";
+    }
+    return "unknown";
+}
+
+const std::vector<deflect::ChromaSubsampling> SUBSAMPLINGS{
+    deflect::ChromaSubsampling::YUV444, deflect::ChromaSubsampling::YUV422,
+    deflect::ChromaSubsampling::YUV420};
+#endif
+
+double median(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    const auto middle = values.size() / 2;
+    if (values.size() % 2)
+        return values[middle];
+    return (values[middle - 1] + values[middle]) / 2.0;
+}
+}
+
+class BenchmarkRunner
+{
+public:
+    explicit BenchmarkRunner(const BenchmarkOptions& options)
+        : _options(options)
+    {
+    }
+
+    /**
+     * Run a benchmark if it matches the filter.
+     *
+     * @param name of the benchmark, as "group/operation/parameters"
+     * @param bytesPerOp processed by each call of the operation, 0 if not
+     *        relevant
+     * @param operation to measure
+     */
+    void run(const std::string& name, const size_t bytesPerOp,
+             const std::function<void()>& operation)
+    {
+        if (name.find(_options.filter) == std::string::npos)
+            return;
+
+        if (_options.list)
+        {
+            std::cout << name << std::endl;
+            return;
+        }
+
+        // Warm up caches and lazily allocated resources
+        operation();
+
+        QJsonArray samples;
+        std::vector<double> nsPerOp;
+        size_t iterations = 0;
+        for (unsigned int i = 0; i < _options.samples; ++i)
+        {
+            const auto sample = _measure(operation);
+            iterations += sample.second;
+            nsPerOp.push_back(sample.first);
+            samples.append(sample.first);
+        }
+
+        const auto ns = median(nsPerOp);
+        QJsonObject result;
+        result["name"] = QString::fromStdString(name);
+        result["nsPerOp"] = ns;
+        result["iterations"] = double(iterations);
+        result["bytesPerOp"] = double(bytesPerOp);
+        if (bytesPerOp > 0)
+            result["megabytesPerSecond"] = bytesPerOp / ns * NANOSEC / MEGABYTE;
+        result["samples"] = samples;
+        _results.append(result);
+
+        std::cerr << name << ": " << ns << " ns/op" << std::endl;
+    }
+
+    QJsonDocument getResults() const
+    {
+        QJsonObject document;
+        document["minTime"] = _options.minTime;
+        document["benchmarks"] = _results;
+        return QJsonDocument{document};
+    }
+
+private:
+    const BenchmarkOptions& _options;
+    QJsonArray _results;
+
+    // @return the mean duration of the operation in ns and the number of
+    //         iterations, doubling the batch size until minTime is reached
+    std::pair<double, size_t> _measure(const std::function<void()>& operation)
+    {
+        Timer timer;
+        size_t iterations = 0;
+        size_t batch = 1;
+        timer.start();
+        float elapsed = 0.f;
+        while (elapsed < _options.minTime)
+        {
+            for (size_t i = 0; i < batch; ++i)
+                operation();
+            iterations += batch;
+            batch *= 2;
+            elapsed = timer.elapsed();
+        }
+        return std::make_pair(elapsed * NANOSEC / iterations, iterations);
+    }
+};
+
+void benchmarkSegmenter(BenchmarkRunner& runner)
+{
+    const auto pixels = makePixels(IMAGE_WIDTH, IMAGE_HEIGHT, 4);
+    const auto name =
+        std::to_string(IMAGE_WIDTH) + "x" + std::to_string(IMAGE_HEIGHT);
+
+    deflect::ImageSegmenter segmenter;
+    segmenter.setNominalSegmentDimensions(SEGMENT_SIZE, SEGMENT_SIZE);
+
+    // Segmentation only: the handler discards the segments
+    deflect::ImageWrapper rawImage(pixels.data(), IMAGE_WIDTH, IMAGE_HEIGHT,
+                                   deflect::RGBA);
+    rawImage.compressionPolicy = deflect::COMPRESSION_OFF;
+    runner.run("segmenter/raw/" + name, pixels.size(), [&] {
+        segmenter.generate(rawImage, [](const deflect::Segment& segment) {
+            sink = sink + segment.imageData.size();
+            return true;
+        });
+    });
+
+#ifdef DEFLECT_USE_LIBJPEGTURBO
+    deflect::ImageWrapper jpegImage(pixels.data(), IMAGE_WIDTH, IMAGE_HEIGHT,
+                                    deflect::RGBA);
+    jpegImage.compressionPolicy = deflect::COMPRESSION_ON;
+    runner.run("segmenter/jpeg/" + name, pixels.size(), [&] {
+        segmenter.generate(jpegImage, [](const deflect::Segment& segment) {
+            sink = sink + segment.imageData.size();
+            return true;
+        });
+    });
+
+    // Flat content, sent as fill segments
+    const std::vector<uint8_t> flatPixels(pixels.size(), 64);
+    deflect::ImageWrapper flatImage(flatPixels.data(), IMAGE_WIDTH,
+                                    IMAGE_HEIGHT, deflect::RGBA);
+    flatImage.compressionPolicy = deflect::COMPRESSION_ON;
+    segmenter.setUniformTileDetection(true);
+    runner.run("segmenter/fill/" + name, flatPixels.size(), [&] {
+        segmenter.generate(flatImage, [](const deflect::Segment& segment) {
+            sink = sink + segment.imageData.size();
+            return true;
+        });
+    });
+#endif
+}
+
+#ifdef DEFLECT_USE_LIBJPEGTURBO
+void benchmarkJpegCompressor(BenchmarkRunner& runner)
+{
+    const std::vector<deflect::PixelFormat> formats{deflect::RGB, deflect::RGBA,
+                                                    deflect::BGRA,
+                                                    deflect::ARGB};
+    const QRect region(0, 0, SEGMENT_SIZE, SEGMENT_SIZE);
+
+    deflect::ImageJpegCompressor compressor;
+    for (const auto format : formats)
+    {
+        const auto bpp = (format == deflect::RGB) ? 3u : 4u;
+        const auto pixels = makePixels(SEGMENT_SIZE, SEGMENT_SIZE, bpp);
+        for (const auto subsampling : SUBSAMPLINGS)
+        {
+            deflect::ImageWrapper image(pixels.data(), SEGMENT_SIZE,
+                                        SEGMENT_SIZE, format);
+            image.subsampling = subsampling;
+            const auto name = std::string("jpeg/compress/") +
+                              toString(format) + "/" + toString(subsampling);
+            runner.run(name, pixels.size(), [&] {
+                sink = sink + compressor.computeJpeg(image, region).size();
+            });
+        }
+    }
+}
+
+void benchmarkJpegDecompressor(BenchmarkRunner& runner)
+{
+    const auto pixels = makePixels(SEGMENT_SIZE, SEGMENT_SIZE, 4);
+    const QRect region(0, 0, SEGMENT_SIZE, SEGMENT_SIZE);
+    const auto rgbaSize = pixels.size();
+
+    deflect::ImageJpegCompressor compressor;
+    deflect::ImageJpegDecompressor decompressor;
+    for (const auto subsampling : SUBSAMPLINGS)
+    {
+        deflect::ImageWrapper image(pixels.data(), SEGMENT_SIZE, SEGMENT_SIZE,
+                                    deflect::RGBA);
+        image.subsampling = subsampling;
+        const auto jpeg = compressor.computeJpeg(image, region);
+
+        runner.run(std::string("jpeg/decompress/rgba/") + toString(subsampling),
+                   rgbaSize, [&] {
+                       sink = sink + decompressor.decompress(jpeg).size();
+                   });
+#ifndef DEFLECT_USE_LEGACY_LIBJPEGTURBO
+        runner.run(std::string("jpeg/decompress/yuv/") + toString(subsampling),
+                   rgbaSize, [&] {
+                       const auto yuv = decompressor.decompressToYUV(jpeg);
+                       sink = sink + yuv.first.size();
+                   });
+#endif
+    }
+}
+#endif
+
+void benchmarkSerialization(BenchmarkRunner& runner)
+{
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadWrite);
+    QDataStream stream(&buffer);
+
+    const deflect::MessageHeader header(deflect::MESSAGE_TYPE_PIXELSTREAM,
+                                        SEGMENT_SIZE * SEGMENT_SIZE,
+                                        "benchmark_stream");
+    runner.run("protocol/messageheader/serialize",
+               deflect::MessageHeader::serializedSize, [&] {
+                   buffer.seek(0);
+                   stream << header;
+               });
+    runner.run("protocol/messageheader/deserialize",
+               deflect::MessageHeader::serializedSize, [&] {
+                   buffer.seek(0);
+                   deflect::MessageHeader result;
+                   stream >> result;
+                   sink = sink + result.size;
+               });
+
+    deflect::Event event;
+    event.type = deflect::Event::EVT_MOVE;
+    event.mouseX = 0.25;
+    event.mouseY = 0.75;
+    event.dx = 0.01;
+    event.dy = -0.01;
+    runner.run("protocol/event/serialize", deflect::Event::serializedSize,
+               [&] {
+                   buffer.seek(0);
+                   stream << event;
+               });
+    runner.run("protocol/event/deserialize", deflect::Event::serializedSize,
+               [&] {
+                   buffer.seek(0);
+                   deflect::Event result;
+                   stream >> result;
+                   sink = sink + result.type;
+               });
+}
+
+void benchmarkReceiveBuffer(BenchmarkRunner& runner)
+{
+    std::vector<deflect::Segment> segments(SEGMENTS_PER_FRAME);
+    for (size_t i = 0; i < segments.size(); ++i)
+    {
+        auto& segment = segments[i];
+        segment.parameters.x = (i % 4) * SEGMENT_SIZE;
+        segment.parameters.y = (i / 4) * SEGMENT_SIZE;
+        segment.parameters.width = SEGMENT_SIZE;
+        segment.parameters.height = SEGMENT_SIZE;
+        segment.imageData = QByteArray(SEGMENT_SIZE * 64, 'x');
+    }
+
+    deflect::ReceiveBuffer buffer;
+    buffer.addSource(0);
+    runner.run("receivebuffer/insert_pop/" +
+                   std::to_string(SEGMENTS_PER_FRAME),
+               0, [&] {
+                   for (const auto& segment : segments)
+                       buffer.insert(segment, 0);
+                   buffer.finishFrameForSource(0);
+                   sink = sink + buffer.popFrame().size();
+               });
+}
+
+void benchmarkMTQueue(BenchmarkRunner& runner)
+{
+    deflect::MTQueue<deflect::Segment> queue;
+    const deflect::Segment segment;
+    runner.run("mtqueue/enqueue_dequeue", 0, [&] {
+        queue.enqueue(segment);
+        sink = sink + queue.dequeue().parameters.width;
+    });
+}
+
+void benchmarkSwapYAxis(BenchmarkRunner& runner)
+{
+    auto pixels = makePixels(IMAGE_WIDTH, IMAGE_HEIGHT, 4);
+    runner.run("imagewrapper/swapyaxis/" + std::to_string(IMAGE_WIDTH) + "x" +
+                   std::to_string(IMAGE_HEIGHT),
+               pixels.size(), [&] {
+                   deflect::ImageWrapper::swapYAxis(pixels.data(), IMAGE_WIDTH,
+                                                    IMAGE_HEIGHT, 4);
+               });
+}
+
+int main(int argc, char** argv)
+{
+    const BenchmarkOptions options(argc, argv);
+    if (options.getHelp)
+    {
+        options.showSyntax();
+        return 0;
+    }
+
+    BenchmarkRunner runner(options);
+    benchmarkSegmenter(runner);
+#ifdef DEFLECT_USE_LIBJPEGTURBO
+    benchmarkJpegCompressor(runner);
+    benchmarkJpegDecompressor(runner);
+#endif
+    benchmarkSerialization(runner);
+    benchmarkReceiveBuffer(runner);
+    benchmarkMTQueue(runner);
+    benchmarkSwapYAxis(runner);
+
+    if (options.list)
+        return 0;
+
+    const auto json = runner.getResults().toJson();
+    if (options.output.empty())
+    {
+        std::cout << json.constData();
+        return 0;
+    }
+
+    QFile file(QString::fromStdString(options.output));
+    if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size())
+    {
+        std::cerr << "Could not write " << options.output << std::endl;
+        return 1;
+    }
+    return 0;
+}
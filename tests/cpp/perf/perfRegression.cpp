@@ -0,0 +1,463 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QSaveFile>
+#include <QStringList>
+#include <QTemporaryDir>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+// Runs perf executables several times and compares their results with a
+// baseline. The executables must accept "--output <file>" and write JSON in
+// the format of the microbenchmarks: {"benchmarks": [{"name": ..., <metric>:
+// <value>, ...}, ...]}. The loadGenerator only uses an in-process server on
+// the loopback interface when run without --host. To compare runs over an
+// emulated network link, pass --link to the loadGenerator command.
+//
+// Example:
+//   perfRegression --command "./microbenchmarks --min-time 0.05"
+//                  --command "./loadGenerator --streams 4 --duration 5"
+//                  --baseline baseline.json [--update]
+
+enum class Better
+{
+    lower,
+    higher
+};
+
+struct Metric
+{
+    std::string name;
+    Better better;
+};
+
+namespace
+{
+// The metrics compared with the baseline; megabytesPerSecond is ignored as it
+// is derived from nsPerOp.
+const std::vector<Metric> METRICS{{"nsPerOp", Better::lower},
+                                  {"latencyUs", Better::lower},
+                                  {"framesPerSecond", Better::higher}};
+
+// Changes within this many MADs of either side are considered noise
+const double NOISE_MADS = 3.0;
+
+const int EXIT_REGRESSION = 1;
+const int EXIT_ERROR = 2;
+}
+
+struct RegressionOptions
+{
+    RegressionOptions(int& argc, char** argv)
+        : desc("Allowed options")
+    {
+        initDesc();
+        parseCommandLineArguments(argc, argv);
+    }
+
+    void showSyntax() const { std::cout << desc; }
+    void initDesc()
+    {
+        using namespace boost::program_options;
+        // clang-format off
+        desc.add_options()
+            ("help", "produce help message")
+            ("command", value<std::vector<std::string>>(),
+                     "perf executable and its arguments, can be repeated")
+            ("runs", value<unsigned int>()->default_value(5),
+                     "number of runs of each command")
+            ("baseline", value<std::string>()->default_value(""),
+                     "baseline JSON file to compare the results with")
+            ("update", "write the results to the baseline file instead of "
+                       "comparing them")
+            ("threshold", value<double>()->default_value(10.0),
+                     "relative change in percent above which a slower result "
+                     "is a regression")
+        ;
+        // clang-format on
+    }
+
+    void parseCommandLineArguments(int& argc, char** argv)
+    {
+        if (argc <= 1)
+            return;
+
+        boost::program_options::variables_map vm;
+        try
+        {
+            using namespace boost::program_options;
+            store(parse_command_line(argc, argv, desc), vm);
+            notify(vm);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+            return;
+        }
+
+        getHelp = vm.count("help") || !vm.count("command");
+        if (vm.count("command"))
+            commands = vm["command"].as<std::vector<std::string>>();
+        runs = std::max(vm["runs"].as<unsigned int>(), 1u);
+        baseline = vm["baseline"].as<std::string>();
+        update = vm.count("update");
+        threshold = vm["threshold"].as<double>();
+
+        getHelp = getHelp || (update && baseline.empty());
+    }
+
+    boost::program_options::options_description desc;
+
+    bool getHelp = true;
+    std::vector<std::string> commands;
+    unsigned int runs = 5;
+    std::string baseline;
+    bool update = false;
+    double threshold = 10.0;
+};
+
+/** Robust statistics of the values of a metric over several runs. */
+struct Statistics
+{
+    double median = 0.0;
+    double mad = 0.0; //!< Median absolute deviation
+    size_t count = 0;
+};
+
+// (benchmark name, metric name)
+using Key = std::pair<std::string, std::string>;
+using Samples = std::map<Key, std::vector<double>>;
+using Results = std::map<Key, Statistics>;
+
+double computeMedian(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    const auto middle = values.size() / 2;
+    if (values.size() % 2)
+        return values[middle];
+    return (values[middle - 1] + values[middle]) / 2.0;
+}
+
+Statistics computeStatistics(const std::vector<double>& values)
+{
+    Statistics stats;
+    stats.count = values.size();
+    if (values.empty())
+        return stats;
+
+    stats.median = computeMedian(values);
+    std::vector<double> deviations;
+    for (const auto value : values)
+        deviations.push_back(std::abs(value - stats.median));
+    stats.mad = computeMedian(deviations);
+    return stats;
+}
+
+Better getDirection(const std::string& metric)
+{
+    for (const auto& m : METRICS)
+        if (m.name == metric)
+            return m.better;
+    return Better::lower;
+}
+
+bool readBenchmarks(const QString& filename, Samples& samples)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    const auto document = QJsonDocument::fromJson(file.readAll());
+    if (!document.isObject())
+        return false;
+
+    for (const auto& value : document.object()["benchmarks"].toArray())
+    {
+        const auto benchmark = value.toObject();
+        const auto name = benchmark["name"].toString().toStdString();
+        for (const auto& metric : METRICS)
+        {
+            const auto it = benchmark.find(QString::fromStdString(metric.name));
+            if (it != benchmark.end())
+                samples[{name, metric.name}].push_back(it->toDouble());
+        }
+    }
+    return true;
+}
+
+bool runCommand(const std::string& command, const QString& output)
+{
+    auto args = QString::fromStdString(command).split(' ',
+                                                      QString::SkipEmptyParts);
+    if (args.isEmpty())
+        return false;
+    const auto program = args.takeFirst();
+    args << "--output" << output;
+
+    QProcess process;
+    process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    process.setStandardOutputFile(QProcess::nullDevice());
+    process.start(program, args);
+    if (!process.waitForFinished(-1) ||
+        process.exitStatus() != QProcess::NormalExit ||
+        process.exitCode() != 0)
+    {
+        std::cerr << "Command failed: " << command << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool runCommands(const RegressionOptions& options, Results& results)
+{
+    QTemporaryDir dir;
+    if (!dir.isValid())
+        return false;
+    const auto output = dir.filePath("results.json");
+
+    Samples samples;
+    for (const auto& command : options.commands)
+    {
+        for (unsigned int i = 0; i < options.runs; ++i)
+        {
+            std::cerr << "[" << i + 1 << "/" << options.runs << "] "
+                      << command << std::endl;
+            QFile::remove(output);
+            if (!runCommand(command, output) ||
+                !readBenchmarks(output, samples))
+            {
+                return false;
+            }
+        }
+    }
+
+    for (const auto& kv : samples)
+        results[kv.first] = computeStatistics(kv.second);
+    return true;
+}
+
+bool readBaseline(const std::string& filename, Results& results)
+{
+    QFile file(QString::fromStdString(filename));
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    const auto document = QJsonDocument::fromJson(file.readAll());
+    if (!document.isObject())
+        return false;
+
+    for (const auto& value : document.object()["results"].toArray())
+    {
+        const auto result = value.toObject();
+        Statistics stats;
+        stats.median = result["median"].toDouble();
+        stats.mad = result["mad"].toDouble();
+        stats.count = result["count"].toInt();
+        results[{result["name"].toString().toStdString(),
+                 result["metric"].toString().toStdString()}] = stats;
+    }
+    return true;
+}
+
+bool writeBaseline(const std::string& filename, const Results& results)
+{
+    QJsonArray array;
+    for (const auto& kv : results)
+    {
+        QJsonObject result;
+        result["name"] = QString::fromStdString(kv.first.first);
+        result["metric"] = QString::fromStdString(kv.first.second);
+        result["median"] = kv.second.median;
+        result["mad"] = kv.second.mad;
+        result["count"] = int(kv.second.count);
+        array.append(result);
+    }
+    QJsonObject document;
+    document["results"] = array;
+
+    QSaveFile file(QString::fromStdString(filename));
+    return file.open(QIODevice::WriteOnly) &&
+           file.write(QJsonDocument{document}.toJson()) >= 0 && file.commit();
+}
+
+// @return the relative change of the median in percent
+double getChange(const Statistics& baseline, const Statistics& current)
+{
+    if (baseline.median == 0.0)
+        return 0.0;
+    return (current.median - baseline.median) / baseline.median * 100.0;
+}
+
+bool isNoise(const Statistics& baseline, const Statistics& current)
+{
+    const auto noise = NOISE_MADS * std::max(baseline.mad, current.mad);
+    return std::abs(current.median - baseline.median) <= noise;
+}
+
+void printResults(const Results& results)
+{
+    for (const auto& kv : results)
+    {
+        std::cout << std::left << std::setw(48) << kv.first.first
+                  << std::setw(16) << kv.first.second << std::right
+                  << std::setw(14) << kv.second.median << " +- "
+                  << kv.second.mad << std::endl;
+    }
+}
+
+/** @return the number of regressions. */
+size_t compare(const Results& baseline, const Results& current,
+               const double threshold)
+{
+    size_t regressions = 0;
+    std::cout << std::left << std::setw(48) << "benchmark" << std::setw(16)
+              << "metric" << std::right << std::setw(14) << "baseline"
+              << std::setw(14) << "current" << std::setw(10) << "change"
+              << "  status" << std::endl;
+
+    for (const auto& kv : current)
+    {
+        std::cout << std::left << std::setw(48) << kv.first.first
+                  << std::setw(16) << kv.first.second << std::right;
+
+        const auto it = baseline.find(kv.first);
+        if (it == baseline.end())
+        {
+            std::cout << std::setw(14) << "-" << std::setw(14)
+                      << kv.second.median << std::setw(10) << "-"
+                      << "  new" << std::endl;
+            continue;
+        }
+
+        const auto change = getChange(it->second, kv.second);
+        const auto better = getDirection(kv.first.second);
+        const auto regression = better == Better::lower ? change : -change;
+        const auto noise = isNoise(it->second, kv.second);
+        std::string status = "ok";
+        if (regression > threshold && !noise)
+        {
+            status = "REGRESSION";
+            ++regressions;
+        }
+        else if (regression < -threshold && !noise)
+            status = "improved";
+
+        std::cout << std::setw(14) << it->second.median << std::setw(14)
+                  << kv.second.median << std::setw(9) << std::fixed
+                  << std::setprecision(1) << change << "%"
+                  << std::defaultfloat << std::setprecision(6) << "  "
+                  << status << std::endl;
+    }
+
+    for (const auto& kv : baseline)
+    {
+        if (!current.count(kv.first))
+            std::cout << std::left << std::setw(48) << kv.first.first
+                      << std::setw(16) << kv.first.second << std::right
+                      << std::setw(14) << kv.second.median << std::setw(14)
+                      << "-" << std::setw(10) << "-"
+                      << "  missing" << std::endl;
+    }
+    return regressions;
+}
+
+int main(int argc, char** argv)
+{
+    const RegressionOptions options(argc, argv);
+    if (options.getHelp)
+    {
+        options.showSyntax();
+        return 0;
+    }
+
+    QCoreApplication app(argc, argv);
+
+    Results current;
+    if (!runCommands(options, current))
+    {
+        std::cerr << "Could not collect the results" << std::endl;
+        return EXIT_ERROR;
+    }
+
+    if (options.baseline.empty())
+    {
+        printResults(current);
+        return 0;
+    }
+
+    if (options.update)
+    {
+        if (!writeBaseline(options.baseline, current))
+        {
+            std::cerr << "Could not write " << options.baseline << std::endl;
+            return EXIT_ERROR;
+        }
+        printResults(current);
+        return 0;
+    }
+
+    Results baseline;
+    if (!readBaseline(options.baseline, baseline))
+    {
+        std::cerr << "Could not read " << options.baseline << std::endl;
+        return EXIT_ERROR;
+    }
+
+    const auto regressions = compare(baseline, current, options.threshold);
+    if (regressions > 0)
+    {
+        std::cout << regressions << " regression(s) above "
+                  << options.threshold << "%" << std::endl;
+        return EXIT_REGRESSION;
+    }
+    return 0;
+}
@@ -0,0 +1,169 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#define BOOST_TEST_MODULE RecordingReader
+#include <boost/test/unit_test.hpp>
+namespace ut = boost::unit_test;
+
+#include "Timer.h"
+
+#include <deflect/Frame.h>
+#include <deflect/FrameDecoder.h>
+#include <deflect/ImageSegmenter.h>
+#include <deflect/ImageWrapper.h>
+#include <deflect/StreamRecorder.h>
+#include <deflect/StreamRecording.h>
+
+#include <QFile>
+#include <QMutex>
+#include <QTemporaryDir>
+
+#include <iostream>
+
+// Compares reading a recording of 4K frames through the memory mapping, with
+// views on the image data, and through copies; then decodes the frames
+// straight from the mapping.
+
+namespace
+{
+const unsigned int WIDTH = 3840;
+const unsigned int HEIGHT = 2160;
+const unsigned int SEGMENT_SIZE = 512;
+const size_t NFRAMES = 50;
+
+deflect::Segments makeJpegSegments()
+{
+    // A gradient with some noise, representative of rendered content
+    std::vector<uint8_t> pixels(WIDTH * HEIGHT * 4);
+    for (size_t i = 0; i < WIDTH * HEIGHT; ++i)
+    {
+        pixels[i * 4] = uint8_t((i % WIDTH) * 255 / WIDTH);
+        pixels[i * 4 + 1] = uint8_t((i / WIDTH) * 255 / HEIGHT);
+        pixels[i * 4 + 2] = uint8_t(qrand() % 64);
+        pixels[i * 4 + 3] = 255;
+    }
+    deflect::ImageWrapper image(pixels.data(), WIDTH, HEIGHT, deflect::RGBA);
+    image.compressionPolicy = deflect::COMPRESSION_ON;
+
+    deflect::Segments segments;
+    QMutex mutex;
+    deflect::ImageSegmenter segmenter;
+    segmenter.setNominalSegmentDimensions(SEGMENT_SIZE, SEGMENT_SIZE);
+    segmenter.generate(image, [&](const deflect::Segment& segment) {
+        QMutexLocker lock(&mutex);
+        segments.push_back(segment);
+        return true;
+    });
+    return segments;
+}
+
+size_t writeRecording(const QString& filename)
+{
+    using Record = deflect::StreamRecording::Record;
+
+    Record frame;
+    frame.type = Record::Type::frame;
+    frame.uri = "benchmark";
+    frame.segments = makeJpegSegments();
+
+    size_t byteCount = 0;
+    for (const auto& segment : frame.segments)
+        byteCount += segment.imageData.size();
+
+    deflect::StreamRecorder recorder(filename);
+    for (size_t i = 0; i < NFRAMES; ++i)
+    {
+        frame.timeUs = i * 16667;
+        frame.timestamps.index = i;
+        recorder.write(frame);
+    }
+    return byteCount * NFRAMES;
+}
+
+void printResult(const std::string& name, const size_t byteCount,
+                 const float time)
+{
+    std::cout << name << ": " << byteCount / time / (1024 * 1024)
+              << " MB/s (" << NFRAMES / time << " FPS)" << std::endl;
+}
+}
+
+BOOST_AUTO_TEST_CASE(benchmarkRecordingReader)
+{
+    QTemporaryDir dir;
+    const auto filename = dir.filePath("benchmark.dfr");
+    const auto byteCount = writeRecording(filename);
+    Timer timer;
+
+    const deflect::StreamRecording recording(filename);
+    BOOST_REQUIRE_EQUAL(recording.getRecordCount(), NFRAMES);
+    BOOST_CHECK(recording.isMapped());
+
+    std::vector<deflect::FramePtr> frames;
+    timer.start();
+    for (size_t i = 0; i < recording.getRecordCount(); ++i)
+    {
+        frames.emplace_back(new deflect::Frame);
+        frames.back()->segments = recording.read(i).segments;
+    }
+    printResult("Mapped reader", byteCount, timer.elapsed());
+
+    {
+        QFile file(filename);
+        BOOST_REQUIRE(file.open(QIODevice::ReadOnly));
+        QDataStream stream(&file);
+        stream.setVersion(deflect::RECORDING_STREAM_VERSION);
+        stream.skipRawData(16); // header
+
+        deflect::StreamRecording::Record record;
+        timer.restart();
+        for (size_t i = 0; i < NFRAMES; ++i)
+            stream >> record;
+        printResult("Stream reader", byteCount, timer.elapsed());
+        BOOST_CHECK_EQUAL(stream.status(), QDataStream::Ok);
+    }
+
+    deflect::FrameDecoder decoder;
+    std::vector<std::future<void>> futures;
+    timer.restart();
+    for (auto& frame : frames)
+        futures.push_back(decoder.startDecoding(frame));
+    for (auto& future : futures)
+        BOOST_CHECK_NO_THROW(future.get());
+    printResult("Decoding from the mapping", byteCount, timer.elapsed());
+}
@@ -0,0 +1,406 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#include "NetworkEmulator.h"
+
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+#include <QTimer>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <random>
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+// Small socket buffers, so that the TCP flow control slows down the sender
+// when the emulated link is full.
+const qint64 READ_BUFFER_SIZE = 64 * 1024;
+const qint64 MAX_CHUNK_SIZE = 16 * 1024;
+const size_t MAX_QUEUED_BYTES = 8 * 1024 * 1024;
+
+// Payload of a TCP packet on Ethernet, used for the packet loss
+const double PACKET_SIZE = 1448.0;
+
+struct LinkCounters
+{
+    std::atomic<size_t> forwardedBytes{0};
+    std::atomic<size_t> queuedBytes{0};
+    std::atomic<size_t> maxQueuedBytes{0};
+
+    void enqueue(const size_t size)
+    {
+        const auto queued = queuedBytes += size;
+        auto max = maxQueuedBytes.load();
+        while (queued > max &&
+               !maxQueuedBytes.compare_exchange_weak(max, queued))
+        {
+        }
+    }
+
+    void forward(const size_t size)
+    {
+        queuedBytes -= size;
+        forwardedBytes += size;
+    }
+
+    LinkStatistics getStatistics() const
+    {
+        LinkStatistics stats;
+        stats.forwardedBytes = forwardedBytes;
+        stats.queuedBytes = queuedBytes;
+        stats.maxQueuedBytes = maxQueuedBytes;
+        return stats;
+    }
+};
+
+/** One direction of a proxied connection. */
+class Link
+{
+public:
+    Link(QTcpSocket& input, QTcpSocket& output,
+         const LinkConditions& conditions, const unsigned int seed,
+         LinkCounters& counters)
+        : _input(input)
+        , _output(output)
+        , _conditions(conditions)
+        , _counters(counters)
+        , _rng(seed)
+    {
+        _timer.setSingleShot(true);
+        _timer.setTimerType(Qt::PreciseTimer);
+        QObject::connect(&_timer, &QTimer::timeout, [this] { deliver(); });
+    }
+
+    ~Link() { _counters.queuedBytes -= _queuedBytes; }
+
+    /** Read the available input while the link is not full. */
+    void read()
+    {
+        while (_input.bytesAvailable() > 0 && !_isFull())
+        {
+            const auto data = _input.read(MAX_CHUNK_SIZE);
+            _queue.push_back({_schedule(data.size()), data});
+            _queuedBytes += data.size();
+            _counters.enqueue(data.size());
+        }
+        deliver();
+    }
+
+    /** Write the data that is due to the output. */
+    void deliver()
+    {
+        if (_output.state() != QAbstractSocket::ConnectedState)
+            return;
+
+        const auto now = Clock::now();
+        while (!_queue.empty() && _queue.front().delivery <= now)
+        {
+            const auto& data = _queue.front().data;
+            _output.write(data);
+            _queuedBytes -= data.size();
+            _counters.forward(data.size());
+            _queue.pop_front();
+        }
+
+        if (!_queue.empty())
+        {
+            using namespace std::chrono;
+            const auto delay = _queue.front().delivery - now;
+            const auto ms = duration_cast<milliseconds>(delay).count();
+            _timer.start(int(ms) + (delay > milliseconds(ms) ? 1 : 0));
+        }
+        else if (_inputClosed)
+            _output.disconnectFromHost();
+    }
+
+    /** Close the output once the remaining data is delivered. */
+    void closeInput()
+    {
+        _inputClosed = true;
+        read();
+    }
+
+private:
+    struct Chunk
+    {
+        Clock::time_point delivery;
+        QByteArray data;
+    };
+
+    QTcpSocket& _input;
+    QTcpSocket& _output;
+    const LinkConditions _conditions;
+    LinkCounters& _counters;
+    std::mt19937 _rng;
+    QTimer _timer;
+
+    std::deque<Chunk> _queue;
+    size_t _queuedBytes = 0;
+    Clock::time_point _lastDeparture;
+    Clock::time_point _lastDelivery;
+    bool _inputClosed = false;
+
+    bool _isFull() const
+    {
+        const auto pending = _queuedBytes + size_t(_output.bytesToWrite());
+        return pending >= MAX_QUEUED_BYTES;
+    }
+
+    Clock::time_point _schedule(const size_t size)
+    {
+        using us = std::chrono::microseconds;
+
+        // Transmission at the link bandwidth (Mbit/s = bit/us)
+        auto departure = std::max(Clock::now(), _lastDeparture);
+        if (_conditions.bandwidthMbps > 0.0)
+            departure += us(int64_t(size * 8 / _conditions.bandwidthMbps));
+        _lastDeparture = departure;
+
+        auto delivery = departure + us(_conditions.latencyUs);
+        if (_conditions.jitterUs > 0)
+        {
+            std::uniform_int_distribution<unsigned int> jitter(
+                0, _conditions.jitterUs);
+            delivery += us(jitter(_rng));
+        }
+        if (_conditions.lossRate > 0.0)
+        {
+            const auto packets = std::ceil(size / PACKET_SIZE);
+            const auto p = 1.0 - std::pow(1.0 - _conditions.lossRate, packets);
+            if (std::bernoulli_distribution(p)(_rng))
+                delivery += us(_conditions.retransmissionUs);
+        }
+
+        // TCP delivers in order, a delayed chunk holds back the next ones
+        delivery = std::max(delivery, _lastDelivery);
+        _lastDelivery = delivery;
+        return delivery;
+    }
+};
+
+class Connection : public QObject
+{
+public:
+    Connection(const qintptr handle, const QString& host, const quint16 port,
+               const LinkConditions& upstream,
+               const LinkConditions& downstream, const unsigned int index,
+               LinkCounters& upCounters, LinkCounters& downCounters,
+               QObject* parent)
+        : QObject(parent)
+        , _upstream(_client, _server, upstream, upstream.seed + index,
+                    upCounters)
+        , _downstream(_server, _client, downstream, downstream.seed + index,
+                      downCounters)
+    {
+        _client.setReadBufferSize(READ_BUFFER_SIZE);
+        _server.setReadBufferSize(READ_BUFFER_SIZE);
+
+        connect(&_client, &QTcpSocket::readyRead, [this] { _upstream.read(); });
+        connect(&_server, &QTcpSocket::readyRead,
+                [this] { _downstream.read(); });
+
+        // Resume reading when the output makes room in the link
+        connect(&_server, &QTcpSocket::bytesWritten,
+                [this] { _upstream.read(); });
+        connect(&_client, &QTcpSocket::bytesWritten,
+                [this] { _downstream.read(); });
+
+        connect(&_server, &QTcpSocket::connected, [this] {
+            _serverConnected = true;
+            _upstream.read();
+        });
+        connect(&_client, &QTcpSocket::disconnected, [this] {
+            _upstream.closeInput();
+            _deleteIfClosed();
+        });
+        connect(&_server, &QTcpSocket::disconnected, [this] {
+            _downstream.closeInput();
+            _deleteIfClosed();
+        });
+
+        // The server could not be reached
+        using ErrorSignal =
+            void (QAbstractSocket::*)(QAbstractSocket::SocketError);
+        connect(&_server, static_cast<ErrorSignal>(&QAbstractSocket::error),
+                [this] {
+                    if (!_serverConnected)
+                        _client.disconnectFromHost();
+                });
+
+        _client.setSocketDescriptor(handle);
+        _server.connectToHost(host, port);
+    }
+
+private:
+    QTcpSocket _client;
+    QTcpSocket _server;
+    Link _upstream;
+    Link _downstream;
+    bool _serverConnected = false;
+
+    void _deleteIfClosed()
+    {
+        if (_client.state() == QAbstractSocket::UnconnectedState &&
+            _server.state() == QAbstractSocket::UnconnectedState)
+        {
+            deleteLater();
+        }
+    }
+};
+
+class Proxy : public QTcpServer
+{
+public:
+    Proxy(const QString& host, const quint16 port,
+          const LinkConditions& upstream, const LinkConditions& downstream,
+          LinkCounters& upCounters, LinkCounters& downCounters)
+        : _host(host)
+        , _port(port)
+        , _upstream(upstream)
+        , _downstream(downstream)
+        , _upCounters(upCounters)
+        , _downCounters(downCounters)
+    {
+        if (!listen(QHostAddress::LocalHost))
+            qDebug("NetworkEmulator could not start listening!!");
+    }
+
+protected:
+    void incomingConnection(const qintptr handle) final
+    {
+        new Connection(handle, _host, _port, _upstream, _downstream,
+                       _connectionCount++, _upCounters, _downCounters, this);
+    }
+
+private:
+    const QString _host;
+    const quint16 _port;
+    const LinkConditions _upstream;
+    const LinkConditions _downstream;
+    LinkCounters& _upCounters;
+    LinkCounters& _downCounters;
+    unsigned int _connectionCount = 0;
+};
+}
+
+bool LinkConditions::fromProfile(const std::string& name,
+                                 LinkConditions& conditions)
+{
+    LinkConditions profile;
+    if (name == "lan100")
+    {
+        profile.bandwidthMbps = 100.0;
+        profile.latencyUs = 100;
+    }
+    else if (name == "lan1g")
+    {
+        profile.bandwidthMbps = 1000.0;
+        profile.latencyUs = 100;
+    }
+    else if (name == "wan")
+    {
+        profile.bandwidthMbps = 1000.0;
+        profile.latencyUs = 10000;
+        profile.jitterUs = 1000;
+    }
+    else if (name == "wifi")
+    {
+        profile.bandwidthMbps = 50.0;
+        profile.latencyUs = 2000;
+        profile.jitterUs = 3000;
+        profile.lossRate = 0.001;
+        profile.retransmissionUs = 20000;
+    }
+    else if (name != "none")
+        return false;
+
+    conditions = profile;
+    return true;
+}
+
+class NetworkEmulator::Impl
+{
+public:
+    QThread thread;
+    LinkCounters upstream;
+    LinkCounters downstream;
+    quint16 port = 0;
+};
+
+NetworkEmulator::NetworkEmulator(const QString& targetHost,
+                                 const quint16 targetPort,
+                                 const LinkConditions& upstream,
+                                 const LinkConditions& downstream)
+    : _impl(new Impl)
+{
+    auto proxy = new Proxy(targetHost, targetPort, upstream, downstream,
+                           _impl->upstream, _impl->downstream);
+    _impl->port = proxy->serverPort();
+    proxy->moveToThread(&_impl->thread);
+    QObject::connect(&_impl->thread, &QThread::finished, proxy,
+                     &QObject::deleteLater);
+    _impl->thread.start();
+}
+
+NetworkEmulator::~NetworkEmulator()
+{
+    _impl->thread.quit();
+    _impl->thread.wait();
+}
+
+quint16 NetworkEmulator::getPort() const
+{
+    return _impl->port;
+}
+
+LinkStatistics NetworkEmulator::getUpstreamStatistics() const
+{
+    return _impl->upstream.getStatistics();
+}
+
+LinkStatistics NetworkEmulator::getDownstreamStatistics() const
+{
+    return _impl->downstream.getStatistics();
+}
@@ -0,0 +1,130 @@
+/*********************************************************************/
+/* Copyright (c) 2017, EPFL/Blue Brain Project                       */
+/* All rights reserved.                                              */
+/*                                                                   */
+/* Redistribution and use in source and binary forms, with or        */
+/* without modification, are permitted provided that the following   */
+/* conditions are met:                                               */
+/*                                                                   */
+/*   1. Redistributions of source code must retain the above         */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer.                                                  */
+/*                                                                   */
+/*   2. Redistributions in binary form must reproduce the above      */
+/*      copyright notice, this list of conditions and the following  */
+/*      disclaimer in the documentation and/or other materials       */
+/*      provided with the distribution.                              */
+/*                                                                   */
+/*    THIS  SOFTWARE IS PROVIDED  BY THE  UNIVERSITY OF  TEXAS AT    */
+/*    AUSTIN  ``AS IS''  AND ANY  EXPRESS OR  IMPLIED WARRANTIES,    */
+/*    INCLUDING, BUT  NOT LIMITED  TO, THE IMPLIED  WARRANTIES OF    */
+/*    MERCHANTABILITY  AND FITNESS FOR  A PARTICULAR  PURPOSE ARE    */
+/*    DISCLAIMED.  IN  NO EVENT SHALL THE UNIVERSITY  OF TEXAS AT    */
+/*    AUSTIN OR CONTRIBUTORS BE  LIABLE FOR ANY DIRECT, INDIRECT,    */
+/*    INCIDENTAL,  SPECIAL, EXEMPLARY,  OR  CONSEQUENTIAL DAMAGES    */
+/*    (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF SUBSTITUTE    */
+/*    GOODS  OR  SERVICES; LOSS  OF  USE,  DATA,  OR PROFITS;  OR    */
+/*    BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON ANY THEORY OF    */
+/*    LIABILITY, WHETHER  IN CONTRACT, STRICT  LIABILITY, OR TORT    */
+/*    (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING IN ANY WAY OUT    */
+/*    OF  THE  USE OF  THIS  SOFTWARE,  EVEN  IF ADVISED  OF  THE    */
+/*    POSSIBILITY OF SUCH DAMAGE.                                    */
+/*                                                                   */
+/* The views and conclusions contained in the software and           */
+/* documentation are those of the authors and should not be          */
+/* interpreted as representing official policies, either expressed   */
+/* or implied, of Ecole polytechnique federale de Lausanne.          */
+/*********************************************************************/
+
+#ifndef DEFLECT_NETWORKEMULATOR_H
+#define DEFLECT_NETWORKEMULATOR_H
+
+#include <deflect/config.h>
+#include <deflect/mock/api.h>
+
+#include <QString>
+
+#include <memory>
+#include <string>
+
+/**
+ * Conditions of one direction of an emulated network link.
+ *
+ * Data is delayed by the time needed to transmit it at the given bandwidth,
+ * plus the latency and a random jitter. The order of the data is preserved,
+ * as TCP would do. Packet loss can not be applied to a TCP stream, so a lost
+ * packet is emulated as a retransmission which stalls the link.
+ */
+struct LinkConditions
+{
+    double bandwidthMbps = 0.0;             //!< In Mbit/s, 0 is unlimited
+    unsigned int latencyUs = 0;             //!< One-way delay
+    unsigned int jitterUs = 0;              //!< Maximum random extra delay
+    double lossRate = 0.0;                  //!< Probability per packet
+    unsigned int retransmissionUs = 200000; //!< Delay of a lost packet
+    unsigned int seed = 0;                  //!< Seed of jitter and loss
+
+    /**
+     * Get the conditions of a named profile.
+     *
+     * @param name of the profile: none, lan100 (100 Mbit/s), lan1g (1 Gbit/s),
+     *        wan (1 Gbit/s with 20 ms RTT) or wifi (lossy 50 Mbit/s)
+     * @param conditions set to the profile if the name is valid
+     * @return true if the name is valid
+     */
+    DEFLECT_API static bool fromProfile(const std::string& name,
+                                        LinkConditions& conditions);
+};
+
+/** Statistics of an emulated network link, cumulated over its connections. */
+struct LinkStatistics
+{
+    size_t forwardedBytes = 0; //!< Bytes delivered to the receiving side
+    size_t queuedBytes = 0;    //!< Bytes currently in flight in the link
+    size_t maxQueuedBytes = 0; //!< Maximum of queuedBytes
+};
+
+/**
+ * A userspace TCP proxy which shapes the traffic between clients and a
+ * target server, to test streaming over constrained links without root
+ * access.
+ *
+ * The proxy listens on a local port and runs in its own thread. Each
+ * accepted connection is forwarded to the target, with the upstream
+ * conditions applied to the data sent by the client and the downstream
+ * conditions to the data sent back by the server.
+ */
+class NetworkEmulator
+{
+public:
+    /**
+     * Start the proxy.
+     *
+     * @param targetHost the host of the server
+     * @param targetPort the port of the server
+     * @param upstream conditions of the client -> server direction
+     * @param downstream conditions of the server -> client direction
+     */
+    DEFLECT_API NetworkEmulator(const QString& targetHost,
+                                quint16 targetPort,
+                                const LinkConditions& upstream,
+                                const LinkConditions& downstream);
+
+    /** Stop the proxy, closing all connections. */
+    DEFLECT_API ~NetworkEmulator();
+
+    /** @return the local port to connect to instead of the server. */
+    DEFLECT_API quint16 getPort() const;
+
+    /** @return the statistics of the client -> server direction. */
+    DEFLECT_API LinkStatistics getUpstreamStatistics() const;
+
+    /** @return the statistics of the server -> client direction. */
+    DEFLECT_API LinkStatistics getDownstreamStatistics() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> _impl;
+};
+
+#endif